@@ -0,0 +1,202 @@
+#include "iconUploader.hpp"
+#include <algorithm>
+#include <cstring>
+#include <hephaestus/core/hephResult.hpp>
+#include <imgui_impl_vulkan.h>
+
+static constexpr VkDeviceSize s_cellBytes = IconAtlas::cellSize * IconAtlas::cellSize * 4;
+
+HephResult  IconUploader::create(HephDevice& device, VkPhysicalDevice physicalDevice, uint32_t frameCount) {
+  m_device = &device;
+  vkGetPhysicalDeviceMemoryProperties(physicalDevice, &m_memoryProperties);
+
+  VkSamplerCreateInfo   samplerInfo = {
+    .sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO,
+    .magFilter = VK_FILTER_LINEAR,
+    .minFilter = VK_FILTER_LINEAR,
+    .mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST,
+    .addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+    .addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+    .addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE,
+    .maxAnisotropy = 1.0f,
+    .minLod = 0.0f,
+    .maxLod = 0.0f,
+  };
+  HEPH_CHECK_RESULT(HephResult(vkCreateSampler(device.device, &samplerInfo, device.pAllocationCallbacks, &m_sampler)
+        , "Failed to create icon sampler {{}} !"));
+
+  VkBufferCreateInfo    bufferInfo = {
+    .sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO,
+    .size = frameCount * cellsPerFrame * s_cellBytes,
+    .usage = VK_BUFFER_USAGE_TRANSFER_SRC_BIT,
+    .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+  };
+  HEPH_CHECK_RESULT(HephResult(vkCreateBuffer(device.device, &bufferInfo, device.pAllocationCallbacks, &m_staging)
+        , "Failed to create icon staging buffer {{}} !"));
+  VkMemoryRequirements  requirements;
+  vkGetBufferMemoryRequirements(device.device, m_staging, &requirements);
+  int   type = findMemoryType(requirements.memoryTypeBits
+      , VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT);
+  HEPH_CHECK_RESULT(HephResult("No host visible memory for icon staging!", type >= 0));
+  VkMemoryAllocateInfo  allocInfo = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+    .allocationSize = requirements.size,
+    .memoryTypeIndex = (uint32_t)type,
+  };
+  HEPH_CHECK_RESULT(HephResult(vkAllocateMemory(device.device, &allocInfo, device.pAllocationCallbacks, &m_stagingMemory)
+        , "Failed to allocate icon staging memory {{}} !"));
+  HEPH_CHECK_RESULT(HephResult(vkBindBufferMemory(device.device, m_staging, m_stagingMemory, 0)
+        , "Failed to bind icon staging memory {{}} !"));
+  HEPH_CHECK_RESULT(HephResult(vkMapMemory(device.device, m_stagingMemory, 0, VK_WHOLE_SIZE, 0, (void**)&m_stagingData)
+        , "Failed to map icon staging memory {{}} !"));
+  return (HephResult());
+}
+
+//Before ImGui_ImplVulkan_Shutdown, the page descriptors come from its pool
+void  IconUploader::destroy() {
+  if (m_device == nullptr)
+    return ;
+  VkDevice  device = m_device->device;
+  for (auto& page: m_pages) {
+    if (page.descriptor != VK_NULL_HANDLE)
+      ImGui_ImplVulkan_RemoveTexture(page.descriptor);
+    vkDestroyImageView(device, page.view, m_device->pAllocationCallbacks);
+    vkDestroyImage(device, page.image, m_device->pAllocationCallbacks);
+    vkFreeMemory(device, page.memory, m_device->pAllocationCallbacks);
+  }
+  m_pages.clear();
+  if (m_stagingData != nullptr)
+    vkUnmapMemory(device, m_stagingMemory);
+  vkDestroyBuffer(device, m_staging, m_device->pAllocationCallbacks);
+  vkFreeMemory(device, m_stagingMemory, m_device->pAllocationCallbacks);
+  vkDestroySampler(device, m_sampler, m_device->pAllocationCallbacks);
+  m_stagingData = nullptr;
+  m_device = nullptr;
+}
+
+void  IconUploader::record(VkCommandBuffer commandBuffer, uint32_t frame, IconAtlas& atlas) {
+  auto&         atlasPages = atlas.pages();
+  VkDeviceSize  offset = frame * cellsPerFrame * s_cellBytes;
+  uint32_t      budget = cellsPerFrame;
+
+  for (uint32_t p = 0; p < atlasPages.size() && p < maxPages && budget > 0; p++) {
+    IconAtlas::Page&  atlasPage = *atlasPages[p];
+    if (atlasPage.pending.empty())
+      continue ;
+    if (p >= m_pages.size())
+      m_pages.resize(p + 1);
+    Page&   page = m_pages[p];
+    if (page.failed)
+      continue ;
+    if (page.descriptor == VK_NULL_HANDLE) {
+      HephResult  result = createPage(page);
+      if (!result.valid()) {
+        //Its icons stay placeholders
+        page.failed = true;
+        HEPH_PRINT_RESULT(result);
+        continue ;
+      }
+    }
+
+    uint32_t                        count = std::min<size_t>(budget, atlasPage.pending.size());
+    std::vector<VkBufferImageCopy>  regions;
+    regions.reserve(count);
+    for (uint32_t i = 0; i < count; i++) {
+      int       cell = atlasPage.pending[i];
+      int32_t   x = (cell % IconAtlas::pageColumns) * IconAtlas::cellSize;
+      int32_t   y = (cell / IconAtlas::pageColumns) * IconAtlas::cellSize;
+      uint8_t*  staged = m_stagingData + offset;
+      for (int row = 0; row < IconAtlas::cellSize; row++)
+        std::memcpy(staged + row * IconAtlas::cellSize * 4
+            , atlasPage.pixels.data() + ((y + row) * IconAtlas::pageSize + x) * 4, IconAtlas::cellSize * 4);
+      regions.push_back((VkBufferImageCopy){
+        .bufferOffset = offset,
+        .imageSubresource = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1},
+        .imageOffset = {x, y, 0},
+        .imageExtent = {IconAtlas::cellSize, IconAtlas::cellSize, 1},
+      });
+      offset += s_cellBytes;
+      atlas.uploaded(p, cell);
+    }
+    atlasPage.pending.erase(atlasPage.pending.begin(), atlasPage.pending.begin() + count);
+    budget -= count;
+
+    //The page may be sampled by a frame still in flight, the copy waits for
+    //its fragment shaders and this frame's waits for the copy
+    VkImageMemoryBarrier  barrier = {
+      .sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER,
+      .srcAccessMask = page.written ? (VkAccessFlags)VK_ACCESS_SHADER_READ_BIT : 0u,
+      .dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT,
+      .oldLayout = page.written ? VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL : VK_IMAGE_LAYOUT_UNDEFINED,
+      .newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+      .srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED,
+      .image = page.image,
+      .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+    };
+    vkCmdPipelineBarrier(commandBuffer
+        , page.written ? VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT
+        , VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    vkCmdCopyBufferToImage(commandBuffer, m_staging, page.image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL
+        , regions.size(), regions.data());
+    barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+    barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    vkCmdPipelineBarrier(commandBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT
+        , 0, 0, nullptr, 0, nullptr, 1, &barrier);
+    page.written = true;
+    atlasPage.texture = (ImTextureID)page.descriptor;
+  }
+}
+
+HephResult  IconUploader::createPage(Page& page) {
+  VkDevice            device = m_device->device;
+  VkImageCreateInfo   imageInfo = {
+    .sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO,
+    .imageType = VK_IMAGE_TYPE_2D,
+    .format = VK_FORMAT_R8G8B8A8_UNORM,
+    .extent = {IconAtlas::pageSize, IconAtlas::pageSize, 1},
+    .mipLevels = 1,
+    .arrayLayers = 1,
+    .samples = VK_SAMPLE_COUNT_1_BIT,
+    .tiling = VK_IMAGE_TILING_OPTIMAL,
+    .usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT,
+    .sharingMode = VK_SHARING_MODE_EXCLUSIVE,
+    .initialLayout = VK_IMAGE_LAYOUT_UNDEFINED,
+  };
+  HEPH_CHECK_RESULT(HephResult(vkCreateImage(device, &imageInfo, m_device->pAllocationCallbacks, &page.image)
+        , "Failed to create icon page {{}} !"));
+  VkMemoryRequirements  requirements;
+  vkGetImageMemoryRequirements(device, page.image, &requirements);
+  int   type = findMemoryType(requirements.memoryTypeBits, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT);
+  HEPH_CHECK_RESULT(HephResult("No device memory for icon page!", type >= 0));
+  VkMemoryAllocateInfo  allocInfo = {
+    .sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO,
+    .allocationSize = requirements.size,
+    .memoryTypeIndex = (uint32_t)type,
+  };
+  HEPH_CHECK_RESULT(HephResult(vkAllocateMemory(device, &allocInfo, m_device->pAllocationCallbacks, &page.memory)
+        , "Failed to allocate icon page {{}} !"));
+  HEPH_CHECK_RESULT(HephResult(vkBindImageMemory(device, page.image, page.memory, 0)
+        , "Failed to bind icon page memory {{}} !"));
+  VkImageViewCreateInfo viewInfo = {
+    .sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO,
+    .image = page.image,
+    .viewType = VK_IMAGE_VIEW_TYPE_2D,
+    .format = VK_FORMAT_R8G8B8A8_UNORM,
+    .subresourceRange = {VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, 1},
+  };
+  HEPH_CHECK_RESULT(HephResult(vkCreateImageView(device, &viewInfo, m_device->pAllocationCallbacks, &page.view)
+        , "Failed to create icon page view {{}} !"));
+  page.descriptor = ImGui_ImplVulkan_AddTexture(m_sampler, page.view, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+  return (HephResult("Failed to allocate icon page descriptor!", page.descriptor != VK_NULL_HANDLE));
+}
+
+int   IconUploader::findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const {
+  for (uint32_t i = 0; i < m_memoryProperties.memoryTypeCount; i++) {
+    if ((typeBits & (1u << i)) && (m_memoryProperties.memoryTypes[i].propertyFlags & properties) == properties)
+      return (i);
+  }
+  return (-1);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <hephaestus/hephaestus.hpp>
+#include <vulkan/vulkan_core.h>
+#include <vector>
+
+#include "stator/iconAtlas.hpp"
+
+//GPU side of the IconAtlas: one sampled image per atlas page, filled a few
+//cells per frame through a persistently mapped staging buffer. Each frame
+//owns its slice of the buffer, so recording never waits on the queue.
+class IconUploader {
+  public:
+    static constexpr uint32_t cellsPerFrame = 32;
+    static constexpr uint32_t maxPages = 16;  //Descriptor sets reserved in the ImGui pool
+
+    HephResult  create(HephDevice& device, VkPhysicalDevice physicalDevice, uint32_t frameCount);
+    void        destroy();
+    //Copy pending cells into their page, outside of any render pass. frame
+    //is the index of the command buffer being recorded
+    void        record(VkCommandBuffer commandBuffer, uint32_t frame, IconAtlas& atlas);
+
+  private:
+    struct  Page {
+      VkImage         image = VK_NULL_HANDLE;
+      VkDeviceMemory  memory = VK_NULL_HANDLE;
+      VkImageView     view = VK_NULL_HANDLE;
+      VkDescriptorSet descriptor = VK_NULL_HANDLE;
+      bool            written = false;  //Still in VK_IMAGE_LAYOUT_UNDEFINED until the first copy
+      bool            failed = false;
+    };
+
+    HephResult  createPage(Page& page);
+    int         findMemoryType(uint32_t typeBits, VkMemoryPropertyFlags properties) const;
+
+    HephDevice*                       m_device = nullptr;
+    VkPhysicalDeviceMemoryProperties  m_memoryProperties;
+    VkSampler                         m_sampler = VK_NULL_HANDLE;
+    VkBuffer                          m_staging = VK_NULL_HANDLE;
+    VkDeviceMemory                    m_stagingMemory = VK_NULL_HANDLE;
+    uint8_t*                          m_stagingData = nullptr;
+    std::vector<Page>                 m_pages;
+};
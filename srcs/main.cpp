@@ -1,6 +1,148 @@
 #include "statorGui.hpp"
+#include "stator/catalogLoader.hpp"
+#include "stator/evalServer.hpp"
+#include "stator/factoryDiff.hpp"
+#include "stator/memoryTracker.hpp"
+#include "stator/sensitivity.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+//stator --diff before.json after.json [--parts Parts.json] [--recipes Recipes.json]
+//Exit status is 0 when the factories match, 1 when they differ, 2 on error
+static int	diffMain(int ac, char** av) {
+	std::string	partsPath = "./Parts.json";
+	std::string	recipesPath = "./Recipes.json";
+	std::vector<std::string>	saves;
+
+	for (int i = 2; i < ac; i++) {
+		if (!strcmp(av[i], "--parts") && i + 1 < ac)
+			partsPath = av[++i];
+		else if (!strcmp(av[i], "--recipes") && i + 1 < ac)
+			recipesPath = av[++i];
+		else
+			saves.push_back(av[i]);
+	}
+	if (saves.size() != 2) {
+		std::cerr << "usage: " << av[0] << " --diff before.json after.json [--parts Parts.json] [--recipes Recipes.json]" << std::endl;
+		return (2);
+	}
+	try {
+		LoadReport					report;
+		std::vector<Part>		parts = loadParts(partsPath, report);
+		std::vector<Recipe>	recipes = loadRecipes(recipesPath, report);
+		CatalogRef					catalog = Catalog::build(std::move(parts), std::move(recipes));
+		FactorySnapshot			before;
+		FactorySnapshot			after;
+		loadSnapshotFile(before, saves[0], *catalog, &report);
+		loadSnapshotFile(after, saves[1], *catalog, &report);
+		//Skipped entries are worth knowing about but don't make the diff an error
+		std::cerr << report.format();
+		FactoryDiff	diff = diffFactories(before, after, *catalog);
+		std::cout << formatDiff(diff);
+		return (diff.empty() ? 0 : 1);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return (2);
+	}
+}
+
+//stator --sensitivity save.json [--parts Parts.json] [--recipes Recipes.json] [--branches]
+//Prints d output / d input for every output and input or part ratio as CSV,
+//or with --branches what holds every node back
+static int	sensitivityMain(int ac, char** av) {
+	std::string	partsPath = "./Parts.json";
+	std::string	recipesPath = "./Recipes.json";
+	std::string	save;
+	bool				branches = false;
+
+	for (int i = 2; i < ac; i++) {
+		if (!strcmp(av[i], "--parts") && i + 1 < ac)
+			partsPath = av[++i];
+		else if (!strcmp(av[i], "--recipes") && i + 1 < ac)
+			recipesPath = av[++i];
+		else if (!strcmp(av[i], "--branches"))
+			branches = true;
+		else if (save.empty())
+			save = av[i];
+		else
+			save.clear(), i = ac;
+	}
+	if (save.empty()) {
+		std::cerr << "usage: " << av[0] << " --sensitivity save.json [--parts Parts.json] [--recipes Recipes.json] [--branches]" << std::endl;
+		return (2);
+	}
+	try {
+		LoadReport					report;
+		std::vector<Part>		parts = loadParts(partsPath, report);
+		std::vector<Recipe>	recipes = loadRecipes(recipesPath, report);
+		CatalogRef					catalog = Catalog::build(std::move(parts), std::move(recipes));
+		FactorySnapshot			snapshot;
+		Sensitivity					sensitivity;
+		loadSnapshotFile(snapshot, save, *catalog, &report);
+		std::cerr << report.format();
+		sensitivity.compute(snapshot.flow);
+		if (branches)
+			sensitivity.writeBranches(std::cout, snapshot.flow);
+		else
+			sensitivity.writeCsv(std::cout);
+		return (0);
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << std::endl;
+		return (2);
+	}
+}
+
+//stator --serve socket [--parts Parts.json] [--recipes Recipes.json] [--workers N]
+//Runs the evaluation server until it is asked to shut down, see evalServer.hpp
+static int	serveMain(int ac, char** av) {
+	std::string	partsPath = "./Parts.json";
+	std::string	recipesPath = "./Recipes.json";
+	std::string	socketPath;
+	int					workers = 0;
+
+	for (int i = 2; i < ac; i++) {
+		if (!strcmp(av[i], "--parts") && i + 1 < ac)
+			partsPath = av[++i];
+		else if (!strcmp(av[i], "--recipes") && i + 1 < ac)
+			recipesPath = av[++i];
+		else if (!strcmp(av[i], "--workers") && i + 1 < ac)
+			workers = atoi(av[++i]);
+		else if (socketPath.empty())
+			socketPath = av[i];
+		else
+			socketPath.clear(), i = ac;
+	}
+	if (socketPath.empty()) {
+		std::cerr << "usage: " << av[0] << " --serve socket [--parts Parts.json] [--recipes Recipes.json] [--workers N]" << std::endl;
+		return (2);
+	}
+	EvalServer	server(partsPath, recipesPath);
+	return (server.run(socketPath, workers));
+}
+
+//With STATOR_MEMORY_TRACKING, STATOR_MEMORY_REPORT=path writes the memory
+//counters there as JSON when the process is done
+struct	MemoryReport {
+	~MemoryReport() {
+		const char*	path = getenv("STATOR_MEMORY_REPORT");
+		if (MemoryTracker::enabled() && path != nullptr && !MemoryTracker::writeJson(path))
+			std::cerr << "Can't write " << path << std::endl;
+	}
+};
 
 int	main(int ac, char** av) {
+	MemoryReport	memoryReport;
+
+	if (ac > 1 && !strcmp(av[1], "--diff"))
+		return (diffMain(ac, av));
+	if (ac > 1 && !strcmp(av[1], "--sensitivity"))
+		return (sensitivityMain(ac, av));
+	if (ac > 1 && !strcmp(av[1], "--serve"))
+		return (serveMain(ac, av));
+
 	StatorGui       stator("./Parts.json", "./Recipes.json");
 	HephResult	    result = stator.create();
 
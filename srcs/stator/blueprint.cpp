@@ -0,0 +1,265 @@
+#include "blueprint.hpp"
+#include "memoryTracker.hpp"
+#include "power.hpp"
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+#include <cstdlib>
+
+std::string Blueprint::hashString() const {
+  char  buffer[17];
+  std::snprintf(buffer, sizeof(buffer), "%016llx", (unsigned long long)hash);
+  return (buffer);
+}
+
+//FNV-1a
+static uint64_t   hashBytes(const void* data, size_t size, uint64_t hash = 14695981039346656037ull) {
+  for (size_t i = 0; i < size; i++) {
+    hash ^= static_cast<const unsigned char*>(data)[i];
+    hash *= 1099511628211ull;
+  }
+  return (hash);
+}
+
+static uint64_t   hashText(const std::string& text) {
+  return (hashBytes(text.data(), text.size()));
+}
+
+//Fragment nodes come in the editor's map order, so they are put in an order
+//that only depends on the content: by their own JSON, then by the keys of
+//what they link to, refined until the number of distinct keys stops growing
+//(Weisfeiler-Lehman). Nodes still tied are alike down to their neighbours.
+//Links are remapped to that order and sorted.
+uint64_t  BlueprintLibrary::contentHash(const json::value& definition) {
+  json::value canonical = definition;
+  auto        nodes = canonical.as_object().if_contains("nodes");
+  if (nodes == nullptr || !nodes->is_array())
+    return (hashText(json::serialize(canonical)));
+  json::array&  nodeArray = nodes->as_array();
+  size_t        count = nodeArray.size();
+  std::vector<uint64_t> keys(count);
+  for (int i = 0; i < count; i++) {
+    if (nodeArray[i].is_object()) {
+      nodeArray[i].as_object().erase("pos");
+      nodeArray[i].as_object().erase("id");
+    }
+    keys[i] = hashText(json::serialize(nodeArray[i]));
+  }
+
+  struct  Link {
+    int64_t ends[5] = {0, 0, 0, 0, 0};  //from, fromPin, to, toPin, tier
+  };
+  std::vector<Link> links;
+  json::array       unreadable;
+  auto              linksValue = canonical.as_object().if_contains("links");
+  if (linksValue != nullptr && linksValue->is_array()) {
+    for (auto& linkValue: linksValue->as_array()) {
+      auto  linkArray = linkValue.if_array();
+      bool  valid = linkArray != nullptr && linkArray->size() >= 4 && linkArray->size() <= 5;
+      Link  link;
+      for (int i = 0; valid && i < linkArray->size(); i++) {
+        valid = (*linkArray)[i].is_int64() || (*linkArray)[i].is_uint64();
+        if (valid)
+          link.ends[i] = (*linkArray)[i].to_number<int64_t>();
+      }
+      valid = valid && link.ends[0] >= 0 && link.ends[0] < count && link.ends[2] >= 0 && link.ends[2] < count;
+      if (valid)
+        links.push_back(link);
+      else
+        unreadable.push_back(linkValue);
+    }
+  }
+
+  std::vector<std::vector<uint64_t>>  signatures(count);
+  size_t                              distinct = 0;
+  for (size_t round = 0; round < count; round++) {
+    for (int i = 0; i < count; i++)
+      signatures[i] = {keys[i]};
+    for (auto& link: links) {
+      const int64_t*  ends = link.ends;
+      uint64_t  out[] = {1, (uint64_t)ends[1], (uint64_t)ends[3], (uint64_t)ends[4], keys[ends[2]]};
+      uint64_t  in[] = {2, (uint64_t)ends[3], (uint64_t)ends[1], (uint64_t)ends[4], keys[ends[0]]};
+      signatures[ends[0]].push_back(hashBytes(out, sizeof(out)));
+      signatures[ends[2]].push_back(hashBytes(in, sizeof(in)));
+    }
+    std::vector<uint64_t> refined(count);
+    for (int i = 0; i < count; i++) {
+      std::sort(signatures[i].begin() + 1, signatures[i].end());
+      refined[i] = hashBytes(signatures[i].data(), signatures[i].size() * sizeof(uint64_t));
+    }
+    std::vector<uint64_t> sorted = refined;
+    std::sort(sorted.begin(), sorted.end());
+    size_t  refinedDistinct = std::unique(sorted.begin(), sorted.end()) - sorted.begin();
+    if (refinedDistinct <= distinct)
+      break ;
+    keys = refined;
+    distinct = refinedDistinct;
+  }
+
+  std::vector<int>  order(count);
+  std::vector<int>  position(count);
+  for (int i = 0; i < count; i++)
+    order[i] = i;
+  std::stable_sort(order.begin(), order.end(), [&](int a, int b) {return (keys[a] < keys[b]);});
+  json::array sortedNodes;
+  sortedNodes.reserve(count);
+  for (int i = 0; i < count; i++) {
+    position[order[i]] = i;
+    sortedNodes.push_back(nodeArray[order[i]]);
+  }
+  for (auto& link: links) {
+    link.ends[0] = position[link.ends[0]];
+    link.ends[2] = position[link.ends[2]];
+  }
+  std::sort(links.begin(), links.end(), [](const Link& a, const Link& b) {
+    return (std::lexicographical_compare(a.ends, a.ends + 5, b.ends, b.ends + 5));
+  });
+  json::array sortedLinks;
+  sortedLinks.reserve(links.size() + unreadable.size());
+  for (auto& link: links)
+    sortedLinks.push_back(json::array{link.ends[0], link.ends[1], link.ends[2], link.ends[3], link.ends[4]});
+  for (auto& link: unreadable)
+    sortedLinks.push_back(link);
+  *nodes = std::move(sortedNodes);
+  canonical.as_object()["links"] = std::move(sortedLinks);
+  return (hashText(json::serialize(canonical)));
+}
+
+std::shared_ptr<Blueprint>  BlueprintLibrary::add(const json::value& definition, const std::string& name, const Catalog& catalog) {
+  uint64_t  hash = contentHash(definition);
+  auto      it = m_byHash.find(hash);
+  if (it != m_byHash.end())
+    return (it->second);
+
+  auto  blueprint = std::make_shared<Blueprint>();
+  blueprint->hash = hash;
+  blueprint->name = name;
+  blueprint->definition = definition;
+  compile(*blueprint, catalog);
+
+  m_byHash[hash] = blueprint;
+  m_entries.push_back(blueprint);
+  return (blueprint);
+}
+
+std::unordered_map<std::string, std::shared_ptr<Blueprint>>   BlueprintLibrary::addSaved(const json::object& save
+    , const Catalog& catalog) {
+  //Identical definitions, even saved under different hashes, share one entry
+  std::unordered_map<std::string, std::shared_ptr<Blueprint>> blueprints;
+  if (auto saved = save.if_contains("blueprints")) {
+    for (auto& entry: saved->as_array()) {
+      const json::object& entryObj = entry.as_object();
+      blueprints[entryObj.at("hash").as_string().c_str()] = add(entryObj.at("definition")
+          , entryObj.at("name").as_string().c_str(), catalog);
+    }
+  }
+  return (blueprints);
+}
+
+void  BlueprintLibrary::resolvePlan(const json::object& save, FactoryPlan& plan, const Catalog& catalog
+    , LoadReport* report) {
+  auto  blueprints = addSaved(save, catalog);
+  for (int i = 0; i < plan.nodes.size(); i++) {
+    FactoryPlan::Node&  node = plan.nodes[i];
+    if (node.type != SNT_BLUEPRINT_NODE)
+      continue ;
+    auto  hash = node.data.is_object() ? node.data.as_object().if_contains("blueprint") : nullptr;
+    auto  it = hash != nullptr && hash->is_string() ? blueprints.find(hash->as_string().c_str()) : blueprints.end();
+    if (it != blueprints.end()) {
+      node.data.as_object()["blueprint"] = it->second->hashString();
+      continue ;
+    }
+    if (report != nullptr)
+      report->error(fieldPath(indexPath("", "nodes", i), "blueprint")
+          , hash == nullptr ? "missing" : hash->is_string() ? "unknown blueprint" : "expected a string");
+    node.type = SNT_NA;
+  }
+}
+
+void  BlueprintLibrary::rebuild(const Catalog& catalog) {
+  //Entries only reference older ones, so in order every nested blueprint is already up to date
+  for (auto& entry: m_entries)
+    compile(*entry, catalog);
+}
+
+void  BlueprintLibrary::compile(Blueprint& blueprint, const Catalog& catalog) {
+  FactoryPlan plan;
+  planFromFragment(blueprint.definition, catalog, plan);
+  blueprint.flow.clear();
+  buildFlow(blueprint.flow, plan, catalog, this);
+
+  //Names are kept on a rebuild, live nodes have pins made after them
+  bool  named = !blueprint.outputNames.empty();
+  auto& nodes = blueprint.flow.nodes();
+  blueprint.outputRates.clear();
+  for (int i = 0; i < nodes.size(); i++) {
+    if (nodes[i].type != SNT_OUT_NODE)
+      continue ;
+    blueprint.outputRates.push_back(nodes[i].rate);
+    if (named)
+      continue ;
+    //Outputs are named after the part feeding them
+    int         from = nodes[i].ins[0].node;
+    std::string outName = from >= 0 && nodes[from].part != nullptr ? nodes[from].part->name.str() : "out";
+    std::string unique = outName;
+    for (int n = 2; std::find(blueprint.outputNames.begin(), blueprint.outputNames.end(), unique) != blueprint.outputNames.end(); n++)
+      unique = outName + " (" + std::to_string(n) + ")";
+    blueprint.outputNames.push_back(unique);
+  }
+  PowerBalance  power;
+  power.reset(blueprint.flow);
+  blueprint.power = power.net();
+}
+
+std::shared_ptr<Blueprint>  BlueprintLibrary::find(const std::string& hash) const {
+  if (hash.size() != 16 || !std::all_of(hash.begin(), hash.end(), [](char c) {return (std::isxdigit((unsigned char)c));}))
+    return (nullptr);
+  auto  it = m_byHash.find(std::strtoull(hash.c_str(), nullptr, 16));
+  return (it != m_byHash.end() ? it->second : nullptr);
+}
+
+void  buildFlow(FlowGraph& flow, const FactoryPlan& plan, const Catalog& catalog
+    , const BlueprintLibrary* library) {
+  MemoryScope memory(MS_EVALUATION);
+  flow.clear();
+  for (auto& planNode: plan.nodes) {
+    FlowNode  node;
+    node.type = planNode.type;
+    node.value = planNode.value;
+    switch (planNode.type) {
+      case SNT_PART_NODE:
+        node.part = &catalog.parts()[planNode.part];
+        node.ratios = planNode.ratios;
+        node.ins.resize(planNode.inCount);
+        break;
+      case SNT_GENERATOR_NODE:
+        node.part = &catalog.parts()[planNode.part];
+        break;
+      case SNT_RECIPE_NODE:
+        node.recipe = &catalog.recipes()[planNode.recipe];
+        break;
+      case SNT_BLUEPRINT_NODE:
+        {
+          std::shared_ptr<Blueprint>  blueprint;
+          auto                        hash = planNode.data.as_object().if_contains("blueprint");
+          if (library != nullptr && hash != nullptr)
+            blueprint = library->find(hash->as_string().c_str());
+          if (blueprint == nullptr) {
+            node.type = SNT_NA;
+            break ;
+          }
+          node.ratios = blueprint->outputRates;
+          node.unitPower = blueprint->power;
+        }
+        break;
+      default:
+        break;
+    }
+    flow.addNode(node);
+  }
+  for (auto& link: plan.links) {
+    if (link.fromPin >= 0 && link.fromPin < flow.nodes()[link.from].outs.size())
+      flow.addLink({link.from, link.fromPin}, {link.to, link.toPin}, linkTierCapacity(link.tier));
+  }
+  flow.build();
+}
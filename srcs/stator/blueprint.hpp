@@ -0,0 +1,109 @@
+#pragma once
+
+#include "stator/stator.hpp"
+#include "statorNode.hpp"
+#include "flowGraph.hpp"
+#include "factoryGenerator.hpp"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+//Sub-factory definition shared by every instance. The definition is only
+//evaluated once: a factory graph is positively homogeneous, so an instance
+//of scale s produces s times the blueprint outputs and power.
+struct  Blueprint {
+  std::string   hashString() const;
+
+  uint64_t                  hash = 0;
+  std::string               name;
+  json::value               definition;   //Fragment, see FactoryNode::copySelection
+  FlowGraph                 flow;
+  std::vector<std::string>  outputNames;
+  std::vector<double>       outputRates;  //Per unit of scale
+  double                    power = 0.0;  //Net MW per unit of scale
+  int                       instances = 0; //Live BlueprintNodes
+};
+
+class BlueprintLibrary {
+  public:
+    //Positions and node ids are left out, the same factory moved around or
+    //copied again hashes the same
+    static uint64_t contentHash(const json::value& definition);
+
+    //Returns the existing entry when the same content was already added
+    std::shared_ptr<Blueprint>  add(const json::value& definition, const std::string& name, const Catalog& catalog);
+    //Entry saved under hash, as hashString formats it
+    std::shared_ptr<Blueprint>  find(const std::string& hash) const;
+    //Register the blueprints embedded in a save, keyed by the hash they were saved under
+    std::unordered_map<std::string, std::shared_ptr<Blueprint>>   addSaved(const json::object& save
+        , const Catalog& catalog);
+    //Point the blueprint nodes of a plan read from a save at entries of this
+    //library, saved hashes may be stale. Nodes with an unknown or no blueprint
+    //are left out and reported.
+    void                        resolvePlan(const json::object& save, FactoryPlan& plan, const Catalog& catalog
+        , LoadReport* report = nullptr);
+    //Recompute flows, rates and power after the catalog changed
+    void                        rebuild(const Catalog& catalog);
+
+    const std::vector<std::shared_ptr<Blueprint>>&  entries() const {return (m_entries);}
+
+  private:
+    void  compile(Blueprint& blueprint, const Catalog& catalog);
+
+    std::unordered_map<uint64_t, std::shared_ptr<Blueprint>>  m_byHash;
+    std::vector<std::shared_ptr<Blueprint>>                   m_entries;
+};
+
+//Compile a plan into a flow graph without any editor node, blueprint nodes
+//are looked up in library
+void  buildFlow(FlowGraph& flow, const FactoryPlan& plan, const Catalog& catalog
+    , const BlueprintLibrary* library = nullptr);
+
+struct  BlueprintNode: public StatorNode {
+  BlueprintNode(std::shared_ptr<Blueprint> a_blueprint, double a_scale = 1.0): blueprint(a_blueprint), scale(a_scale) {
+    blueprint->instances++;
+    setTitle(blueprint->name);
+    setStyle(NodeStyle::cyan());
+    for (int i = 0; i < blueprint->outputNames.size(); i++) {
+      addOUT<double>(blueprint->outputNames[i])->behaviour([this, i]() {
+        return (scale * blueprint->outputRates[i]);
+      });
+    }
+  }
+  ~BlueprintNode() {
+    blueprint->instances--;
+  }
+
+  void  draw() override {
+    ImGui::SetNextItemWidth(100.f);
+    if (ImGui::InputDouble("x##scale", &scale))
+      valueChanged();
+    ImGui::Text("%lf MW", scale * blueprint->power);
+  }
+
+  void  drawPopUp() override {
+    ImGui::Separator();
+    ImGui::Text("Blueprint %s", blueprint->hashString().c_str());
+    ImGui::Text("Instances: %d", blueprint->instances);
+  }
+
+  StatorNodeType  statorNodeType() override {
+    return (SNT_BLUEPRINT_NODE);
+  };
+
+  json::value     toJson() override {
+    json::object value = {
+      {"type", "SNT_BLUEPRINT_NODE"},
+      {"blueprint", blueprint->hashString()},
+      {"scale", scale},
+    };
+    return (value);
+  }
+  void            fromJson(json::value value) override {
+    scale = jsonNumber(value.as_object()["scale"]);
+  }
+
+  std::shared_ptr<Blueprint>  blueprint;
+  double                      scale;
+};
@@ -0,0 +1,48 @@
+#include "catalog.hpp"
+#include "memoryTracker.hpp"
+
+CatalogRef  Catalog::build(std::vector<Part> parts, std::vector<Recipe> recipes) {
+  MemoryScope               memory(MS_CATALOG);
+  std::shared_ptr<Catalog>  catalog(new Catalog());
+  catalog->m_parts = std::move(parts);
+  catalog->m_recipes = std::move(recipes);
+
+  auto& partIndex = catalog->m_partIndex;
+  partIndex.reserve(catalog->m_parts.size());
+  for (int i = 0; i < catalog->m_parts.size(); i++) {
+    Part& part = catalog->m_parts[i];
+    part.recipes.clear();
+    if (!part.removed)
+      partIndex[part.name] = i;
+  }
+  auto  resolve = [&](std::vector<PartWithQuantity>& quantities) {
+    for (auto& quantity: quantities) {
+      auto it = partIndex.find(quantity.name);
+      quantity.part = it != partIndex.end() ? it->second : -1;
+    }
+  };
+  catalog->m_recipeIndex.reserve(catalog->m_recipes.size());
+  for (int i = 0; i < catalog->m_recipes.size(); i++) {
+    Recipe& recipe = catalog->m_recipes[i];
+    resolve(recipe.inputs);
+    resolve(recipe.outputs);
+    if (recipe.removed)
+      continue ;
+    catalog->m_recipeIndex[recipe.id] = i;
+    for (auto& out: recipe.outputs) {
+      if (out.part >= 0)
+        catalog->m_parts[out.part].recipes.push_back(i);
+    }
+  }
+  return (catalog);
+}
+
+int   Catalog::findPart(std::string_view name) const {
+  auto it = m_partIndex.find(name);
+  return (it != m_partIndex.end() ? it->second : -1);
+}
+
+int   Catalog::findRecipe(int id) const {
+  auto it = m_recipeIndex.find(id);
+  return (it != m_recipeIndex.end() ? it->second : -1);
+}
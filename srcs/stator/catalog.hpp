@@ -0,0 +1,77 @@
+#pragma once
+
+#include "stator/stator.hpp"
+#include <atomic>
+#include <memory>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+class Catalog;
+
+using CatalogRef = std::shared_ptr<const Catalog>;
+
+//Parts and recipes linked and indexed once then never modified, so any
+//number of documents and worker threads read the same one without locking.
+//A reload builds a new catalog, whoever holds the old one keeps a
+//consistent view of it until they let go.
+class Catalog {
+  public:
+    Catalog(const Catalog&) = delete;
+    Catalog&  operator=(const Catalog&) = delete;
+
+    //Fill every Part::recipes and PartWithQuantity::part and index names and ids
+    static CatalogRef   build(std::vector<Part> parts, std::vector<Recipe> recipes);
+
+    const std::vector<Part>&    parts() const {return (m_parts);}
+    const std::vector<Recipe>&  recipes() const {return (m_recipes);}
+    template<typename T>
+    const std::vector<T>&       entries() const;
+
+    //Index of a live entry, -1 if unknown or removed
+    int   findPart(std::string_view name) const;
+    int   findRecipe(int id) const;
+
+  private:
+    Catalog() = default;
+
+    std::vector<Part>                         m_parts;
+    std::vector<Recipe>                       m_recipes;
+    std::unordered_map<std::string_view, int> m_partIndex;    //Keys view the pooled names
+    std::unordered_map<int, int>              m_recipeIndex;
+};
+
+template<>
+inline const std::vector<Part>&   Catalog::entries<Part>() const {return (m_parts);}
+template<>
+inline const std::vector<Recipe>& Catalog::entries<Recipe>() const {return (m_recipes);}
+
+//Where the current catalog is published. Readers load() a reference and
+//keep using it for as long as they need, a reload store()s the next one
+//without waiting for them.
+class CatalogSlot {
+  public:
+    CatalogRef  load() const {return (std::atomic_load(&m_catalog));}
+    void        store(CatalogRef catalog) {std::atomic_store(&m_catalog, std::move(catalog));}
+
+  private:
+    CatalogRef  m_catalog;
+};
+
+//Catalog entry addressed by its index. The handle holds its catalog, nodes
+//are moved to the next one by FactoryNode::catalogChanged.
+template<typename T>
+struct  CatalogHandle {
+  CatalogHandle(CatalogRef a_catalog, int a_index): catalog(std::move(a_catalog)), index(a_index) {}
+  CatalogHandle(CatalogRef a_catalog, const T& entry)
+    : catalog(std::move(a_catalog)), index(&entry - catalog->template entries<T>().data()) {}
+
+  const T&  operator*() const {return (catalog->template entries<T>()[index]);}
+  const T*  operator->() const {return (&catalog->template entries<T>()[index]);}
+
+  CatalogRef  catalog;
+  int         index;
+};
+
+using PartHandle = CatalogHandle<Part>;
+using RecipeHandle = CatalogHandle<Recipe>;
@@ -0,0 +1,285 @@
+#include "catalogLoader.hpp"
+#include "memoryTracker.hpp"
+#include <boost/json/parse.hpp>
+#include <climits>
+#include <filesystem>
+#include <fstream>
+#include <unordered_map>
+#ifdef __linux__
+# include <sys/inotify.h>
+# include <unistd.h>
+#endif
+
+static bool   readQuantities(const json::object& recipe, std::string_view key, std::vector<PartWithQuantity>& out
+    , const std::string& path, LoadReport& report) {
+  const json::value*  list = readField(recipe, key, path, report, true);
+  if (list == nullptr)
+    return (false);
+  if (!list->is_array()) {
+    report.error(fieldPath(path, key), "expected an array");
+    return (false);
+  }
+  bool  valid = true;
+  for (size_t i = 0; i < list->as_array().size(); i++) {
+    const json::value&  entry = list->as_array()[i];
+    PartWithQuantity    quantity;
+    std::string         name;
+    if (!entry.is_object()) {
+      report.error(indexPath(path, key, i), "expected an object");
+      valid = false;
+      continue ;
+    }
+    std::string entryPath = indexPath(path, key, i);
+    bool        named = readString(entry.as_object(), "Part", name, entryPath, report);
+    bool        counted = readNumber(entry.as_object(), "Quantity", quantity.quantity, entryPath, report);
+    if (!named || !counted) {
+      valid = false;
+      continue ;
+    }
+    if (quantity.quantity <= 0.0) {
+      report.error(fieldPath(entryPath, "Quantity"), "must be positive");
+      valid = false;
+      continue ;
+    }
+    quantity.name = name;
+    out.push_back(std::move(quantity));
+  }
+  return (valid);
+}
+
+std::vector<Part>     readParts(const json::value& document, LoadReport& report) {
+  MemoryScope                           memory(MS_CATALOG);
+  std::vector<Part>                     parts;
+  std::unordered_map<PooledString, int> names;
+  const json::value*                    list = document.is_object() ? document.as_object().if_contains("parts") : nullptr;
+
+  if (list == nullptr || !list->is_array()) {
+    report.error("parts", "expected an array");
+    return (parts);
+  }
+  parts.reserve(list->as_array().size());
+  for (size_t i = 0; i < list->as_array().size(); i++) {
+    const json::value&  entry = list->as_array()[i];
+    std::string         path = indexPath("", "parts", i);
+    Part                part;
+    std::string         name;
+    std::string         imgPath;
+    if (!entry.is_object()) {
+      report.error(path, "expected an object");
+      continue ;
+    }
+    const json::object& obj = entry.as_object();
+    //Every field is checked so one pass reports all of them
+    bool  valid = readString(obj, "name", name, path, report);
+    readString(obj, "img", imgPath, path, report, false);
+    part.name = name;
+    part.imgPath = imgPath;
+    readNumber(obj, "energy", part.energy, path, report, false);
+    if (part.energy < 0.0) {
+      report.error(fieldPath(path, "energy"), "must not be negative");
+      part.energy = 0.0;
+    }
+    if (valid && !names.emplace(part.name, i).second) {
+      report.error(fieldPath(path, "name"), "duplicate of parts[" + std::to_string(names[part.name]) + "]");
+      valid = false;
+    }
+    if (valid)
+      parts.push_back(std::move(part));
+  }
+  return (parts);
+}
+
+std::vector<Recipe>   readRecipes(const json::value& document, LoadReport& report) {
+  MemoryScope                   memory(MS_CATALOG);
+  std::vector<Recipe>           recipes;
+  std::unordered_map<int, int>  ids;
+  const json::value*            list = document.is_object() ? document.as_object().if_contains("recipes") : nullptr;
+
+  if (list == nullptr || !list->is_array()) {
+    report.error("recipes", "expected an array");
+    return (recipes);
+  }
+  recipes.reserve(list->as_array().size());
+  for (size_t i = 0; i < list->as_array().size(); i++) {
+    const json::value&  entry = list->as_array()[i];
+    std::string         path = indexPath("", "recipes", i);
+    Recipe              recipe;
+    int64_t             id = 0;
+    if (!entry.is_object()) {
+      report.error(path, "expected an object");
+      continue ;
+    }
+    const json::object& obj = entry.as_object();
+    bool  valid = readInteger(obj, "RecipeId", id, path, report);
+    if (valid && (id < INT_MIN || id > INT_MAX)) {
+      report.error(fieldPath(path, "RecipeId"), "out of range");
+      valid = false;
+    }
+    readNumber(obj, "Power", recipe.power, path, report, false);
+    valid &= readQuantities(obj, "Input", recipe.inputs, path, report);
+    valid &= readQuantities(obj, "Output", recipe.outputs, path, report);
+    recipe.id = id;
+    if (valid && recipe.outputs.empty()) {
+      report.error(fieldPath(path, "Output"), "a recipe must produce something");
+      valid = false;
+    }
+    if (valid && !ids.emplace(recipe.id, i).second) {
+      report.error(fieldPath(path, "RecipeId"), "duplicate of recipes[" + std::to_string(ids[recipe.id]) + "]");
+      valid = false;
+    }
+    if (valid)
+      recipes.push_back(std::move(recipe));
+  }
+  return (recipes);
+}
+
+static json::value  readJsonFile(const std::string& path) {
+  MemoryScope   memory(MS_SERIALIZATION);
+  std::ifstream file(path);
+  if (!file)
+    throw std::runtime_error(path + ": can't open file");
+  return (json::parse(file));
+}
+
+std::vector<Part>     loadParts(const std::string& path, LoadReport& report) {
+  return (readParts(readJsonFile(path), report));
+}
+
+std::vector<Recipe>   loadRecipes(const std::string& path, LoadReport& report) {
+  return (readRecipes(readJsonFile(path), report));
+}
+
+static bool   sameQuantities(const std::vector<PartWithQuantity>& a, const std::vector<PartWithQuantity>& b) {
+  if (a.size() != b.size())
+    return (false);
+  for (int i = 0; i < a.size(); i++) {
+    if (a[i].name != b[i].name || a[i].quantity != b[i].quantity)
+      return (false);
+  }
+  return (true);
+}
+
+CatalogDiff   applyCatalog(const Catalog& current, std::vector<Part> loadedParts, std::vector<Recipe> loadedRecipes
+    , CatalogRef& next) {
+  std::vector<Part>                     parts = current.parts();
+  std::vector<Recipe>                   recipes = current.recipes();
+  CatalogDiff                           diff;
+  std::unordered_map<PooledString, int> partIndex;
+  std::unordered_map<int, int>          recipeIndex;
+  std::vector<char>                     seenParts(parts.size(), 0);
+  std::vector<char>                     seenRecipes(recipes.size(), 0);
+
+  for (int i = 0; i < parts.size(); i++)
+    partIndex[parts[i].name] = i;
+  for (auto& loaded: loadedParts) {
+    auto it = partIndex.find(loaded.name);
+    if (it == partIndex.end()) {
+      diff.addedParts.push_back(parts.size());
+      parts.push_back(std::move(loaded));
+      continue ;
+    }
+    Part& part = parts[it->second];
+    seenParts[it->second] = 1;
+    if (part.removed || part.energy != loaded.energy || part.imgPath != loaded.imgPath) {
+      part.energy = loaded.energy;
+      part.imgPath = loaded.imgPath;
+      part.removed = false;
+      diff.changedParts.push_back(it->second);
+    }
+  }
+  for (int i = 0; i < seenParts.size(); i++) {
+    if (!seenParts[i] && !parts[i].removed) {
+      parts[i].removed = true;
+      diff.removedParts.push_back(i);
+    }
+  }
+
+  for (int i = 0; i < recipes.size(); i++)
+    recipeIndex[recipes[i].id] = i;
+  for (auto& loaded: loadedRecipes) {
+    auto it = recipeIndex.find(loaded.id);
+    if (it == recipeIndex.end()) {
+      diff.addedRecipes.push_back(recipes.size());
+      recipes.push_back(std::move(loaded));
+      continue ;
+    }
+    Recipe& recipe = recipes[it->second];
+    seenRecipes[it->second] = 1;
+    if (recipe.removed || recipe.power != loaded.power || !sameQuantities(recipe.inputs, loaded.inputs)
+        || !sameQuantities(recipe.outputs, loaded.outputs)) {
+      recipe.power = loaded.power;
+      recipe.inputs = std::move(loaded.inputs);
+      recipe.outputs = std::move(loaded.outputs);
+      recipe.removed = false;
+      diff.changedRecipes.push_back(it->second);
+    }
+  }
+  for (int i = 0; i < seenRecipes.size(); i++) {
+    if (!seenRecipes[i] && !recipes[i].removed) {
+      recipes[i].removed = true;
+      diff.removedRecipes.push_back(i);
+    }
+  }
+  if (!diff.empty())
+    next = Catalog::build(std::move(parts), std::move(recipes));
+  return (diff);
+}
+
+#ifdef __linux__
+
+CatalogWatcher::~CatalogWatcher() {
+  if (m_fd >= 0)
+    close(m_fd);
+}
+
+bool  CatalogWatcher::watch(const std::vector<std::string>& paths, double delay) {
+  if (m_fd >= 0)
+    close(m_fd);
+  m_watches.clear();
+  m_files.clear();
+  m_pendingSince = -1.0;
+  m_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (m_fd < 0)
+    return (false);
+  m_delay = delay;
+  for (auto& path: paths) {
+    std::filesystem::path file = std::filesystem::absolute(path);
+    m_files.push_back(file.filename().string());
+    int watch = inotify_add_watch(m_fd, file.parent_path().c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (watch >= 0)
+      m_watches.push_back(watch);
+  }
+  return (!m_watches.empty());
+}
+
+bool  CatalogWatcher::poll(double now) {
+  alignas(inotify_event) char buffer[4096];
+  ssize_t                     length;
+
+  if (m_fd < 0)
+    return (false);
+  while ((length = read(m_fd, buffer, sizeof(buffer))) > 0) {
+    for (char* p = buffer; p < buffer + length; ) {
+      auto  event = reinterpret_cast<inotify_event*>(p);
+      if (event->len > 0) {
+        for (auto& file: m_files) {
+          if (file == event->name)
+            m_pendingSince = now;
+        }
+      }
+      p += sizeof(inotify_event) + event->len;
+    }
+  }
+  if (m_pendingSince < 0.0 || now - m_pendingSince < m_delay)
+    return (false);
+  m_pendingSince = -1.0;
+  return (true);
+}
+
+#else
+
+CatalogWatcher::~CatalogWatcher() {}
+bool  CatalogWatcher::watch(const std::vector<std::string>& paths, double delay) {return (false);}
+bool  CatalogWatcher::poll(double now) {return (false);}
+
+#endif
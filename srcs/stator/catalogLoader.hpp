@@ -0,0 +1,57 @@
+#pragma once
+
+#include "stator/stator.hpp"
+#include "catalog.hpp"
+#include "loadReport.hpp"
+#include <string>
+#include <vector>
+
+//Validating readers: invalid entries (missing or mistyped fields, duplicate
+//names or ids) are reported with their JSON path and left out, the rest is
+//kept. load* throw when the file can't be read or isn't JSON at all.
+std::vector<Part>     readParts(const json::value& document, LoadReport& report);
+std::vector<Recipe>   readRecipes(const json::value& document, LoadReport& report);
+std::vector<Part>     loadParts(const std::string& path, LoadReport& report);
+std::vector<Recipe>   loadRecipes(const std::string& path, LoadReport& report);
+
+//Indices in the catalog of what a reload touched
+struct  CatalogDiff {
+  bool  empty() const {
+    return (changedParts.empty() && addedParts.empty() && removedParts.empty()
+        && changedRecipes.empty() && addedRecipes.empty() && removedRecipes.empty());
+  }
+
+  std::vector<int>  changedParts;
+  std::vector<int>  addedParts;
+  std::vector<int>  removedParts;
+  std::vector<int>  changedRecipes;
+  std::vector<int>  addedRecipes;
+  std::vector<int>  removedRecipes;
+};
+
+//Build the catalog following current from a freshly loaded one. Parts are
+//matched by name and recipes by id and keep their index, new entries are
+//appended and removed ones only flagged, so indices held by nodes stay
+//valid in next. next is left alone when nothing changed.
+CatalogDiff   applyCatalog(const Catalog& current, std::vector<Part> loadedParts, std::vector<Recipe> loadedRecipes
+    , CatalogRef& next);
+
+//Watches the directories of the catalog files with inotify. Editors often
+//write through a temporary file and a rename, so both are caught, and a
+//burst of events only reports once things went quiet for `delay` seconds.
+class CatalogWatcher {
+  public:
+    ~CatalogWatcher();
+
+    //Replaces what was watched before
+    bool  watch(const std::vector<std::string>& paths, double delay = 0.2);
+    //Non blocking, true once when a watched file changed
+    bool  poll(double now);
+
+  private:
+    int                       m_fd = -1;
+    std::vector<int>          m_watches;
+    std::vector<std::string>  m_files;
+    double                    m_delay = 0.2;
+    double                    m_pendingSince = -1.0;
+};
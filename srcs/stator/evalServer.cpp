@@ -0,0 +1,675 @@
+#include "evalServer.hpp"
+#include "blueprint.hpp"
+#include "factoryGenerator.hpp"
+#include <boost/json/parse.hpp>
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static volatile std::sig_atomic_t s_interrupted = 0;
+
+static void   onSignal(int) {
+  s_interrupted = 1;
+}
+
+static const json::value&   requireField(const json::object& obj, std::string_view key) {
+  const json::value*  value = obj.if_contains(key);
+  if (value == nullptr)
+    throw std::runtime_error("missing \"" + std::string(key) + "\"");
+  return (*value);
+}
+
+static std::string  requireString(const json::object& obj, std::string_view key) {
+  const json::value&  value = requireField(obj, key);
+  if (!value.is_string())
+    throw std::runtime_error("\"" + std::string(key) + "\" must be a string");
+  return (value.as_string().c_str());
+}
+
+static double   requireNumber(const json::value& value, std::string_view what) {
+  if (!value.is_number())
+    throw std::runtime_error(std::string(what) + " must be a number");
+  return (jsonNumber(value));
+}
+
+static int  requirePart(const Catalog& catalog, const json::value& value) {
+  if (!value.is_string())
+    throw std::runtime_error("part names must be strings");
+  int part = catalog.findPart(std::string_view(value.as_string().data(), value.as_string().size()));
+  if (part < 0)
+    throw std::runtime_error("unknown part \"" + std::string(value.as_string().c_str()) + "\"");
+  return (part);
+}
+
+static uint64_t   nodeId(std::string_view key) {
+  uint64_t  id = 0;
+  for (char c: key) {
+    if (c < '0' || c > '9')
+      throw std::runtime_error("bad node id \"" + std::string(key) + "\"");
+    id = id * 10 + (c - '0');
+  }
+  return (id);
+}
+
+static uint64_t   nodeId(const json::value& value) {
+  if (value.is_uint64())
+    return (value.as_uint64());
+  if (value.is_int64() && value.as_int64() >= 0)
+    return (value.as_int64());
+  throw std::runtime_error("node ids must be unsigned integers");
+}
+
+EvalServer::Connection::~Connection() {
+  if (fd >= 0)
+    close(fd);
+}
+
+void  EvalServer::reloadCatalog() {
+  LoadReport          report;
+  std::vector<Part>   parts = loadParts(m_partsPath, report);
+  std::vector<Recipe> recipes = loadRecipes(m_recipesPath, report);
+  CatalogRef          current = m_catalog.load();
+  CatalogRef          next;
+
+  if (!report.empty())
+    std::cerr << "Skipped invalid catalog entries:\n" << report.format();
+  //Keep the indices of what didn't go away, like the editor does
+  if (current == nullptr)
+    next = Catalog::build(std::move(parts), std::move(recipes));
+  else if (applyCatalog(*current, std::move(parts), std::move(recipes), next).empty())
+    return ;
+  m_catalog.store(next);
+}
+
+int   EvalServer::run(const std::string& socketPath, int workers) {
+  try {
+    reloadCatalog();
+  }
+  catch (const std::exception& e) {
+    std::cerr << e.what() << std::endl;
+    return (1);
+  }
+  if (!listen(socketPath))
+    return (1);
+  m_watcher.watch({m_partsPath, m_recipesPath});
+  std::signal(SIGINT, onSignal);
+  std::signal(SIGTERM, onSignal);
+  std::signal(SIGPIPE, SIG_IGN);
+
+  if (workers <= 0)
+    workers = std::max(1u, std::thread::hardware_concurrency());
+  for (int i = 0; i < workers; i++)
+    m_workers.emplace_back(&EvalServer::work, this);
+  std::cerr << "Serving on " << socketPath << " with " << workers << " workers" << std::endl;
+  serve();
+
+  {
+    std::lock_guard<std::mutex> lock(m_jobsMutex);
+    m_stop = true;
+  }
+  m_jobsReady.notify_all();
+  for (auto& worker: m_workers)
+    worker.join();
+  m_workers.clear();
+  close(m_listenFd);
+  m_listenFd = -1;
+  unlink(socketPath.c_str());
+  return (0);
+}
+
+bool  EvalServer::listen(const std::string& socketPath) {
+  sockaddr_un address = {};
+  struct stat info;
+
+  if (socketPath.size() >= sizeof(address.sun_path)) {
+    std::cerr << socketPath << ": socket path too long" << std::endl;
+    return (false);
+  }
+  //A socket left behind by a previous run, anything else is not ours to remove
+  if (lstat(socketPath.c_str(), &info) == 0 && S_ISSOCK(info.st_mode))
+    unlink(socketPath.c_str());
+  address.sun_family = AF_UNIX;
+  std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+  m_listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC | SOCK_NONBLOCK, 0);
+  if (m_listenFd < 0 || bind(m_listenFd, (sockaddr*)&address, sizeof(address)) < 0 || ::listen(m_listenFd, 64) < 0) {
+    std::cerr << socketPath << ": " << std::strerror(errno) << std::endl;
+    if (m_listenFd >= 0)
+      close(m_listenFd);
+    m_listenFd = -1;
+    return (false);
+  }
+  return (true);
+}
+
+//One thread reads every connection and queues whole frames, the workers
+//answer them and write back under the connection's lock
+void  EvalServer::serve() {
+  std::vector<std::shared_ptr<Connection>>  connections;
+  std::vector<pollfd>                       fds;
+
+  while (!m_stop && !s_interrupted) {
+    fds.assign(1, {m_listenFd, POLLIN, 0});
+    for (auto& connection: connections)
+      fds.push_back({connection->fd, POLLIN, 0});
+    if (poll(fds.data(), fds.size(), 250) < 0 && errno != EINTR)
+      break ;
+
+    double  now = std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    if (m_watcher.poll(now)) {
+      try {
+        reloadCatalog();
+      }
+      catch (const std::exception& e) {
+        std::cerr << "Catalog reload failed, keeping the current one: " << e.what() << std::endl;
+      }
+    }
+
+    //Connections whose client is gone are dropped here, their fd closes once
+    //the last queued job for them is answered
+    size_t  kept = 0;
+    for (size_t i = 0; i < connections.size(); i++) {
+      bool  open = true;
+      if (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))
+        open = readFrames(*connections[i], connections[i]);
+      if (open)
+        connections[kept++] = connections[i];
+    }
+    connections.resize(kept);
+
+    if (fds[0].revents & POLLIN) {
+      int fd;
+      while ((fd = accept4(m_listenFd, nullptr, nullptr, SOCK_CLOEXEC | SOCK_NONBLOCK)) >= 0) {
+        auto  connection = std::make_shared<Connection>();
+        connection->fd = fd;
+        connections.push_back(connection);
+      }
+    }
+  }
+}
+
+//Returns false once the connection can't be read anymore
+bool  EvalServer::readFrames(Connection& connection, const std::shared_ptr<Connection>& ref) {
+  char  buffer[65536];
+
+  while (true) {
+    ssize_t size = recv(connection.fd, buffer, sizeof(buffer), 0);
+    if (size == 0)
+      return (false);
+    if (size < 0)
+      return (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+    connection.input.append(buffer, size);
+
+    size_t  offset = 0;
+    while (connection.input.size() - offset >= 4) {
+      const unsigned char*  header = (const unsigned char*)connection.input.data() + offset;
+      uint32_t              length = header[0] | header[1] << 8 | header[2] << 16 | (uint32_t)header[3] << 24;
+      if (length > maxFrame)
+        return (false);
+      if (connection.input.size() - offset - 4 < length)
+        break ;
+      {
+        std::lock_guard<std::mutex> lock(m_jobsMutex);
+        m_jobs.push_back({ref, connection.input.substr(offset + 4, length)});
+      }
+      m_jobsReady.notify_one();
+      offset += 4 + length;
+    }
+    connection.input.erase(0, offset);
+  }
+}
+
+void  EvalServer::work() {
+  Worker  worker;
+
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex>  lock(m_jobsMutex);
+      m_jobsReady.wait(lock, [this](){return (m_stop || !m_jobs.empty());});
+      if (m_jobs.empty())
+        return ;
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+    }
+    send(*job.connection, handleFrame(worker, job.frame));
+  }
+}
+
+void  EvalServer::send(Connection& connection, const std::string& payload) {
+  std::lock_guard<std::mutex> lock(connection.writeMutex);
+  uint32_t                    length = payload.size();
+  unsigned char               header[4] = {(unsigned char)length, (unsigned char)(length >> 8)
+    , (unsigned char)(length >> 16), (unsigned char)(length >> 24)};
+  const char*                 parts[2] = {(const char*)header, payload.data()};
+  size_t                      sizes[2] = {4, payload.size()};
+
+  for (int part = 0; part < 2 && !connection.broken; part++) {
+    size_t  sent = 0;
+    while (sent < sizes[part]) {
+      ssize_t size = ::send(connection.fd, parts[part] + sent, sizes[part] - sent, MSG_NOSIGNAL);
+      if (size >= 0) {
+        sent += size;
+        continue ;
+      }
+      //The socket is non blocking for the reader, wait for the client to drain it
+      pollfd  fd = {connection.fd, POLLOUT, 0};
+      if ((errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) || (errno != EINTR && poll(&fd, 1, 5000) <= 0)) {
+        connection.broken = true;
+        break ;
+      }
+    }
+  }
+}
+
+std::string   EvalServer::handleFrame(Worker& worker, const std::string& frame) {
+  json::error_code  error;
+  json::value       request = json::parse(frame, error);
+
+  evictCopies(worker);
+
+  if (error)
+    return (json::serialize(json::object{{"id", nullptr}, {"ok", false}, {"error", "invalid JSON: " + error.message()}}));
+  if (!request.is_array())
+    return (json::serialize(handle(worker, request)));
+  json::array responses;
+  responses.reserve(request.as_array().size());
+  for (auto& entry: request.as_array())
+    responses.push_back(handle(worker, entry));
+  return (json::serialize(responses));
+}
+
+json::object  EvalServer::handle(Worker& worker, const json::value& request) {
+  json::object  response;
+  const json::value*  id = request.is_object() ? request.as_object().if_contains("id") : nullptr;
+
+  try {
+    if (!request.is_object())
+      throw std::runtime_error("a request must be an object");
+    const json::object& obj = request.as_object();
+    std::string         op = requireString(obj, "op");
+    if (op == "evaluate")
+      response = evaluate(worker, obj);
+    else if (op == "solve")
+      response = solve(worker, obj);
+    else if (op == "reach")
+      response = reach(worker, obj);
+    else if (op == "rawCost")
+      response = rawCost(worker, obj);
+    else if (op == "diff")
+      response = diff(obj);
+    else if (op == "layout")
+      response = layout(obj);
+    else if (op == "sensitivity")
+      response = sensitivity(obj);
+    else if (op == "load")
+      response = load(obj);
+    else if (op == "unload") {
+      std::lock_guard<std::mutex> lock(m_residentsMutex);
+      response["unloaded"] = m_residents.erase(requireString(obj, "factory")) > 0;
+      m_residentsGeneration++;
+    }
+    else if (op == "reload")
+      reloadCatalog();
+    else if (op == "shutdown")
+      stop();
+    else
+      throw std::runtime_error("unknown op \"" + op + "\"");
+    response["ok"] = true;
+  }
+  catch (const std::exception& e) {
+    response = json::object();
+    response["ok"] = false;
+    response["error"] = e.what();
+  }
+  response["id"] = id != nullptr ? *id : json::value(nullptr);
+  return (response);
+}
+
+//Copies of factories unloaded or loaded again since the worker last looked
+//would keep the old resident alive until their name is evaluated again
+void  EvalServer::evictCopies(Worker& worker) {
+  if (worker.generation == m_residentsGeneration)
+    return ;
+  std::lock_guard<std::mutex> lock(m_residentsMutex);
+  for (auto it = worker.copies.begin(); it != worker.copies.end();) {
+    auto  resident = m_residents.find(it->first);
+    if (resident == m_residents.end() || resident->second != it->second.source)
+      it = worker.copies.erase(it);
+    else
+      it++;
+  }
+  worker.generation = m_residentsGeneration;
+}
+
+EvalServer::ResidentRef   EvalServer::resident(const std::string& name) {
+  std::lock_guard<std::mutex> lock(m_residentsMutex);
+  auto                        it = m_residents.find(name);
+  if (it == m_residents.end())
+    throw std::runtime_error("no factory \"" + name + "\" loaded");
+  return (it->second);
+}
+
+//Parse and compile outside of any lock, a reload of the same name replaces
+//the previous one for the requests that come after
+json::object  EvalServer::load(const json::object& request) {
+  std::string               name = requireString(request, "factory");
+  auto                      loaded = std::make_shared<Resident>();
+  LoadReport                report;
+
+  loaded->catalog = m_catalog.load();
+  if (auto save = request.if_contains("save"); save != nullptr)
+    loadSnapshot(loaded->snapshot, *save, *loaded->catalog, &report);
+  else
+    loadSnapshotFile(loaded->snapshot, requireString(request, "path"), *loaded->catalog, &report);
+  const FactoryPlan&  plan = loaded->snapshot.plan;
+  for (int i = 0; i < plan.nodes.size(); i++) {
+    if (plan.nodes[i].id != 0)
+      loaded->ids[plan.nodes[i].id] = i;
+    if (plan.nodes[i].type == SNT_OUT_NODE)
+      loaded->outputs.push_back(i);
+  }
+  {
+    std::lock_guard<std::mutex> lock(m_residentsMutex);
+    m_residents[name] = std::move(loaded);
+    m_residentsGeneration++;
+  }
+  json::array skipped;
+  for (auto& issue: report.issues())
+    skipped.push_back(json::string(issue.path + ": " + issue.message));
+  return (json::object{{"nodes", plan.nodes.size()}, {"links", plan.links.size()}, {"skipped", skipped}});
+}
+
+//Apply the overrides to the worker's copy, read the results and put the
+//copy back as loaded. Both go through FlowGraph::update, so only the region
+//downstream and upstream of the overrides is solved again. The power totals
+//are recounted once restored, the next request starts from the exact ones.
+json::object  EvalServer::evaluate(Worker& worker, const json::object& request) {
+  std::string         name = requireString(request, "factory");
+  ResidentRef         source = resident(name);
+  Worker::Copy&       copy = worker.copies[name];
+  struct  Saved {
+    int                 node;
+    double              value;
+    std::vector<double> ratios;
+  };
+  struct  SavedCap {
+    int     node;
+    int     pin;
+    double  cap;
+  };
+  std::vector<Saved>    saved;
+  std::vector<SavedCap> savedCaps;
+
+  if (copy.source != source) {
+    copy.source = source;
+    copy.flow = source->snapshot.flow;
+    copy.power.reset(copy.flow);
+  }
+  FlowGraph&  flow = copy.flow;
+  auto        indexOf = [&source](uint64_t id) {
+    auto it = source->ids.find(id);
+    if (it == source->ids.end())
+      throw std::runtime_error("no node " + std::to_string(id));
+    return (it->second);
+  };
+  //Backwards, a node overridden twice gets what it had before the first one
+  auto        restore = [&]() {
+    for (auto it = saved.rbegin(); it != saved.rend(); it++) {
+      flow.nodes()[it->node].value = it->value;
+      flow.nodes()[it->node].ratios = std::move(it->ratios);
+      flow.markDirty(it->node);
+    }
+    for (auto it = savedCaps.rbegin(); it != savedCaps.rend(); it++)
+      flow.setCap(it->node, it->pin, it->cap);
+    copy.power.update(flow, flow.update());
+    copy.power.recount();
+  };
+
+  json::object  response;
+  try {
+    if (auto values = request.if_contains("values"); values != nullptr) {
+      if (!values->is_object())
+        throw std::runtime_error("\"values\" must be an object");
+      for (auto& entry: values->as_object()) {
+        int index = indexOf(nodeId(entry.key()));
+        FlowNode& node = flow.nodes()[index];
+        saved.push_back({index, node.value, node.ratios});
+        node.value = requireNumber(entry.value(), "values");
+        flow.markDirty(index);
+      }
+    }
+    if (auto ratios = request.if_contains("ratios"); ratios != nullptr) {
+      if (!ratios->is_object())
+        throw std::runtime_error("\"ratios\" must be an object");
+      for (auto& entry: ratios->as_object()) {
+        int         index = indexOf(nodeId(entry.key()));
+        FlowNode&   node = flow.nodes()[index];
+        const auto* list = entry.value().if_array();
+        if (node.type != SNT_PART_NODE || list == nullptr || list->size() != node.ratios.size())
+          throw std::runtime_error("node " + std::string(entry.key()) + " takes " + std::to_string(node.ratios.size()) + " ratios");
+        saved.push_back({index, node.value, node.ratios});
+        for (int i = 0; i < list->size(); i++)
+          node.ratios[i] = requireNumber((*list)[i], "ratios");
+        flow.markDirty(index);
+      }
+    }
+    if (auto tiers = request.if_contains("tiers"); tiers != nullptr) {
+      if (!tiers->is_array())
+        throw std::runtime_error("\"tiers\" must be an array");
+      for (auto& entry: tiers->as_array()) {
+        const auto* tier = entry.if_array();
+        if (tier == nullptr || tier->size() != 3)
+          throw std::runtime_error("tiers are [node id, in pin, tier]");
+        int       index = indexOf(nodeId((*tier)[0]));
+        uint64_t  pin = nodeId((*tier)[1]);
+        uint64_t  level = nodeId((*tier)[2]);
+        if (pin >= flow.nodes()[index].caps.size() || level >= linkTierCount)
+          throw std::runtime_error("bad tier entry for node " + std::to_string(source->snapshot.plan.nodes[index].id));
+        savedCaps.push_back({index, (int)pin, flow.nodes()[index].caps[pin]});
+        flow.setCap(index, pin, linkTierCapacity(level));
+      }
+    }
+    copy.power.update(flow, flow.update());
+
+    json::array outputs;
+    for (int index: source->outputs)
+      outputs.push_back({{"id", source->snapshot.plan.nodes[index].id}, {"rate", flow.nodes()[index].rate}});
+    response["outputs"] = std::move(outputs);
+    if (auto watch = request.if_contains("watch"); watch != nullptr && watch->is_array()) {
+      json::object  rates;
+      for (auto& id: watch->as_array()) {
+        rates[std::to_string(nodeId(id))] = flow.nodes()[indexOf(nodeId(id))].rate;
+      }
+      response["rates"] = std::move(rates);
+    }
+    response["power"] = {{"generation", copy.power.generation()}, {"consumption", copy.power.consumption()}};
+  }
+  catch (...) {
+    restore();
+    throw ;
+  }
+  restore();
+  return (response);
+}
+
+json::object  EvalServer::solve(Worker& worker, const json::object& request) {
+  CatalogRef    catalog = m_catalog.load();
+  std::string   partName = requireString(request, "part");
+  double        rate = requireNumber(requireField(request, "rate"), "\"rate\"");
+  int           part = catalog->findPart(partName);
+  std::unordered_map<int, int>  alternates;
+
+  if (part < 0)
+    throw std::runtime_error("unknown part \"" + partName + "\"");
+  if (recipeGraph(worker, catalog).isRaw(part))
+    throw std::runtime_error("\"" + partName + "\" is a raw part");
+  if (auto chosen = request.if_contains("alternates"); chosen != nullptr && chosen->is_object()) {
+    for (auto& entry: chosen->as_object()) {
+      int alternatePart = catalog->findPart(std::string_view(entry.key().data(), entry.key().size()));
+      int recipe = catalog->findRecipe(nodeId(entry.value()));
+      if (alternatePart < 0 || recipe < 0)
+        throw std::runtime_error("unknown alternate " + std::string(entry.key()));
+      auto& outputs = catalog->recipes()[recipe].outputs;
+      if (std::none_of(outputs.begin(), outputs.end(), [&](auto& out) {return (out.part == alternatePart);}))
+        throw std::runtime_error("recipe " + std::to_string(catalog->recipes()[recipe].id) + " does not produce " + std::string(entry.key()));
+      alternates[alternatePart] = recipe;
+    }
+  }
+
+  FactoryPlan   plan = generateFactory(worker.graph, part, rate, alternates);
+  FlowGraph     flow;
+  PowerBalance  power;
+  buildFlow(flow, plan, *catalog);
+  power.reset(flow);
+
+  json::array inputs;
+  json::array recipes;
+  for (auto& link: plan.links) {
+    const FactoryPlan::Node&  from = plan.nodes[link.from];
+    const FactoryPlan::Node&  to = plan.nodes[link.to];
+    if (from.type != SNT_IN_NODE)
+      continue ;
+    const PooledString& input = to.type == SNT_PART_NODE ? catalog->parts()[to.part].name
+      : catalog->recipes()[to.recipe].inputs[link.toPin].name;
+    inputs.push_back({{"part", input.view()}, {"rate", from.value}});
+  }
+  for (int i = 0; i < plan.nodes.size(); i++) {
+    if (plan.nodes[i].type == SNT_RECIPE_NODE)
+      recipes.push_back({{"recipe", catalog->recipes()[plan.nodes[i].recipe].id}, {"buildings", flow.nodes()[i].rate}});
+  }
+  return (json::object{{"inputs", inputs}, {"recipes", recipes}, {"power", power.consumption()}});
+}
+
+RecipeGraph&  EvalServer::recipeGraph(Worker& worker, const CatalogRef& catalog) {
+  if (worker.graphCatalog != catalog) {
+    worker.graph = RecipeGraph();
+    worker.graph.build(*catalog);
+    worker.graphCatalog = catalog;
+  }
+  return (worker.graph);
+}
+
+json::object  EvalServer::reach(Worker& worker, const json::object& request) {
+  CatalogRef                catalog = m_catalog.load();
+  RecipeGraph&              graph = recipeGraph(worker, catalog);
+  RecipeGraph::Reachability reachability;
+
+  if (auto from = request.if_contains("from"); from != nullptr) {
+    if (!from->is_array())
+      throw std::runtime_error("\"from\" must be an array");
+    std::vector<int>  available;
+    for (auto& name: from->as_array())
+      available.push_back(requirePart(*catalog, name));
+    reachability = graph.reachableFrom(available);
+  }
+  else
+    reachability = graph.requiredFor(requirePart(*catalog, requireField(request, "for")));
+
+  json::array parts;
+  json::array recipes;
+  for (int i = 0; i < reachability.parts.size(); i++) {
+    if (reachability.parts[i] && !catalog->parts()[i].removed)
+      parts.push_back(json::string(catalog->parts()[i].name.view()));
+  }
+  for (int i = 0; i < reachability.recipes.size(); i++) {
+    if (reachability.recipes[i])
+      recipes.push_back(catalog->recipes()[i].id);
+  }
+  return (json::object{{"parts", parts}, {"recipes", recipes}});
+}
+
+json::object  EvalServer::rawCost(Worker& worker, const json::object& request) {
+  CatalogRef    catalog = m_catalog.load();
+  RecipeGraph&  graph = recipeGraph(worker, catalog);
+  int           part = requirePart(*catalog, requireField(request, "part"));
+  int           recipe = graph.defaultRecipe(part);
+
+  json::object  raw;
+  for (auto& [index, quantity]: graph.rawCost(part))
+    raw[catalog->parts()[index].name.view()] = quantity;
+  return (json::object{
+    {"depth", graph.depth(part)},
+    {"recipe", recipe >= 0 ? json::value(catalog->recipes()[recipe].id) : json::value(nullptr)},
+    {"raw", raw},
+  });
+}
+
+json::object  EvalServer::layout(const json::object& request) {
+  ResidentRef   source = resident(requireString(request, "factory"));
+  LayoutOptions options;
+
+  if (auto spacing = request.if_contains("layerSpacing"); spacing != nullptr)
+    options.layerSpacing = requireNumber(*spacing, "\"layerSpacing\"");
+  if (auto spacing = request.if_contains("nodeSpacing"); spacing != nullptr)
+    options.nodeSpacing = requireNumber(*spacing, "\"nodeSpacing\"");
+  std::vector<ImVec2> positions = planLayout(source->snapshot.plan, options);
+
+  json::object  nodes;
+  for (int i = 0; i < positions.size(); i++)
+    nodes[std::to_string(source->snapshot.plan.nodes[i].id)] = {positions[i].x, positions[i].y};
+  return (json::object{{"positions", nodes}});
+}
+
+json::object  EvalServer::diff(const json::object& request) {
+  ResidentRef before = resident(requireString(request, "before"));
+  ResidentRef after = resident(requireString(request, "after"));
+  FactoryDiff result = diffFactories(before->snapshot, after->snapshot, *after->catalog);
+
+  json::array nodes;
+  for (auto& node: result.nodes) {
+    json::array fields;
+    for (auto& field: node.fields)
+      fields.push_back(json::string(field));
+    nodes.push_back({{"before", node.before}, {"after", node.after}, {"label", node.label}, {"fields", fields}});
+  }
+  json::array outputs;
+  for (auto& output: result.outputs) {
+    outputs.push_back({{"label", output.label}, {"before", output.rateBefore}, {"after", output.rateAfter}});
+  }
+  return (json::object{
+    {"nodes", nodes},
+    {"outputs", outputs},
+    {"linksAdded", result.linksAdded},
+    {"linksRemoved", result.linksRemoved},
+    {"powerBefore", result.powerBefore},
+    {"powerAfter", result.powerAfter},
+  });
+}
+
+//Rows follow "outputs", columns "params": [node id, -1] for an InputNode
+//value, [node id, out pin] for a PartNode ratio
+json::object  EvalServer::sensitivity(const json::object& request) {
+  ResidentRef         source = resident(requireString(request, "factory"));
+  const FactoryPlan&  plan = source->snapshot.plan;
+  Sensitivity         result;
+
+  result.compute(source->snapshot.flow);
+  json::array outputs;
+  for (int node: result.outputs())
+    outputs.push_back(plan.nodes[node].id);
+  json::array params;
+  for (auto& param: result.params())
+    params.push_back(json::array{plan.nodes[param.node].id, param.pin});
+  json::array matrix;
+  std::vector<double> row(result.params().size());
+  for (int output = 0; output < result.outputs().size(); output++) {
+    std::fill(row.begin(), row.end(), 0.0);
+    for (auto entry = result.rowBegin(output); entry != result.rowEnd(output); entry++)
+      row[entry->param] = entry->value;
+    json::array values;
+    values.reserve(row.size());
+    for (double value: row)
+      values.push_back(value);
+    matrix.push_back(std::move(values));
+  }
+  return (json::object{{"outputs", outputs}, {"params", params}, {"matrix", matrix}});
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include "stator/stator.hpp"
+#include "catalog.hpp"
+#include "catalogLoader.hpp"
+#include "factoryDiff.hpp"
+#include "power.hpp"
+#include "recipeGraph.hpp"
+#include "sensitivity.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//Headless evaluation daemon keeping the catalog and loaded factories
+//resident. Clients talk to it over a Unix domain socket in frames: a 4 byte
+//little endian length then that many bytes of JSON, either one request or an
+//array of them answered by an array in the same order. Frames go to the
+//worker pool as soon as they are read, so a client may pipeline several and
+//match the responses, which can come back in any order, by their "id".
+//
+//  {"op": "load", "factory": name, "path": save file} or "save": {...}
+//  {"op": "unload", "factory": name}
+//  {"op": "evaluate", "factory": name, "values": {node id: value},
+//    "ratios": {node id: [ratio]}, "tiers": [[node id, in pin, tier]], "watch": [node id]}
+//  {"op": "solve", "part": name, "rate": per minute, "alternates": {part name: recipe id making it}}
+//  {"op": "reach", "from": [part name]}   parts and recipe ids buildable from these parts alone
+//  {"op": "reach", "for": part name}      parts and recipe ids that may go into producing it
+//  {"op": "rawCost", "part": name}        shallowest "depth" and its "recipe", "raw": {part name: per unit}
+//  {"op": "diff", "before": name, "after": name}
+//  {"op": "layout", "factory": name, "layerSpacing", "nodeSpacing"}   "positions": {node id: [x, y]}
+//  {"op": "sensitivity", "factory": name}   d output / d input, see Sensitivity
+//  {"op": "reload"}      read the catalog files again, also done when they change
+//  {"op": "shutdown"}
+//Responses are {"id", "ok": true, ...} or {"id", "ok": false, "error": message}.
+//Node ids are the ids saved with the factory.
+class EvalServer {
+  public:
+    static constexpr uint32_t maxFrame = 64u << 20;
+
+    EvalServer(std::string partsPath, std::string recipesPath)
+      : m_partsPath(std::move(partsPath)), m_recipesPath(std::move(recipesPath)) {}
+
+    //Serve until a shutdown request, SIGINT or SIGTERM. workers <= 0 uses
+    //one per hardware thread. Returns the process exit status.
+    int   run(const std::string& socketPath, int workers = 0);
+    void  stop() {m_stop = true;}
+
+  private:
+    //A factory as loaded, workers never modify it
+    struct  Resident {
+      CatalogRef                        catalog;
+      FactorySnapshot                   snapshot;
+      std::unordered_map<uint64_t, int> ids;      //Saved node id -> node index
+      std::vector<int>                  outputs;  //OutputNode indices
+    };
+    using ResidentRef = std::shared_ptr<const Resident>;
+
+    struct  Connection {
+      ~Connection();
+
+      int         fd = -1;
+      std::string input;            //Bytes of the frame being read, I/O thread only
+      std::mutex  writeMutex;
+      bool        broken = false;   //A write failed, under writeMutex
+    };
+
+    struct  Job {
+      std::shared_ptr<Connection> connection;
+      std::string                 frame;
+    };
+
+    //What a worker keeps between requests, evaluations run on its own copy
+    //of the factory's flow graph so they only re-solve what they change
+    struct  Worker {
+      struct  Copy {
+        ResidentRef   source;
+        FlowGraph     flow;
+        PowerBalance  power;
+      };
+      std::unordered_map<std::string, Copy> copies;
+      uint64_t                              generation = 0;   //Of the residents the copies were checked against
+      CatalogRef                            graphCatalog;
+      RecipeGraph                           graph;
+    };
+
+    void          reloadCatalog();
+    bool          listen(const std::string& socketPath);
+    void          serve();
+    bool          readFrames(Connection& connection, const std::shared_ptr<Connection>& ref);
+    void          work();
+    void          send(Connection& connection, const std::string& payload);
+
+    std::string   handleFrame(Worker& worker, const std::string& frame);
+    json::object  handle(Worker& worker, const json::value& request);
+    json::object  load(const json::object& request);
+    json::object  evaluate(Worker& worker, const json::object& request);
+    json::object  solve(Worker& worker, const json::object& request);
+    json::object  reach(Worker& worker, const json::object& request);
+    json::object  rawCost(Worker& worker, const json::object& request);
+    RecipeGraph&  recipeGraph(Worker& worker, const CatalogRef& catalog);
+    json::object  diff(const json::object& request);
+    json::object  layout(const json::object& request);
+    json::object  sensitivity(const json::object& request);
+    ResidentRef   resident(const std::string& name);
+    void          evictCopies(Worker& worker);
+
+    std::string                 m_partsPath;
+    std::string                 m_recipesPath;
+    CatalogSlot                 m_catalog;
+    CatalogWatcher              m_watcher;
+    std::atomic<bool>           m_stop = false;
+    int                         m_listenFd = -1;
+
+    std::mutex                                    m_residentsMutex;
+    std::unordered_map<std::string, ResidentRef>  m_residents;
+    std::atomic<uint64_t>                         m_residentsGeneration = 0;  //Bumped by every load and unload
+
+    std::mutex                  m_jobsMutex;
+    std::condition_variable     m_jobsReady;
+    std::deque<Job>             m_jobs;
+    std::vector<std::thread>    m_workers;
+};
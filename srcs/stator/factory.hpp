@@ -2,102 +2,515 @@
 
 #include "stator/stator.hpp"
 #include "statorNode.hpp"
+#include "flowGraph.hpp"
+#include "power.hpp"
+#include "factoryGenerator.hpp"
+#include "blueprint.hpp"
+#include "layout.hpp"
+#include "linkRenderer.hpp"
+#include "profiler.hpp"
+#include "catalogLoader.hpp"
+#include "memoryTracker.hpp"
+#include <unordered_map>
+#include <unordered_set>
+#include <chrono>
 #include <imgui.h>
 
-class FactoryNode: public StatorNode {
+//Progress of a plan inserted with FactoryNode::insertPlanStep
+struct  PlanInsertion {
+  bool  done() const {return (nodes.size() == plan.nodes.size() && links == plan.links.size());}
+  float progress() const {
+    return ((float)(nodes.size() + links) / std::max<size_t>(plan.nodes.size() + plan.links.size(), 1));
+  }
+
+  FactoryPlan                               plan;
+  std::vector<std::shared_ptr<StatorNode>>  nodes;
+  size_t                                    links = 0;
+  bool                                      keepIds = false;
+};
+
+class FactoryNode: public StatorNode, public StatorNodeListener {
   public:
-    FactoryNode(FactoryNode* parent = nullptr): m_parent(parent) {};
+    FactoryNode(CatalogRef catalog): m_parent(nullptr), m_catalog(std::move(catalog))
+      , m_blueprints(std::make_shared<BlueprintLibrary>()) {};
+    FactoryNode(FactoryNode* parent): m_parent(parent), m_catalog(parent->m_catalog)
+      , m_blueprints(parent->m_blueprints) {};
 
     template<typename T, typename... Params>
     std::shared_ptr<T>  placeNode(Params&&... args) {
       std::shared_ptr<T>  node = m_grid.placeNode<T>(args...);
+      node->owner = this;
+      indexNode(node);
       return (node);
     }
     template<typename T, typename... Params>
     std::shared_ptr<T>  placeNodeAt(const ImVec2& pos, Params&&... args) {
       std::shared_ptr<T>  node = m_grid.placeNodeAt<T>(pos, args...);
+      node->owner = this;
+      indexNode(node);
       return (node);
     }
     template<typename T, typename... Params>
     std::shared_ptr<T>  addNode(const ImVec2& pos, Params&&... args) {
+      MemoryScope         memory(MS_GRAPH);
       std::shared_ptr<T>  node = m_grid.addNode<T>(pos, args...);
+      node->owner = this;
+      indexNode(node);
+      return (node);
+    }
+
+    //Destroyed nodes are dropped from the index as they are looked up
+    std::shared_ptr<StatorNode>   nodeById(uint64_t id) {
+      auto it = m_nodeIndex.find(id);
+      if (it == m_nodeIndex.end())
+        return (nullptr);
+      auto node = it->second.lock();
+      if (node == nullptr)
+        m_nodeIndex.erase(it);
+      return (node);
+    }
+
+    //Give a node its saved id back, it keeps its fresh one if another node took it
+    bool  restoreNodeId(const std::shared_ptr<StatorNode>& node, uint64_t id) {
+      if (id == 0 || id == node->id || nodeById(id) != nullptr)
+        return (false);
+      m_nodeIndex.erase(node->id);
+      node->id = id;
+      m_nodeIndex[id] = node;
+      m_nextId = std::max(m_nextId, id + 1);
+      return (true);
+    }
+
+    void  nodeValueChanged(StatorNode* node) override {
+      m_changedNodes.push_back(node);
+    }
+    void  nodePinsChanged() override {
+      m_structureChanged = true;
+    }
+
+    //Tier of the link into an in pin, it goes with the link
+    int   linkTier(const StatorNode* node, int pin) const {
+      auto it = m_linkTiers.find(pinId(node->id, false, pin));
+      return (it != m_linkTiers.end() ? it->second : 0);
+    }
+    void  setLinkTier(const StatorNode* node, int pin, int tier) {
+      uint64_t  key = pinId(node->id, false, pin);
+      if (tier > 0)
+        m_linkTiers[key] = tier;
+      else
+        m_linkTiers.erase(key);
+      m_changedTiers.push_back(key);
+    }
+    //Drop the tiers of the links that are gone
+    void  pruneLinkTiers() {
+      for (auto it = m_linkTiers.begin(); it != m_linkTiers.end();) {
+        auto  node = nodeById(pinNode(it->first));
+        int   pin = pinSlot(it->first);
+        bool  linked = node != nullptr && pin < node->getIns().size() && node->getIns()[pin]->isConnected();
+        it = linked ? std::next(it) : m_linkTiers.erase(it);
+      }
+    }
+
+    //Instantiate every node of the plan then link them, the flow graph is
+    //only recompiled once on the next update. Loading a save keeps the saved
+    //node ids (keepIds), copies get new ones.
+    std::vector<std::shared_ptr<StatorNode>>  insertPlan(const FactoryPlan& plan, bool keepIds = false) {
+      MemoryScope                               memory(MS_GRAPH);
+      std::vector<std::shared_ptr<StatorNode>>  nodes;
+      nodes.reserve(plan.nodes.size());
+      for (auto& planNode: plan.nodes)
+        nodes.push_back(insertPlanNode(planNode, keepIds));
+      for (auto& link: plan.links)
+        insertPlanLink(link, nodes);
+      m_structureChanged = true;
+      return (nodes);
+    }
+
+    //Same as insertPlan spread over several calls of at most budget seconds,
+    //returns true once every node and link was inserted
+    bool  insertPlanStep(PlanInsertion& insertion, double budget) {
+      auto  start = std::chrono::steady_clock::now();
+      auto  elapsed = [&]() {
+        return (std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+      };
+      const FactoryPlan&  plan = insertion.plan;
+      while (insertion.nodes.size() < plan.nodes.size() && elapsed() < budget)
+        insertion.nodes.push_back(insertPlanNode(plan.nodes[insertion.nodes.size()], insertion.keepIds));
+      while (insertion.nodes.size() == plan.nodes.size() && insertion.links < plan.links.size() && elapsed() < budget)
+        insertPlanLink(plan.links[insertion.links++], insertion.nodes);
+      m_structureChanged = true;
+      return (insertion.done());
+    }
+
+    std::shared_ptr<StatorNode> insertPlanNode(const FactoryPlan::Node& planNode, bool keepIds = false) {
+      std::shared_ptr<StatorNode> node;
+      switch (planNode.type) {
+        case SNT_IN_NODE:
+          node = addNode<InputNode>(planNode.pos, planNode.value);
+          break;
+        case SNT_OUT_NODE:
+          node = addNode<OutputNode>(planNode.pos);
+          break;
+        case SNT_PART_NODE:
+          {
+            auto partNode = addNode<PartNode>(planNode.pos, PartHandle(m_catalog, planNode.part));
+            if (planNode.data.is_null()) {
+              partNode->reset();
+              while (partNode->inCount < planNode.inCount)
+                partNode->addInPin();
+              for (double ratio: planNode.ratios)
+                partNode->addOutPin(ratio);
+            }
+            node = partNode;
+          }
+          break;
+        case SNT_RECIPE_NODE:
+          node = addNode<RecipeNode>(planNode.pos, RecipeHandle(m_catalog, planNode.recipe));
+          break;
+        case SNT_GENERATOR_NODE:
+          node = addNode<GeneratorNode>(planNode.pos, PartHandle(m_catalog, planNode.part));
+          break;
+        case SNT_STORAGE_NODE:
+          node = addNode<StorageNode>(planNode.pos, planNode.value);
+          break;
+        case SNT_FACTORY_NODE:
+          node = addNode<FactoryNode>(planNode.pos, this);
+          break;
+        case SNT_BLUEPRINT_NODE:
+          {
+            auto hash = planNode.data.is_object() ? planNode.data.as_object().if_contains("blueprint") : nullptr;
+            auto blueprint = hash != nullptr ? m_blueprints->find(hash->as_string().c_str()) : nullptr;
+            if (blueprint != nullptr)
+              node = addNode<BlueprintNode>(planNode.pos, blueprint, planNode.value);
+          }
+          break;
+        default:
+          break;
+      }
+      if (node != nullptr && !planNode.data.is_null())
+        node->fromJson(planNode.data);
+      if (node != nullptr && keepIds)
+        restoreNodeId(node, planNode.id);
       return (node);
     }
 
+    void  insertPlanLink(const FactoryPlan::Link& link, const std::vector<std::shared_ptr<StatorNode>>& nodes) {
+      if (nodes[link.from] == nullptr || nodes[link.to] == nullptr)
+        return ;
+      auto& outs = nodes[link.from]->getOuts();
+      auto& ins = nodes[link.to]->getIns();
+      if (link.fromPin >= outs.size() || link.toPin >= ins.size())
+        return ;
+      ins[link.toPin]->createLink(outs[link.fromPin].get());
+      if (link.tier > 0)
+        m_linkTiers[pinId(nodes[link.to]->id, false, link.toPin)] = link.tier;
+    }
+
+    //Restore what a save holds besides its nodes
+    void  loadHeader(const json::value& value, FactoryPlan& plan) {
+      const json::object& obj = value.as_object();
+      if (auto name = obj.if_contains("name"); name != nullptr && name->is_string())
+        m_name = name->as_string().c_str();
+      if (auto filepath = obj.if_contains("filepath"); filepath != nullptr && filepath->is_string())
+        m_filepath = filepath->as_string().c_str();
+      m_blueprints->resolvePlan(obj, plan, *m_catalog);
+    }
+
+    //Selected nodes with their saved state and the links between them,
+    //links address nodes by their index in the fragment
+    json::value     copySelection() {
+      std::unordered_map<BaseNode*, int>  indices;
+      json::array                         nodesJson;
+      json::array                         linksJson;
+
+      for (auto& nodePair: m_grid.getNodes()) {
+        if (!nodePair.second->isSelected())
+          continue ;
+        auto        node = std::dynamic_pointer_cast<StatorNode>(nodePair.second);
+        ImVec2      pos = node->getPos();
+        json::value nodeJson = node->toJson();
+        nodeJson.as_object()["pos"] = {{"x", pos.x}, {"y", pos.y}};
+        nodeJson.as_object()["id"] = node->id;
+        indices[node.get()] = nodesJson.size();
+        nodesJson.push_back(nodeJson);
+      }
+      for (auto& weakLink: m_grid.getLinks()) {
+        auto link = weakLink.lock();
+        if (link == nullptr)
+          continue ;
+        auto from = indices.find(link->left()->getParent());
+        auto to = indices.find(link->right()->getParent());
+        if (from == indices.end() || to == indices.end())
+          continue ;
+        int         toPin = pinIndex(to->first->getIns(), link->right());
+        json::array linkJson = {from->second, pinIndex(from->first->getOuts(), link->left()), to->second, toPin};
+        if (int tier = linkTier(static_cast<StatorNode*>(to->first), toPin); tier > 0)
+          linkJson.push_back(tier);
+        linksJson.push_back(linkJson);
+      }
+      json::object  fragment = {
+        {"type", "SNT_FRAGMENT"},
+        {"nodes", nodesJson},
+        {"links", linksJson},
+      };
+      return (fragment);
+    }
+
+    //Insert copies of the plan shifted by offset then step per copy, all in
+    //one bulk insertion. The inserted nodes become the selection.
+    std::vector<std::shared_ptr<StatorNode>>  insertCopies(const FactoryPlan& plan, ImVec2 offset, ImVec2 step, int copies) {
+      FactoryPlan batch;
+      batch.nodes.reserve(plan.nodes.size() * copies);
+      batch.links.reserve(plan.links.size() * copies);
+      for (int copy = 0; copy < copies; copy++) {
+        int     base = batch.nodes.size();
+        ImVec2  shift = offset + step * (float)copy;
+        for (auto& node: plan.nodes) {
+          batch.nodes.push_back(node);
+          batch.nodes.back().pos = node.pos + shift;
+        }
+        for (auto& link: plan.links)
+          batch.links.push_back({link.from + base, link.fromPin, link.to + base, link.toPin, link.tier});
+      }
+      for (auto& nodePair: m_grid.getNodes())
+        nodePair.second->selected(false);
+      auto  nodes = insertPlan(batch);
+      for (auto& node: nodes) {
+        if (node != nullptr)
+          node->selected(true);
+      }
+      return (nodes);
+    }
+
+    //Replace the selection by an instance of a blueprint made from it.
+    //Links between the selection and the rest of the factory are dropped.
+    std::shared_ptr<Blueprint>  makeBlueprint(const std::string& name) {
+      json::value fragment = copySelection();
+      if (fragment.as_object()["nodes"].as_array().empty())
+        return (nullptr);
+      auto    blueprint = m_blueprints->add(fragment, name, *m_catalog);
+      ImVec2  pos;
+      bool    first = true;
+      for (auto& nodePair: m_grid.getNodes()) {
+        if (!nodePair.second->isSelected())
+          continue ;
+        ImVec2  nodePos = nodePair.second->getPos();
+        pos = first ? nodePos : ImVec2(std::min(pos.x, nodePos.x), std::min(pos.y, nodePos.y));
+        first = false;
+        nodePair.second->destroy();
+      }
+      addNode<BlueprintNode>(pos, blueprint);
+      m_structureChanged = true;
+      return (blueprint);
+    }
+
+    BlueprintLibrary&   blueprints() {
+      return (*m_blueprints);
+    }
+
+    const CatalogRef&   catalog() const {return (m_catalog);}
+    const std::string&  name() const {return (m_name);}
+    void                setName(const std::string& name) {m_name = name;}
+
+    //Move every node to the catalog a reload published. Indices are kept
+    //across reloads, so only the nodes using an entry that changed need
+    //their cached values refreshed, a recipe whose pins changed reshapes its
+    //node and so the structure.
+    virtual void  catalogChanged(const CatalogDiff& diff, const CatalogRef& catalog) {
+      std::unordered_set<int> parts(diff.changedParts.begin(), diff.changedParts.end());
+      std::unordered_set<int> recipes(diff.changedRecipes.begin(), diff.changedRecipes.end());
+      auto  rebind = [&catalog](auto& handle, const std::unordered_set<int>& changed) {
+        handle.catalog = catalog;
+        return (changed.count(handle.index) > 0);
+      };
+      m_catalog = catalog;
+      for (auto& nodePair: m_grid.getNodes()) {
+        auto node = dynamic_cast<StatorNode*>(nodePair.second.get());
+        if (node == nullptr)
+          continue ;
+        switch (node->statorNodeType()) {
+          case SNT_PART_NODE:
+            if (rebind(static_cast<PartNode*>(node)->part, parts))
+              node->valueChanged();
+            break;
+          case SNT_GENERATOR_NODE:
+            if (rebind(static_cast<GeneratorNode*>(node)->fuel, parts))
+              node->valueChanged();
+            break;
+          case SNT_RECIPE_NODE:
+            if (rebind(static_cast<RecipeNode*>(node)->recipe, recipes)) {
+              static_cast<RecipeNode*>(node)->rebind();
+              node->valueChanged();
+            }
+            break;
+          case SNT_BLUEPRINT_NODE:
+            node->valueChanged();
+            break;
+          case SNT_FACTORY_NODE:
+            static_cast<FactoryNode*>(node)->catalogChanged(diff, catalog);
+            break;
+          default:
+            break;
+        }
+      }
+    }
+
+    //Layout graph of the current nodes, nodes receives the node of every index
+    LayoutGraph     layoutGraph(std::vector<std::weak_ptr<BaseNode>>& nodes) {
+      LayoutGraph                         graph;
+      std::unordered_map<BaseNode*, int>  indices;
+
+      nodes.clear();
+      for (auto& nodePair: m_grid.getNodes()) {
+        indices[nodePair.second.get()] = nodes.size();
+        nodes.push_back(nodePair.second);
+        ImVec2  size = nodePair.second->getSize();
+        //Nodes not drawn yet have no size
+        graph.sizes.push_back(size.x > 0 ? size : ImVec2(150, 80));
+      }
+      for (auto& weakLink: m_grid.getLinks()) {
+        auto link = weakLink.lock();
+        if (link == nullptr)
+          continue ;
+        auto from = indices.find(link->left()->getParent());
+        auto to = indices.find(link->right()->getParent());
+        if (from != indices.end() && to != indices.end())
+          graph.edges.push_back({from->second, to->second});
+      }
+      return (graph);
+    }
+
+    //Place every node with the layered layout, starting at the top left node
+    void            autoLayout() {
+      std::vector<std::weak_ptr<BaseNode>>  nodes;
+      LayoutGraph                           graph = layoutGraph(nodes);
+      applyLayout(nodes, computeLayout(graph, layoutOptions(nodes)));
+    }
+
+    void            applyLayout(const std::vector<std::weak_ptr<BaseNode>>& nodes, const std::vector<ImVec2>& positions) {
+      for (int i = 0; i < nodes.size() && i < positions.size(); i++) {
+        auto node = nodes[i].lock();
+        if (node != nullptr)
+          node->setPos(positions[i]);
+      }
+    }
+
+    ImNodeFlow&     getGrid() {
+      return (m_grid);
+    }
+
     StatorNodeType  statorNodeType() override {
       return (SNT_FACTORY_NODE);
     };
 
     json::value     toJson() override {
+      MemoryScope   memory(MS_SERIALIZATION);
       json::array   nodesJson;
+      json::array   linksJson;
       auto          nodes = m_grid.getNodes();
       for (auto& nodePair: nodes) {
-        auto node = std::dynamic_pointer_cast<StatorNode>(nodePair.second);
-        ImVec2  pos = node->getPos();
-        nodesJson.push_back(json::value{
-          {"pos", {
-            {"x", pos.x},
-            {"y", pos.y}
-          }},
-          node->toJson().as_object(),
+        auto        node = std::dynamic_pointer_cast<StatorNode>(nodePair.second);
+        ImVec2      pos = node->getPos();
+        json::value nodeJson = node->toJson();
+        nodeJson.as_object()["id"] = node->id;
+        nodeJson.as_object()["pos"] = {{"x", pos.x}, {"y", pos.y}};
+        nodesJson.push_back(nodeJson);
+      }
+      //Links as (out pin id, in pin id), then their tier unless unlimited
+      for (auto& weakLink: m_grid.getLinks()) {
+        auto link = weakLink.lock();
+        if (link == nullptr)
+          continue ;
+        auto from = dynamic_cast<StatorNode*>(link->left()->getParent());
+        auto to = dynamic_cast<StatorNode*>(link->right()->getParent());
+        if (from == nullptr || to == nullptr)
+          continue ;
+        int         toPin = pinIndex(to->getIns(), link->right());
+        json::array linkJson = {pinId(from->id, true, pinIndex(from->getOuts(), link->left())), pinId(to->id, false, toPin)};
+        if (int tier = linkTier(to, toPin); tier > 0)
+          linkJson.push_back(tier);
+        linksJson.push_back(linkJson);
+      }
+      //Every blueprint used here is saved once whatever its instance count
+      json::array                           blueprintsJson;
+      std::unordered_map<Blueprint*, char>  saved;
+      for (auto& nodePair: nodes) {
+        auto instance = std::dynamic_pointer_cast<BlueprintNode>(nodePair.second);
+        if (instance == nullptr || saved.count(instance->blueprint.get()))
+          continue ;
+        saved[instance->blueprint.get()] = 1;
+        blueprintsJson.push_back({
+          {"hash", instance->blueprint->hashString()},
+          {"name", instance->blueprint->name},
+          {"definition", instance->blueprint->definition},
         });
       }
       json::object  value = {
         {"type", "SNT_FACTORY_NODE"},
         {"name", m_name},
         {"filepath", m_filepath},
+        {"blueprints", blueprintsJson},
         {"nodes", nodesJson},
+        {"links", linksJson},
       };
       return (value);
     }
 
     void            fromJson(json::value value) override {
-      json::object& obj = value.as_object();
-      m_name = obj["name"].as_string();
-      m_filepath = obj["filepath"].as_string();
-      for (auto& node: obj["nodes"].as_array()) {
-        ImVec2  pos(node.as_object()["pos"].as_object()["x"].as_int64(), node.as_object()["pos"].as_object()["y"].as_int64());
-        switch(sntFromString(node.as_object()["type"].as_string().c_str())) {
-          case SNT_IN_NODE:
-            addNode<InputNode>(pos)->fromJson(node.as_object());
-            break;
-          case SNT_OUT_NODE:
-            addNode<OutputNode>(pos)->fromJson(node.as_object());
-            break;
-          case SNT_PART_NODE:
-            for (auto& part: partsGlobalArray) {
-              if (part.name == node.as_object()["name"].as_string()) {
-                addNode<PartNode>(pos, part)->fromJson(node.as_object());
-                break;
-              }
-            }
-            break;
-          case SNT_RECIPE_NODE:
-            {
-              int id = node.as_object()["recipeId"].as_int64();
-              if (recipesGlobalArray.size() < id)
-                addNode<RecipeNode>(pos, recipesGlobalArray[id])->fromJson(node.as_object());
-            }
-            break;
-          case SNT_FACTORY_NODE:
-            addNode<FactoryNode>(pos, this)->fromJson(node.as_object());
-            break;
-          default:
-            break;
-        }
-      }
+      MemoryWatermark watermark("FactoryNode::fromJson");
+      FactoryPlan     plan;
+      if (!planFromFragment(value, *m_catalog, plan))
+        return ;
+      loadHeader(value, plan);
+      insertPlan(plan, true);
     }
 
   protected:
-    std::string   m_name = "";
-    std::string   m_filepath = "";
-    ImNodeFlow    m_grid;
-    FactoryNode*  m_parent;
+    void            indexNode(const std::shared_ptr<StatorNode>& node) {
+      node->id = m_nextId++;
+      m_nodeIndex[node->id] = node;
+    }
+
+    static int      pinIndex(const std::vector<std::shared_ptr<Pin>>& pins, Pin* pin) {
+      for (int i = 0; i < pins.size(); i++) {
+        if (pins[i].get() == pin)
+          return (i);
+      }
+      return (-1);
+    }
+
+    LayoutOptions   layoutOptions(const std::vector<std::weak_ptr<BaseNode>>& nodes) {
+      LayoutOptions options;
+      bool          first = true;
+      for (auto& weakNode: nodes) {
+        auto node = weakNode.lock();
+        if (node == nullptr)
+          continue ;
+        ImVec2  pos = node->getPos();
+        options.origin = first ? pos : ImVec2(std::min(options.origin.x, pos.x), std::min(options.origin.y, pos.y));
+        first = false;
+      }
+      return (options);
+    }
+
+    std::string                       m_name = "";
+    std::string                       m_filepath = "";
+    ImNodeFlow                        m_grid;
+    FactoryNode*                      m_parent;
+    CatalogRef                        m_catalog;
+    std::shared_ptr<BlueprintLibrary> m_blueprints;
+    std::vector<StatorNode*>          m_changedNodes;
+    //In pin id (pinId) -> LinkTier of its link, unlimited links are left out
+    std::unordered_map<uint64_t, int> m_linkTiers;
+    std::vector<uint64_t>             m_changedTiers;
+    uint64_t                          m_nextId = 1;
+    std::unordered_map<uint64_t, std::weak_ptr<StatorNode>>   m_nodeIndex;
+    bool                              m_structureChanged = true;
 };
 
 class FactoryEditor: public FactoryNode {
   public:
-    FactoryEditor() {};
+    FactoryEditor(CatalogRef catalog): FactoryNode(std::move(catalog)) {};
 
     void  draw() override {
       m_grid.rightClickPopUpContent([this](BaseNode *node)
@@ -108,16 +521,20 @@ class FactoryEditor: public FactoryNode {
             ImGui::PushStyleColor(ImGuiCol_Button, {0.7, 0.1, 0.2, 1.0});
             if (ImGui::Button("Delete Node")) {
               node->destroy();
+              m_structureChanged = true;
               ImGui::CloseCurrentPopup();
             }
             ImGui::PopStyleColor();
             nodeStator->drawPopUp();
+            drawLinkTiers(nodeStator);
           }
           else {
             if (ImGui::Button("Add Input node"))
               placeNode<InputNode>();
             if (ImGui::Button("Add Output node"))
               placeNode<OutputNode>();
+            if (ImGui::Button("Add Storage node"))
+              placeNode<StorageNode>();
           }
         });
       m_grid.droppedLinkPopUpContent([this](ImFlow::Pin *dragged)
@@ -125,23 +542,365 @@ class FactoryEditor: public FactoryNode {
 
 
       std::vector<std::weak_ptr<ImFlow::Link>> links = m_grid.getLinks();
+      bool    batched = m_batchLinks || links.size() >= batchLinksThreshold;
       ImGui::Text("Nodes: %u", m_grid.getNodesCount());
       ImGui::SameLine();
       ImGui::Text("Links: %lu", links.size());
+      ImGui::SameLine();
+      if (ImGui::Checkbox("Exact", &m_exactMode))
+        updateOutputs();
+      ImGui::SameLine();
+      ImGui::Checkbox("Batch links", &m_batchLinks);
+      if (batched) {
+        bool  bundling = m_linkRenderer.bundling();
+        ImGui::SameLine();
+        if (ImGui::Checkbox("Bundle", &bundling))
+          m_linkRenderer.setBundling(bundling);
+      }
+      ImGui::SameLine();
+      drawPowerBalance();
+      updateLayoutJob();
 
+      //Summed rather than xored, so a pair of links cannot cancel out, and the
+      //count mixed in last
+      uint64_t  linksHash = 0;
+      uint64_t  linksCount = 0;
       for (auto link: links) {
         auto p = link.lock();
         if (p == nullptr)
           continue ;
-        if (p->isHovered()) {
-        }
-        if (p->isSelected() && ImGui::IsMouseClicked(ImGuiMouseButton_Right)) {
+        linksHash += mixHash(mixHash((uintptr_t)p->left()) ^ (uintptr_t)p->right());
+        linksCount++;
+        if (!batched && p->isSelected() && ImGui::IsMouseClicked(ImGuiMouseButton_Right)) {
           ImFlow::Pin *right = p->right();
           ImFlow::Pin *left = p->left();
           right->deleteLink();
           left->deleteLink();
+          m_structureChanged = true;
+        }
+      }
+      linksHash = mixHash(linksHash ^ mixHash(linksCount));
+      if (linksHash != m_linksHash || m_grid.getNodesCount() != m_flow.nodes().size()) {
+        m_linksHash = linksHash;
+        m_structureChanged = true;
+      }
+      {
+        ScopedTimer timer("Grid update");
+        if (batched)
+          updateGridDetached();
+        else
+          m_grid.update();
+      }
+      if (batched) {
+        ScopedTimer timer("Link draw list");
+        drawLinks();
+      }
+      {
+        ScopedTimer timer("Flow update");
+        MemoryScope memory(MS_EVALUATION);
+        if (updateFlow()) {
+          updateOutputs();
+          updateOverloads();
         }
       }
+      if (!batched)
+        drawOverloads();
+    }
+
+    //ImNodeFlow tessellates and hit tests every link each frame, hide them
+    //from its update and let the link renderer draw them from its cache
+    void  updateGridDetached() {
+      auto& gridLinks = m_grid.getLinks();
+      std::vector<std::weak_ptr<ImFlow::Link>>  links;
+      links.swap(gridLinks);
       m_grid.update();
+      links.insert(links.end(), gridLinks.begin(), gridLinks.end());
+      links.erase(std::remove_if(links.begin(), links.end(), [](auto& link) {
+        return (link.expired());
+      }), links.end());
+      gridLinks.swap(links);
+    }
+
+    //Batched links over the canvas, hovering is only tested when the mouse
+    //or the links moved
+    void  drawLinks() {
+      std::vector<std::shared_ptr<ImFlow::Link>>  live;
+      std::vector<LinkRenderer::Link>             endpoints;
+      ImVec2                                      scroll = m_grid.getScroll();
+
+      live.reserve(m_grid.getLinks().size());
+      endpoints.reserve(m_grid.getLinks().size());
+      for (auto& weakLink: m_grid.getLinks()) {
+        auto link = weakLink.lock();
+        if (link == nullptr)
+          continue ;
+        live.push_back(link);
+        bool  overloaded = !m_overloadedLinks.empty() && m_overloadedLinks.count(link.get());
+        endpoints.push_back({link.get(), link->left()->pinPoint() - scroll, link->right()->pinPoint() - scroll
+            , overloaded ? overloadColor : link->left()->getStyle()->color});
+      }
+      bool  moved = m_linkRenderer.update(endpoints);
+
+      ImVec2                  clipMin = ImGui::GetItemRectMin();
+      ImVec2                  clipMax = ImGui::GetItemRectMax();
+      LinkRenderer::Transform transform;
+      transform.offset = m_grid.grid2screen(ImVec2(0, 0));
+      transform.scale = m_grid.grid2screen(ImVec2(1, 0)).x - transform.offset.x;
+      ImDrawList* drawList = ImGui::GetWindowDrawList();
+      drawList->PushClipRect(clipMin, clipMax, true);
+      m_linkRenderer.draw(drawList, transform, clipMin, clipMax, 2.f * transform.scale);
+      drawList->PopClipRect();
+
+      ImVec2  mouse = ImGui::GetMousePos();
+      bool    inside = mouse.x >= clipMin.x && mouse.y >= clipMin.y && mouse.x < clipMax.x && mouse.y < clipMax.y;
+      bool    leftClick = inside && ImGui::IsMouseClicked(ImGuiMouseButton_Left);
+      bool    rightClick = inside && ImGui::IsMouseClicked(ImGuiMouseButton_Right);
+      if (moved || leftClick || mouse.x != m_lastMouse.x || mouse.y != m_lastMouse.y) {
+        m_lastMouse = mouse;
+        m_linkRenderer.hovered = inside ? m_linkRenderer.hitTest((mouse - transform.offset) / transform.scale, 5.f / transform.scale) : -1;
+      }
+      auto& selection = m_linkRenderer.selection();
+      if (leftClick) {
+        if (!ImGui::IsKeyDown(ImGuiKey_LeftCtrl))
+          std::fill(selection.begin(), selection.end(), 0);
+        if (m_linkRenderer.hovered >= 0)
+          selection[m_linkRenderer.hovered] = !selection[m_linkRenderer.hovered];
+      }
+      if (rightClick || ImGui::IsKeyPressed(ImGuiKey_Delete, false)) {
+        for (int i = 0; i < live.size(); i++) {
+          if (!selection[i])
+            continue ;
+          live[i]->right()->deleteLink();
+          m_structureChanged = true;
+        }
+      }
+    }
+
+    //Recompile the flow graph when the structure changed, otherwise only
+    //push the edited nodes and caps and let the flow graph re-solve what they reach
+    bool  updateFlow() {
+      bool  updated = m_structureChanged || !m_changedNodes.empty() || !m_changedTiers.empty();
+      if (m_structureChanged) {
+        pruneLinkTiers();
+        m_flow.compile(m_grid, m_linkTiers);
+        m_flowCatalog = m_catalog;
+        m_power.reset(m_flow);
+        m_structureChanged = false;
+      }
+      else if (updated) {
+        for (auto node: m_changedNodes)
+          m_flow.refresh(node);
+        for (uint64_t pin: m_changedTiers) {
+          auto node = nodeById(pinNode(pin));
+          if (node != nullptr)
+            m_flow.setCap(m_flow.indexOf(node.get()), pinSlot(pin), linkTierCapacity(linkTier(node.get(), pinSlot(pin))));
+        }
+        m_power.update(m_flow, m_flow.update());
+      }
+      m_changedNodes.clear();
+      m_changedTiers.clear();
+      return (updated);
     }
+
+    void  updateOutputs() {
+      if (m_exactMode)
+        m_flow.evaluateExact();
+      for (int i = 0; i < m_flow.nodes().size(); i++) {
+        FlowNode& node = m_flow.nodes()[i];
+        if (node.type != SNT_OUT_NODE || node.source == nullptr)
+          continue ;
+        auto output = static_cast<OutputNode*>(node.source);
+        output->exactValue = m_exactMode ? m_flow.exactRate(i).toString() : "";
+        output->flowRate = node.rate;
+      }
+    }
+
+    //Links asked for more than their tier carries, found from the live links
+    //since the flow graph may still point to nodes the grid just destroyed
+    void  updateOverloads() {
+      m_overloads.clear();
+      m_overloadedLinks.clear();
+      if (m_linkTiers.empty())
+        return ;
+      for (auto& weakLink: m_grid.getLinks()) {
+        auto link = weakLink.lock();
+        if (link == nullptr)
+          continue ;
+        BaseNode* node = link->right()->getParent();
+        int       index = m_flow.indexOf(node);
+        int       pin = pinIndex(node->getIns(), link->right());
+        if (index < 0 || pin < 0 || pin >= m_flow.nodes()[index].ins.size() || !m_flow.overloaded(index, pin))
+          continue ;
+        m_overloads.push_back(weakLink);
+        m_overloadedLinks.insert(link.get());
+      }
+    }
+
+    //ImNodeFlow draws its links in their out pin colour, overloaded ones get
+    //a halo on top
+    void  drawOverloads() {
+      if (m_overloads.empty())
+        return ;
+      ImVec2      scroll = m_grid.getScroll();
+      ImVec2      origin = m_grid.grid2screen(ImVec2(0, 0));
+      float       scale = m_grid.grid2screen(ImVec2(1, 0)).x - origin.x;
+      ImDrawList* drawList = ImGui::GetWindowDrawList();
+      drawList->PushClipRect(ImGui::GetItemRectMin(), ImGui::GetItemRectMax(), true);
+      for (auto& weakLink: m_overloads) {
+        auto link = weakLink.lock();
+        if (link == nullptr)
+          continue ;
+        ImVec2  from = (link->left()->pinPoint() - scroll) * scale + origin;
+        ImVec2  to = (link->right()->pinPoint() - scroll) * scale + origin;
+        ImFlow::smart_bezier(from, to, overloadColor & IM_COL32(255, 255, 255, 140), 6.f * scale);
+      }
+      drawList->PopClipRect();
+    }
+
+    //Tier of every linked in pin with what its link carries, and what it is
+    //asked for when that is more
+    void  drawLinkTiers(StatorNode* node) {
+      auto& ins = node->getIns();
+      int   index = m_flow.indexOf(node);
+      bool  first = true;
+      for (int pin = 0; pin < ins.size(); pin++) {
+        if (!ins[pin]->isConnected())
+          continue ;
+        if (first)
+          ImGui::Separator();
+        first = false;
+        int tier = linkTier(node, pin);
+        ImGui::PushID(pin);
+        ImGui::SetNextItemWidth(180.f);
+        if (ImGui::BeginCombo(ins[pin]->getName().c_str(), linkTiers[tier].name)) {
+          for (int i = 0; i < linkTierCount; i++) {
+            if (ImGui::Selectable(linkTiers[i].name, i == tier))
+              setLinkTier(node, pin, i);
+          }
+          ImGui::EndCombo();
+        }
+        if (index >= 0 && pin < m_flow.nodes()[index].ins.size()) {
+          const FlowNode& flowNode = m_flow.nodes()[index];
+          ImGui::SameLine();
+          if (m_flow.overloaded(index, pin))
+            ImGui::TextColored(ImVec4(0.9, 0.2, 0.2, 1.0), "%.1f /min, %.1f asked", m_flow.inValue(flowNode, pin)
+                , m_flow.nodes()[flowNode.ins[pin].node].offered[flowNode.ins[pin].pin]);
+          else
+            ImGui::Text("%.1f /min", m_flow.inValue(flowNode, pin));
+        }
+        ImGui::PopID();
+      }
+    }
+
+    void  drawPowerBalance() {
+      ImVec4  color = m_power.net() < 0.0 ? ImVec4(0.9, 0.2, 0.2, 1.0) : ImVec4(0.2, 0.9, 0.2, 1.0);
+      ImGui::TextColored(color, "Power: %.1f / %.1f MW", m_power.generation(), m_power.consumption());
+      if (m_power.starvedCount() > 0) {
+        ImGui::SameLine();
+        ImGui::TextColored({0.9, 0.2, 0.2, 1.0}, "Starved generators: %d", m_power.starvedCount());
+      }
+    }
+
+    void  copy() {
+      ImGui::SetClipboardText(json::serialize(copySelection()).c_str());
+      m_pasteCount = 0;
+    }
+
+    void  cut() {
+      copy();
+      for (auto& nodePair: m_grid.getNodes()) {
+        if (nodePair.second->isSelected())
+          nodePair.second->destroy();
+      }
+      m_structureChanged = true;
+    }
+
+    //Every paste of the same fragment lands a little further away
+    void  paste() {
+      const char*       text = ImGui::GetClipboardText();
+      json::error_code  error;
+      FactoryPlan       plan;
+      if (text == nullptr)
+        return ;
+      json::value fragment = json::parse(text, error);
+      if (error || !planFromFragment(fragment, *m_catalog, plan))
+        return ;
+      m_pasteCount++;
+      insertCopies(plan, ImVec2(40, 40) * (float)m_pasteCount, ImVec2(0, 0), 1);
+    }
+
+    //Copies of the selection stacked under it
+    void  duplicate(int copies) {
+      FactoryPlan plan;
+      if (copies < 1 || !planFromFragment(copySelection(), *m_catalog, plan) || plan.nodes.empty())
+        return ;
+      float top = plan.nodes[0].pos.y;
+      float bottom = top;
+      for (auto& node: plan.nodes) {
+        top = std::min(top, node.pos.y);
+        bottom = std::max(bottom, node.pos.y);
+      }
+      ImVec2  step(0, bottom - top + 150.f);
+      insertCopies(plan, step, step, copies);
+    }
+
+    //Same as autoLayout on a worker, intermediate orders are shown as they come
+    void  startAutoLayout() {
+      LayoutGraph graph = layoutGraph(m_layoutNodes);
+      m_layoutJob.start(std::move(graph), layoutOptions(m_layoutNodes));
+    }
+
+    void  updateLayoutJob() {
+      if (!m_layoutJob.running())
+        return ;
+      std::vector<ImVec2> positions;
+      bool                done = m_layoutJob.done();
+      if (m_layoutJob.take(positions))
+        applyLayout(m_layoutNodes, positions);
+      if (done) {
+        m_layoutJob.stop();
+        m_layoutNodes.clear();
+        return ;
+      }
+      ImGui::SameLine();
+      ImGui::Text("Layout %.0f%%", m_layoutJob.progress() * 100.f);
+    }
+
+    FlowGraph&      flow() {return (m_flow);}
+    PowerBalance&   power() {return (m_power);}
+
+    //The flow graph is pointed at the new catalog in place, it is only
+    //recompiled when the structure changed
+    void  catalogChanged(const CatalogDiff& diff, const CatalogRef& catalog) override {
+      FactoryNode::catalogChanged(diff, catalog);
+      if (m_flowCatalog != nullptr)
+        m_flow.rebind(*m_flowCatalog, *catalog);
+      m_flowCatalog = catalog;
+    }
+
+  private:
+    FlowGraph     m_flow;
+    CatalogRef    m_flowCatalog;  //What m_flow points into until its next compile
+    PowerBalance  m_power;
+    uint64_t      m_linksHash = 0;
+    bool          m_exactMode = false;
+
+    static constexpr size_t batchLinksThreshold = 2000;
+    static constexpr ImU32  overloadColor = IM_COL32(230, 40, 40, 255);
+    //splitmix64 finalizer
+    static uint64_t         mixHash(uint64_t x) {
+      x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+      x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+      return (x ^ (x >> 31));
+    }
+    LinkRenderer  m_linkRenderer;
+    bool          m_batchLinks = false;
+    int           m_pasteCount = 0;
+    ImVec2        m_lastMouse;
+
+    std::vector<std::weak_ptr<ImFlow::Link>>  m_overloads;
+    std::unordered_set<const void*>           m_overloadedLinks;
+
+    LayoutJob                             m_layoutJob;
+    std::vector<std::weak_ptr<BaseNode>>  m_layoutNodes;
 };
@@ -0,0 +1,424 @@
+#include "factoryDiff.hpp"
+#include "importJob.hpp"
+#include "power.hpp"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+void  loadSnapshot(FactorySnapshot& snapshot, const json::value& save, const Catalog& catalog
+    , LoadReport* report) {
+  snapshot.plan = FactoryPlan();
+  if (!planFromFragment(save, catalog, snapshot.plan, report))
+    throw std::runtime_error("not a factory save");
+  const json::object& obj = save.as_object();
+  if (auto name = obj.if_contains("name"); name != nullptr && name->is_string())
+    snapshot.name = name->as_string().c_str();
+  snapshot.library.resolvePlan(obj, snapshot.plan, catalog, report);
+  buildFlow(snapshot.flow, snapshot.plan, catalog, &snapshot.library);
+}
+
+void  loadSnapshotFile(FactorySnapshot& snapshot, const std::string& path, const Catalog& catalog
+    , LoadReport* report) {
+  ImportResult  result = importFile(path, catalog);
+  if (!result.error.empty())
+    throw std::runtime_error(path + ": " + result.error);
+  if (result.kind != IK_FACTORY && result.kind != IK_FRAGMENT)
+    throw std::runtime_error(path + ": not a factory save");
+  snapshot.plan = std::move(result.plan);
+  snapshot.name = path;
+  snapshot.library.resolvePlan(result.document.as_object(), snapshot.plan, catalog, &result.report);
+  if (report != nullptr)
+    for (auto& issue: result.report.issues())
+      report->error(path + ": " + issue.path, issue.message);
+  buildFlow(snapshot.flow, snapshot.plan, catalog, &snapshot.library);
+}
+
+static uint64_t   mix(uint64_t hash, uint64_t value) {
+  return (hash ^ (value + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2)));
+}
+
+//Type and what the node works on, nodes of different kinds are never matched
+static uint64_t   nodeKind(const FactoryPlan::Node& node) {
+  uint64_t  hash = mix(0, node.type);
+  switch (node.type) {
+    case SNT_PART_NODE:
+    case SNT_GENERATOR_NODE:
+      return (mix(hash, node.part));
+    case SNT_RECIPE_NODE:
+      return (mix(hash, node.recipe));
+    case SNT_BLUEPRINT_NODE:
+      return (mix(hash, std::hash<std::string_view>()(node.data.as_object().at("blueprint").as_string())));
+    default:
+      return (hash);
+  }
+}
+
+static std::string  nodeLabel(const FactorySnapshot& snapshot, int index, const Catalog& catalog) {
+  const FactoryPlan::Node&  node = snapshot.plan.nodes[index];
+  std::string               label;
+  switch (node.type) {
+    case SNT_IN_NODE:
+      return ("Input");
+    case SNT_OUT_NODE:
+      {
+        int from = snapshot.flow.nodes()[index].ins[0].node;
+        const Part* part = from >= 0 ? snapshot.flow.nodes()[from].part : nullptr;
+        return ("Output " + (part != nullptr ? part->name.str() : std::to_string(index)));
+      }
+    case SNT_PART_NODE:
+      return ("Part " + catalog.parts()[node.part].name.str());
+    case SNT_GENERATOR_NODE:
+      return ("Generator " + catalog.parts()[node.part].name.str());
+    case SNT_STORAGE_NODE:
+      return ("Storage");
+    case SNT_RECIPE_NODE:
+      for (auto& out: catalog.recipes()[node.recipe].outputs)
+        label += (label.empty() ? "" : " + ") + out.name.str();
+      return ("Recipe " + std::to_string(catalog.recipes()[node.recipe].id) + " -> " + label);
+    case SNT_BLUEPRINT_NODE:
+      {
+        auto blueprint = snapshot.library.find(node.data.as_object().at("blueprint").as_string().c_str());
+        return ("Blueprint " + (blueprint != nullptr ? blueprint->name : std::string("?")));
+      }
+    case SNT_FACTORY_NODE:
+      return ("Factory");
+    default:
+      return ("Unknown");
+  }
+}
+
+static std::vector<std::string>   changedFields(const FactoryPlan::Node& a, const FactoryPlan::Node& b) {
+  std::vector<std::string>  fields;
+  if (nodeKind(a) != nodeKind(b))
+    fields.push_back("kind");
+  else {
+    switch (a.type) {
+      case SNT_IN_NODE:
+      case SNT_GENERATOR_NODE:
+      case SNT_STORAGE_NODE:
+      case SNT_BLUEPRINT_NODE:
+        if (a.value != b.value)
+          fields.push_back(a.type == SNT_IN_NODE ? "value" : a.type == SNT_BLUEPRINT_NODE ? "scale" : "capacity");
+        break;
+      case SNT_RECIPE_NODE:
+        if (a.value != b.value)
+          fields.push_back("cycle time");
+        break;
+      case SNT_PART_NODE:
+        if (a.inCount != b.inCount)
+          fields.push_back("inputs");
+        if (a.ratios != b.ratios)
+          fields.push_back("ratios");
+        break;
+      default:
+        break;
+    }
+  }
+  return (fields);
+}
+
+//Uniform grid over positions for nearest neighbour queries, about one
+//position per cell
+class PositionGrid {
+  public:
+    PositionGrid(const FactoryPlan& plan, const std::vector<int>& nodes): m_plan(plan), m_nodes(nodes) {
+      ImVec2  max = nodes.empty() ? ImVec2() : plan.nodes[nodes[0]].pos;
+      m_min = max;
+      for (int node: nodes) {
+        const ImVec2& pos = plan.nodes[node].pos;
+        m_min = ImVec2(std::min(m_min.x, pos.x), std::min(m_min.y, pos.y));
+        max = ImVec2(std::max(max.x, pos.x), std::max(max.y, pos.y));
+      }
+      m_side = std::max(1, (int)std::sqrt((double)nodes.size()));
+      m_cell = std::max({max.x - m_min.x, max.y - m_min.y, 1.f}) / m_side;
+      m_cells.resize(m_side * m_side);
+      for (int i = 0; i < nodes.size(); i++) {
+        auto [x, y] = cellOf(plan.nodes[nodes[i]].pos);
+        m_cells[y * m_side + x].push_back(i);
+      }
+    }
+
+    //The count closest entries of nodes not taken yet as (squared distance, entry)
+    void  nearest(const ImVec2& pos, int count, const std::vector<char>& taken, std::vector<std::pair<float, int>>& found) const {
+      auto [cx, cy] = cellOf(pos);
+      found.clear();
+      for (int ring = 0; ring <= m_side; ring++) {
+        for (int y = cy - ring; y <= cy + ring; y++) {
+          if (y < 0 || y >= m_side)
+            continue ;
+          //Only the border of the ring, the inside was seen before
+          int step = y == cy - ring || y == cy + ring ? 1 : std::max(1, 2 * ring);
+          for (int x = cx - ring; x <= cx + ring; x += step) {
+            if (x < 0 || x >= m_side)
+              continue ;
+            for (int entry: m_cells[y * m_side + x]) {
+              if (taken[entry])
+                continue ;
+              ImVec2  delta = m_plan.nodes[m_nodes[entry]].pos - pos;
+              found.push_back({delta.x * delta.x + delta.y * delta.y, entry});
+            }
+          }
+        }
+        //Anything in the next rings is at least ring cells away
+        if (found.size() >= count) {
+          std::nth_element(found.begin(), found.begin() + count - 1, found.end());
+          float reach = ring * m_cell;
+          if (found[count - 1].first <= reach * reach) {
+            found.resize(count);
+            return ;
+          }
+        }
+      }
+    }
+
+  private:
+    std::pair<int, int> cellOf(const ImVec2& pos) const {
+      int x = (pos.x - m_min.x) / m_cell;
+      int y = (pos.y - m_min.y) / m_cell;
+      return (std::make_pair(std::clamp(x, 0, m_side - 1), std::clamp(y, 0, m_side - 1)));
+    }
+
+    const FactoryPlan&              m_plan;
+    const std::vector<int>&         m_nodes;
+    ImVec2                          m_min;
+    float                           m_cell;
+    int                             m_side;
+    std::vector<std::vector<int>>   m_cells;
+};
+
+//Closest pairs first: every node proposes the few nearest free ones of the
+//other side, proposals are taken by increasing distance, and the ones left
+//free propose again until a side runs out
+static int  pairClosest(const std::vector<int>& lhs, const std::vector<int>& rhs
+    , const FactoryPlan& before, const FactoryPlan& after, std::vector<int>& toAfter, std::vector<int>& toBefore) {
+  struct  Proposal {
+    float dist;
+    int   left;
+    int   right;
+
+    bool  operator<(const Proposal& other) const {
+      return (dist < other.dist || (dist == other.dist && (left < other.left
+          || (left == other.left && right < other.right))));
+    }
+  };
+  const int                           proposals = 4;
+  PositionGrid                        leftGrid(before, lhs);
+  PositionGrid                        rightGrid(after, rhs);
+  std::vector<char>                   leftTaken(lhs.size(), 0);
+  std::vector<char>                   rightTaken(rhs.size(), 0);
+  std::vector<Proposal>               pending;
+  std::vector<std::pair<float, int>>  found;
+  int                                 matched = 0;
+
+  while (matched < lhs.size() && matched < rhs.size()) {
+    pending.clear();
+    for (int i = 0; i < lhs.size(); i++) {
+      if (leftTaken[i])
+        continue ;
+      rightGrid.nearest(before.nodes[lhs[i]].pos, proposals, rightTaken, found);
+      for (auto& candidate: found)
+        pending.push_back({candidate.first, i, candidate.second});
+    }
+    for (int i = 0; i < rhs.size(); i++) {
+      if (rightTaken[i])
+        continue ;
+      leftGrid.nearest(after.nodes[rhs[i]].pos, proposals, leftTaken, found);
+      for (auto& candidate: found)
+        pending.push_back({candidate.first, candidate.second, i});
+    }
+    std::sort(pending.begin(), pending.end());
+    for (auto& proposal: pending) {
+      if (leftTaken[proposal.left] || rightTaken[proposal.right])
+        continue ;
+      leftTaken[proposal.left] = 1;
+      rightTaken[proposal.right] = 1;
+      toAfter[lhs[proposal.left]] = rhs[proposal.right];
+      toBefore[rhs[proposal.right]] = lhs[proposal.left];
+      matched++;
+    }
+  }
+  return (matched);
+}
+
+//Pair the unmatched nodes sharing a key, closest positions first
+static int  matchByKey(const std::vector<uint64_t>& keysBefore, const std::vector<uint64_t>& keysAfter
+    , const FactoryPlan& before, const FactoryPlan& after, std::vector<int>& toAfter, std::vector<int>& toBefore) {
+  std::unordered_map<uint64_t, std::pair<std::vector<int>, std::vector<int>>>  buckets;
+  int                                                                         matched = 0;
+
+  for (int i = 0; i < keysBefore.size(); i++) {
+    if (toAfter[i] < 0)
+      buckets[keysBefore[i]].first.push_back(i);
+  }
+  for (int i = 0; i < keysAfter.size(); i++) {
+    if (toBefore[i] < 0) {
+      auto it = buckets.find(keysAfter[i]);
+      if (it != buckets.end())
+        it->second.second.push_back(i);
+    }
+  }
+  for (auto& bucket: buckets) {
+    auto& lhs = bucket.second.first;
+    auto& rhs = bucket.second.second;
+    if (lhs.size() == 1 && rhs.size() == 1) {
+      toAfter[lhs[0]] = rhs[0];
+      toBefore[rhs[0]] = lhs[0];
+      matched++;
+    }
+    else if (!rhs.empty())
+      matched += pairClosest(lhs, rhs, before, after, toAfter, toBefore);
+  }
+  return (matched);
+}
+
+//Kind of the node mixed with the kinds of its neighbours, order independent
+static std::vector<uint64_t>  neighbourhoodKeys(const FactoryPlan& plan, const std::vector<uint64_t>& kinds) {
+  std::vector<uint64_t> keys(kinds);
+  std::vector<uint64_t> ins(kinds.size(), 0);
+  std::vector<uint64_t> outs(kinds.size(), 0);
+  for (auto& link: plan.links) {
+    //Summing keeps it independent of the link order
+    ins[link.to] += mix(kinds[link.from], link.toPin);
+    outs[link.from] += mix(kinds[link.to], link.fromPin);
+  }
+  for (int i = 0; i < keys.size(); i++)
+    keys[i] = mix(mix(keys[i], ins[i]), outs[i]);
+  return (keys);
+}
+
+//A link that changed tier counts as removed and added
+struct  LinkKey {
+  int   from, fromPin, to, toPin, tier;
+
+  bool  operator==(const LinkKey& other) const {
+    return (from == other.from && fromPin == other.fromPin && to == other.to && toPin == other.toPin
+        && tier == other.tier);
+  }
+};
+
+struct  LinkKeyHash {
+  size_t  operator()(const LinkKey& key) const {
+    return (mix(mix(mix(mix(mix(0, key.from), key.fromPin), key.to), key.toPin), key.tier));
+  }
+};
+
+FactoryDiff   diffFactories(const FactorySnapshot& before, const FactorySnapshot& after, const Catalog& catalog) {
+  FactoryDiff           diff;
+  const FactoryPlan&    planBefore = before.plan;
+  const FactoryPlan&    planAfter = after.plan;
+  std::vector<int>      toAfter(planBefore.nodes.size(), -1);
+  std::vector<int>      toBefore(planAfter.nodes.size(), -1);
+
+  std::unordered_map<uint64_t, int> ids;
+  for (int i = 0; i < planAfter.nodes.size(); i++) {
+    if (planAfter.nodes[i].id != 0)
+      ids[planAfter.nodes[i].id] = i;
+  }
+  for (int i = 0; i < planBefore.nodes.size(); i++) {
+    if (planBefore.nodes[i].id == 0)
+      continue ;
+    auto it = ids.find(planBefore.nodes[i].id);
+    if (it == ids.end() || toBefore[it->second] >= 0)
+      continue ;
+    toAfter[i] = it->second;
+    toBefore[it->second] = i;
+    diff.matchedById++;
+  }
+
+  std::vector<uint64_t> kindsBefore;
+  std::vector<uint64_t> kindsAfter;
+  kindsBefore.reserve(planBefore.nodes.size());
+  kindsAfter.reserve(planAfter.nodes.size());
+  for (auto& node: planBefore.nodes)
+    kindsBefore.push_back(nodeKind(node));
+  for (auto& node: planAfter.nodes)
+    kindsAfter.push_back(nodeKind(node));
+  diff.matchedByStructure += matchByKey(neighbourhoodKeys(planBefore, kindsBefore), neighbourhoodKeys(planAfter, kindsAfter)
+      , planBefore, planAfter, toAfter, toBefore);
+  diff.matchedByStructure += matchByKey(kindsBefore, kindsAfter, planBefore, planAfter, toAfter, toBefore);
+
+  for (int i = 0; i < planBefore.nodes.size(); i++) {
+    if (planBefore.nodes[i].type == SNT_NA)
+      continue ;
+    if (toAfter[i] < 0) {
+      diff.nodes.push_back({i, -1, nodeLabel(before, i, catalog), {}});
+      continue ;
+    }
+    auto  fields = changedFields(planBefore.nodes[i], planAfter.nodes[toAfter[i]]);
+    if (!fields.empty())
+      diff.nodes.push_back({i, toAfter[i], nodeLabel(after, toAfter[i], catalog), fields});
+  }
+  for (int i = 0; i < planAfter.nodes.size(); i++) {
+    if (toBefore[i] < 0 && planAfter.nodes[i].type != SNT_NA)
+      diff.nodes.push_back({-1, i, nodeLabel(after, i, catalog), {}});
+  }
+
+  std::unordered_set<LinkKey, LinkKeyHash>  linksAfter;
+  for (auto& link: planAfter.links)
+    linksAfter.insert({link.from, link.fromPin, link.to, link.toPin, link.tier});
+  for (auto& link: planBefore.links) {
+    LinkKey key = {toAfter[link.from], link.fromPin, toAfter[link.to], link.toPin, link.tier};
+    if (key.from >= 0 && key.to >= 0 && linksAfter.erase(key))
+      continue ;
+    diff.linksRemoved++;
+  }
+  diff.linksAdded = linksAfter.size();
+
+  auto& flowBefore = before.flow.nodes();
+  auto& flowAfter = after.flow.nodes();
+  for (int i = 0; i < planBefore.nodes.size(); i++) {
+    if (planBefore.nodes[i].type != SNT_OUT_NODE)
+      continue ;
+    int match = toAfter[i];
+    diff.outputs.push_back({i, match, nodeLabel(match >= 0 ? after : before, match >= 0 ? match : i, catalog)
+        , flowBefore[i].rate, match >= 0 ? flowAfter[match].rate : 0.0});
+  }
+  for (int i = 0; i < planAfter.nodes.size(); i++) {
+    if (planAfter.nodes[i].type == SNT_OUT_NODE && toBefore[i] < 0)
+      diff.outputs.push_back({-1, i, nodeLabel(after, i, catalog), 0.0, flowAfter[i].rate});
+  }
+
+  PowerBalance  power;
+  power.reset(before.flow);
+  diff.powerBefore = power.net();
+  power.reset(after.flow);
+  diff.powerAfter = power.net();
+  return (diff);
+}
+
+std::string   formatDiff(const FactoryDiff& diff) {
+  std::ostringstream  out;
+  int                 added = 0;
+  int                 removed = 0;
+
+  for (auto& node: diff.nodes) {
+    added += node.before < 0;
+    removed += node.after < 0;
+  }
+  out << "nodes: +" << added << " -" << removed << " ~" << diff.nodes.size() - added - removed
+    << " (" << diff.matchedById << " matched by id, " << diff.matchedByStructure << " by structure)\n";
+  out << "links: +" << diff.linksAdded << " -" << diff.linksRemoved << "\n";
+  for (auto& node: diff.nodes) {
+    if (node.before < 0)
+      out << "+ " << node.label << "\n";
+    else if (node.after < 0)
+      out << "- " << node.label << "\n";
+    else {
+      out << "~ " << node.label << ":";
+      for (auto& field: node.fields)
+        out << " " << field;
+      out << "\n";
+    }
+  }
+  out << "outputs:\n";
+  for (auto& output: diff.outputs) {
+    double  delta = output.rateAfter - output.rateBefore;
+    out << (output.before < 0 ? "+ " : output.after < 0 ? "- " : delta != 0.0 ? "~ " : "  ")
+      << output.label << ": " << output.rateBefore << " -> " << output.rateAfter
+      << " (" << (delta >= 0.0 ? "+" : "") << delta << ")\n";
+  }
+  out << "power: " << diff.powerBefore << " -> " << diff.powerAfter << " MW\n";
+  return (out.str());
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "stator/stator.hpp"
+#include "factoryGenerator.hpp"
+#include "flowGraph.hpp"
+#include "blueprint.hpp"
+#include <string>
+#include <vector>
+
+//A factory save resolved and evaluated without any editor
+struct  FactorySnapshot {
+  std::string       name;
+  FactoryPlan       plan;
+  BlueprintLibrary  library;
+  FlowGraph         flow;
+};
+
+//Both throw std::runtime_error when the save can't be read, invalid nodes
+//are kept as SNT_NA and listed in report
+void  loadSnapshot(FactorySnapshot& snapshot, const json::value& save, const Catalog& catalog
+    , LoadReport* report = nullptr);
+void  loadSnapshotFile(FactorySnapshot& snapshot, const std::string& path, const Catalog& catalog
+    , LoadReport* report = nullptr);
+
+struct  FactoryDiff {
+  struct  NodeChange {
+    int                       before = -1;  //node index in the old plan, -1 if added
+    int                       after = -1;   //node index in the new plan, -1 if removed
+    std::string               label;
+    std::vector<std::string>  fields;       //what changed on a node present in both
+  };
+  struct  OutputDelta {
+    int         before = -1;
+    int         after = -1;
+    std::string label;
+    double      rateBefore = 0.0;
+    double      rateAfter = 0.0;
+  };
+
+  bool  empty() const {
+    return (nodes.empty() && linksAdded == 0 && linksRemoved == 0);
+  }
+
+  std::vector<NodeChange>   nodes;
+  std::vector<OutputDelta>  outputs;
+  int                       matchedById = 0;
+  int                       matchedByStructure = 0;
+  int                       linksAdded = 0;
+  int                       linksRemoved = 0;
+  double                    powerBefore = 0.0;
+  double                    powerAfter = 0.0;
+};
+
+//Nodes are matched by their saved id when both sides have one, the rest by
+//kind (type and part, recipe or blueprint) and neighbourhood, then by kind
+//alone. Nodes sharing a key are paired closest positions first. Everything
+//is hashed and positions are looked up on a grid, so it stays about linear
+//in the size of the saves.
+FactoryDiff   diffFactories(const FactorySnapshot& before, const FactorySnapshot& after, const Catalog& catalog);
+std::string   formatDiff(const FactoryDiff& diff);
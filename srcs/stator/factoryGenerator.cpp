@@ -0,0 +1,359 @@
+#include "factoryGenerator.hpp"
+#include "linkTier.hpp"
+#include "memoryTracker.hpp"
+#include <algorithm>
+#include <climits>
+
+static FactoryPlan::Node  planNode(StatorNodeType type, int part = -1, int recipe = -1) {
+  FactoryPlan::Node node;
+  node.type = type;
+  node.part = part;
+  node.recipe = recipe;
+  return (node);
+}
+
+FactoryPlan   generateFactory(RecipeGraph& graph, int target, double rate
+    , const std::unordered_map<int, int>& alternates) {
+  FactoryPlan       plan;
+  size_t            partCount = graph.partCount();
+  std::vector<int>  chosen(partCount, -1);
+  std::vector<char> visited(partCount, 0);
+  std::vector<int>  order;
+
+  //Alternates not producing their part are ignored
+  auto  produces = [&](int recipe, int part) {
+    auto& outputs = graph.recipeOutputs(recipe);
+    return (std::any_of(outputs.begin(), outputs.end(), [part](auto& out) {return (out.node == part);}));
+  };
+  auto  recipeFor = [&](int part) {
+    auto it = alternates.find(part);
+    if (it != alternates.end() && it->second >= 0 && it->second < graph.recipeCount()
+        && produces(it->second, part))
+      return (it->second);
+    return (graph.defaultRecipe(part));
+  };
+
+  //Post order over the chosen recipes, reversed it gives consumers before producers
+  std::vector<std::pair<int, int>>  stack = {{target, 0}};
+  visited[target] = 1;
+  chosen[target] = recipeFor(target);
+  while (!stack.empty()) {
+    int part = stack.back().first;
+    int next = stack.back().second;
+    int recipe = chosen[part];
+    if (recipe >= 0 && next < graph.recipeInputs(recipe).size()) {
+      stack.back().second++;
+      int in = graph.recipeInputs(recipe)[next].node;
+      if (!visited[in]) {
+        visited[in] = 1;
+        chosen[in] = recipeFor(in);
+        stack.push_back({in, 0});
+      }
+      continue ;
+    }
+    order.push_back(part);
+    stack.pop_back();
+  }
+  std::reverse(order.begin(), order.end());
+
+  struct  Consumer {
+    int     node;
+    int     pin;
+    double  amount;
+  };
+  std::vector<double>                 demand(partCount, 0.0);
+  std::vector<std::vector<Consumer>>  consumers(partCount);
+  std::vector<char>                   processed(partCount, 0);
+
+  plan.nodes.reserve(order.size() * 3 + 1);
+  plan.nodes.push_back(planNode(SNT_OUT_NODE));
+  demand[target] = rate;
+  consumers[target].push_back({0, 0, rate});
+
+  auto  addInput = [&](double value, int to, int toPin) {
+    FactoryPlan::Node node = planNode(SNT_IN_NODE);
+    node.value = value;
+    plan.nodes.push_back(node);
+    plan.links.push_back({(int)plan.nodes.size() - 1, 0, to, toPin});
+  };
+
+  for (int part: order) {
+    processed[part] = 1;
+    int partNode = plan.nodes.size();
+    FactoryPlan::Node node = planNode(SNT_PART_NODE, part);
+    node.inCount = 1;
+    for (auto& consumer: consumers[part])
+      node.ratios.push_back(demand[part] > 0.0 ? consumer.amount / demand[part] : 0.0);
+    plan.nodes.push_back(node);
+    for (int i = 0; i < consumers[part].size(); i++)
+      plan.links.push_back({partNode, i, consumers[part][i].node, consumers[part][i].pin});
+
+    int recipe = chosen[part];
+    if (recipe < 0) {
+      addInput(demand[part], partNode, 0);
+      continue ;
+    }
+    int recipeNode = plan.nodes.size();
+    plan.nodes.push_back(planNode(SNT_RECIPE_NODE, -1, recipe));
+    auto& outputs = graph.recipeOutputs(recipe);
+    auto  output = std::find_if(outputs.begin(), outputs.end(), [part](auto& out) {return (out.node == part);});
+    plan.links.push_back({recipeNode, output->pin, partNode, 0});
+    //Byproducts leave through an OutputNode each, where they can be seen
+    for (auto& other: outputs) {
+      if (&other == &*output)
+        continue ;
+      plan.nodes.push_back(planNode(SNT_OUT_NODE));
+      plan.links.push_back({recipeNode, other.pin, (int)plan.nodes.size() - 1, 0});
+    }
+
+    double  buildings = demand[part] / output->quantity;
+    for (auto& in: graph.recipeInputs(recipe)) {
+      double  amount = buildings * in.quantity;
+      //Already placed means a cycle back to a consumer, feed it from outside
+      if (processed[in.node]) {
+        addInput(amount, recipeNode, in.pin);
+        continue ;
+      }
+      demand[in.node] += amount;
+      consumers[in.node].push_back({recipeNode, in.pin, amount});
+    }
+  }
+  return (plan);
+}
+
+static bool   readId(const json::value& value, uint64_t& out) {
+  if (value.is_uint64())
+    out = value.as_uint64();
+  else if (value.is_int64() && value.as_int64() >= 0)
+    out = value.as_int64();
+  else
+    return (false);
+  return (true);
+}
+
+static void   readPlanNode(const json::value& value, FactoryPlan::Node& node, const std::string& path
+    , const Catalog& catalog, LoadReport* report) {
+  const json::object& obj = value.as_object();
+  bool                valid = true;
+  int64_t             integer = 0;
+  std::string         text;
+  LoadReport          ignored;
+  LoadReport&         errors = report != nullptr ? *report : ignored;
+
+  switch (node.type) {
+    case SNT_IN_NODE:
+      valid = readNumber(obj, "value", node.value, path, errors);
+      break;
+    case SNT_PART_NODE:
+      valid = readInteger(obj, "inCount", integer, path, errors);
+      if (valid && (integer < 0 || integer > 0x7fff)) {
+        errors.error(fieldPath(path, "inCount"), "out of range");
+        valid = false;
+      }
+      node.inCount = integer;
+      if (auto outs = readField(obj, "outs", path, errors, true)) {
+        if (!outs->is_array()) {
+          errors.error(fieldPath(path, "outs"), "expected an array");
+          valid = false;
+        }
+        for (size_t i = 0; valid && i < outs->as_array().size(); i++) {
+          if (!outs->as_array()[i].is_number()) {
+            errors.error(indexPath(path, "outs", i), "expected a number");
+            valid = false;
+          }
+          else
+            node.ratios.push_back(jsonNumber(outs->as_array()[i]));
+        }
+      }
+      else
+        valid = false;
+      break;
+    case SNT_GENERATOR_NODE:
+    case SNT_STORAGE_NODE:
+      valid = readNumber(obj, "capacity", node.value, path, errors);
+      break;
+    case SNT_RECIPE_NODE:
+      if ((valid = readInteger(obj, "recipeId", integer, path, errors))) {
+        node.recipe = integer >= INT_MIN && integer <= INT_MAX ? catalog.findRecipe(integer) : -1;
+        if (node.recipe < 0) {
+          errors.error(fieldPath(path, "recipeId"), "unknown recipe " + std::to_string(integer));
+          valid = false;
+        }
+      }
+      readNumber(obj, "cycleTime", node.value, path, errors, false);
+      break;
+    case SNT_BLUEPRINT_NODE:
+      valid = readNumber(obj, "scale", node.value, path, errors);
+      valid &= readString(obj, "blueprint", text, path, errors);
+      break;
+    case SNT_FACTORY_NODE:
+      //Nested factories are loaded by their own fromJson, when a report is
+      //wanted check them now so it covers the whole save
+      if (report != nullptr) {
+        FactoryPlan nested;
+        valid = planFromFragment(value, catalog, nested, report, path);
+      }
+      break;
+    default:
+      break;
+  }
+  if (node.type == SNT_PART_NODE || node.type == SNT_GENERATOR_NODE) {
+    if (readString(obj, "name", text, path, errors)) {
+      node.part = catalog.findPart(text);
+      if (node.part < 0) {
+        errors.error(fieldPath(path, "name"), "unknown part " + text);
+        valid = false;
+      }
+    }
+    else
+      valid = false;
+  }
+  if (!valid)
+    node.type = SNT_NA;
+}
+
+//Everything of a node but its id. Paths cost an allocation per node, so the
+//caller reads against an empty path first and only reads again with the
+//node's own path when that found something to report.
+static void   readFragmentNode(const json::value& value, FactoryPlan::Node& node, const std::string& path
+    , const Catalog& catalog, LoadReport* a_report) {
+  LoadReport  ignored;
+  LoadReport& report = a_report != nullptr ? *a_report : ignored;
+  std::string type;
+
+  if (!value.is_object()) {
+    report.error(path, "expected an object");
+    return ;
+  }
+  const json::object& nodeObj = value.as_object();
+  if (readString(nodeObj, "type", type, path, report)) {
+    node.type = sntFromString(type);
+    if (node.type == SNT_NA)
+      report.error(fieldPath(path, "type"), "unknown node type " + type);
+  }
+  if (auto pos = nodeObj.if_contains("pos")) {
+    const json::object* posObj = pos->if_object();
+    double              x = 0.0;
+    double              y = 0.0;
+    if (posObj == nullptr)
+      report.error(fieldPath(path, "pos"), "expected an object");
+    else {
+      readNumber(*posObj, "x", x, fieldPath(path, "pos"), report);
+      readNumber(*posObj, "y", y, fieldPath(path, "pos"), report);
+      node.pos = ImVec2(x, y);
+    }
+  }
+  readPlanNode(value, node, path, catalog, a_report);
+}
+
+bool  planFromFragment(const json::value& fragment, const Catalog& catalog, FactoryPlan& plan
+    , LoadReport* a_report, const std::string& path) {
+  MemoryScope         memory(MS_SERIALIZATION);
+  LoadReport          ignored;
+  LoadReport&         report = a_report != nullptr ? *a_report : ignored;
+  const json::object* obj = fragment.if_object();
+  const json::value*  nodes = obj != nullptr ? obj->if_contains("nodes") : nullptr;
+  if (nodes == nullptr || !nodes->is_array()) {
+    report.error(fieldPath(path, "nodes"), "expected an array");
+    return (false);
+  }
+
+  std::unordered_map<uint64_t, int> ids;
+
+  //Invalid nodes stay in the plan as SNT_NA so links keep their indices
+  plan.nodes.reserve(nodes->as_array().size());
+  for (size_t i = 0; i < nodes->as_array().size(); i++) {
+    const json::value&  value = nodes->as_array()[i];
+    FactoryPlan::Node   node;
+    LoadReport          scratch;
+    readFragmentNode(value, node, "", catalog, a_report != nullptr ? &scratch : nullptr);
+    if (!scratch.empty()) {
+      node = FactoryPlan::Node();
+      readFragmentNode(value, node, indexPath(path, "nodes", i), catalog, a_report);
+    }
+    if (auto id = value.is_object() ? value.as_object().if_contains("id") : nullptr) {
+      if (!readId(*id, node.id))
+        report.error(fieldPath(indexPath(path, "nodes", i), "id"), "expected an unsigned integer");
+      else if (!ids.emplace(node.id, i).second) {
+        report.error(fieldPath(indexPath(path, "nodes", i), "id"), "duplicate of nodes[" + std::to_string(ids[node.id]) + "]");
+        node.id = 0;
+      }
+    }
+    if (node.type != SNT_NA)
+      node.data = value;
+    plan.nodes.push_back(std::move(node));
+  }
+
+  const json::value*  links = obj->if_contains("links");
+  if (links != nullptr && !links->is_array()) {
+    report.error(fieldPath(path, "links"), "expected an array");
+    links = nullptr;
+  }
+  for (size_t i = 0; links != nullptr && i < links->as_array().size(); i++) {
+    const json::array*  link = links->as_array()[i].if_array();
+    uint64_t            values[5];
+    FactoryPlan::Link   planLink;
+    bool                valid = link != nullptr && link->size() >= 2 && link->size() <= 5;
+    for (size_t v = 0; valid && v < link->size(); v++)
+      valid = readId((*link)[v], values[v]);
+    if (!valid) {
+      report.error(indexPath(path, "links", i), "expected 2 pin ids or 4 indices, then an optional tier");
+      continue ;
+    }
+    size_t  ends = link->size() >= 4 ? 4 : 2;
+    if (link->size() > ends && values[ends] >= linkTierCount) {
+      report.error(indexPath(path, "links", i), "unknown link tier " + std::to_string(values[ends]));
+      values[ends] = 0;
+    }
+    if (ends == 4) {
+      if (values[0] >= plan.nodes.size() || values[2] >= plan.nodes.size() || values[1] > 0x7fff || values[3] > 0x7fff) {
+        report.error(indexPath(path, "links", i), "out of range");
+        continue ;
+      }
+      planLink = {(int)values[0], (int)values[1], (int)values[2], (int)values[3]};
+    }
+    else {
+      auto  from = ids.find(pinNode(values[0]));
+      auto  to = ids.find(pinNode(values[1]));
+      if (from == ids.end() || to == ids.end() || !pinIsOut(values[0]) || pinIsOut(values[1])) {
+        report.error(indexPath(path, "links", i), "unknown pin");
+        continue ;
+      }
+      planLink = {from->second, pinSlot(values[0]), to->second, pinSlot(values[1])};
+    }
+    planLink.tier = link->size() > ends ? values[ends] : 0;
+    //Links to skipped nodes go with them, the node was already reported
+    if (plan.nodes[planLink.from].type != SNT_NA && plan.nodes[planLink.to].type != SNT_NA)
+      plan.links.push_back(planLink);
+  }
+  return (true);
+}
+
+std::vector<ImVec2>   planLayout(const FactoryPlan& plan, const LayoutOptions& options) {
+  LayoutGraph graph;
+
+  graph.sizes.reserve(plan.nodes.size());
+  for (auto& node: plan.nodes) {
+    switch (node.type) {
+      case SNT_PART_NODE:
+        graph.sizes.push_back(ImVec2(200, 40 + 25 * std::max<int>(node.inCount, node.ratios.size())));
+        break;
+      case SNT_RECIPE_NODE:
+        graph.sizes.push_back(ImVec2(220, 100));
+        break;
+      default:
+        graph.sizes.push_back(ImVec2(120, 60));
+        break;
+    }
+  }
+  graph.edges.reserve(plan.links.size());
+  for (auto& link: plan.links)
+    graph.edges.push_back({link.from, link.to});
+  return (computeLayout(graph, options));
+}
+
+void  layoutPlan(FactoryPlan& plan, const LayoutOptions& options) {
+  std::vector<ImVec2> positions = planLayout(plan, options);
+  for (int i = 0; i < plan.nodes.size(); i++)
+    plan.nodes[i].pos = positions[i];
+}
@@ -0,0 +1,56 @@
+#pragma once
+
+#include "layout.hpp"
+#include "loadReport.hpp"
+#include "recipeGraph.hpp"
+#include "statorNode.hpp"
+#include <imgui.h>
+#include <unordered_map>
+#include <vector>
+
+//Nodes and links to instantiate in a factory, parts and recipes are catalog indices
+struct  FactoryPlan {
+  struct  Node {
+    StatorNodeType      type = SNT_NA;
+    int                 part = -1;
+    int                 recipe = -1;
+    double              value = 0.0;  //InputNode value, GeneratorNode and StorageNode capacity, RecipeNode cycle time
+    int                 inCount = 0;  //PartNode in pins
+    std::vector<double> ratios;       //PartNode out ratios
+    ImVec2              pos;
+    json::value         data;         //Saved node state, applied with fromJson when set
+    uint64_t            id = 0;       //Saved node id, 0 if none
+  };
+  struct  Link {
+    int   from;
+    int   fromPin;
+    int   to;
+    int   toPin;
+    int   tier = 0; //LinkTier index
+  };
+
+  std::vector<Node> nodes;
+  std::vector<Link> links;
+};
+
+//Expand the production tree of target at rate per minute. Every part gets a
+//PartNode splitting its flow between its consumers, fed by the recipe picked
+//in alternates (part -> recipe) or the graph's default recipe, raw parts are
+//fed by an InputNode set to the required rate. Recipe byproducts end on an
+//OutputNode each.
+FactoryPlan   generateFactory(RecipeGraph& graph, int target, double rate
+    , const std::unordered_map<int, int>& alternates = {});
+
+//Resolve a copied fragment (see FactoryNode::copySelection) or a save against
+//the catalog. Fragment links address nodes by index, save links by pin id,
+//both may end with a LinkTier index.
+//Invalid nodes (unknown part or recipe, missing or mistyped fields) stay in
+//the plan as SNT_NA and lose their links, every problem goes to report with
+//its JSON path under path. Only fails when there is no node array at all.
+bool          planFromFragment(const json::value& fragment, const Catalog& catalog, FactoryPlan& plan
+    , LoadReport* report = nullptr, const std::string& path = "");
+
+//Run the layered layout on the plan before any node exists, so node sizes
+//are estimated from their type. planLayout only returns the positions.
+void                  layoutPlan(FactoryPlan& plan, const LayoutOptions& options = {});
+std::vector<ImVec2>   planLayout(const FactoryPlan& plan, const LayoutOptions& options = {});
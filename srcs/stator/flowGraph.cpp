@@ -0,0 +1,619 @@
+#include "flowGraph.hpp"
+#include "blueprint.hpp"
+#include "memoryTracker.hpp"
+#include <algorithm>
+#include <queue>
+
+void  FlowGraph::clear() {
+  m_nodes.clear();
+  m_order.clear();
+  m_position.clear();
+  m_queued.clear();
+  m_dirty.clear();
+  m_touched.clear();
+  m_demanded.clear();
+  m_limited.clear();
+  m_seeds.clear();
+  m_index.clear();
+  m_exactParams.clear();
+  m_exactStale.clear();
+  m_exactOuts.clear();
+  m_exactRates.clear();
+}
+
+int   FlowGraph::addNode(FlowNode node) {
+  MemoryScope memory(MS_EVALUATION);
+  int         index = m_nodes.size();
+  if (node.source != nullptr) {
+    m_index[node.source] = index;
+    readParams(node);
+  }
+  else
+    shapePins(node);
+  m_nodes.push_back(node);
+  return (index);
+}
+
+void  FlowGraph::addLink(FlowPinRef from, FlowPinRef to, double cap) {
+  MemoryScope memory(MS_EVALUATION);
+  FlowNode&   node = m_nodes[to.node];
+  if (to.pin < 0 || to.pin >= node.ins.size())
+    return ;
+  node.ins[to.pin] = from;
+  node.caps[to.pin] = cap;
+  m_nodes[from.node].consumers.push_back(to.node);
+}
+
+void  FlowGraph::setCap(int node, int pin, double cap) {
+  if (node < 0 || node >= m_nodes.size() || pin < 0 || pin >= m_nodes[node].caps.size())
+    return ;
+  if (m_nodes[node].caps[pin] == cap)
+    return ;
+  m_nodes[node].caps[pin] = cap;
+  if (node < m_exactStale.size())
+    m_exactStale[node] = 1;
+  markDirty(node);
+}
+
+void  FlowGraph::build() {
+  MemoryScope       memory(MS_EVALUATION);
+  std::vector<int>  inDegree(m_nodes.size(), 0);
+  for (auto& node: m_nodes) {
+    for (int consumer: node.consumers)
+      inDegree[consumer] += 1;
+  }
+  m_order.clear();
+  m_order.reserve(m_nodes.size());
+  for (int i = 0; i < m_nodes.size(); i++) {
+    if (inDegree[i] == 0)
+      m_order.push_back(i);
+  }
+  for (int i = 0; i < m_order.size(); i++) {
+    for (int consumer: m_nodes[m_order[i]].consumers) {
+      if (--inDegree[consumer] == 0)
+        m_order.push_back(consumer);
+    }
+  }
+  //Nodes caught in a cycle are evaluated last with whatever their inputs hold
+  for (int i = 0; i < m_nodes.size(); i++) {
+    if (inDegree[i] > 0)
+      m_order.push_back(i);
+  }
+  m_position.assign(m_nodes.size(), 0);
+  for (int i = 0; i < m_order.size(); i++)
+    m_position[m_order[i]] = i;
+  m_queued.assign(m_nodes.size(), 0);
+  evaluate();
+}
+
+void  FlowGraph::compile(ImNodeFlow& grid, const std::unordered_map<uint64_t, int>& tiers) {
+  MemoryScope memory(MS_EVALUATION);
+  clear();
+  for (auto& nodePair: grid.getNodes()) {
+    auto node = dynamic_cast<StatorNode*>(nodePair.second.get());
+    if (node == nullptr)
+      continue ;
+    FlowNode  flowNode;
+    flowNode.type = node->statorNodeType();
+    flowNode.source = node;
+    addNode(flowNode);
+  }
+  for (auto& weakLink: grid.getLinks()) {
+    auto link = weakLink.lock();
+    if (link == nullptr)
+      continue ;
+    int from = indexOf(link->left()->getParent());
+    int to = indexOf(link->right()->getParent());
+    if (from < 0 || to < 0)
+      continue ;
+    auto& outs = link->left()->getParent()->getOuts();
+    auto& ins = link->right()->getParent()->getIns();
+    int fromPin = 0;
+    while (fromPin < outs.size() && outs[fromPin].get() != link->left())
+      fromPin++;
+    int toPin = 0;
+    while (toPin < ins.size() && ins[toPin].get() != link->right())
+      toPin++;
+    if (fromPin >= outs.size())
+      continue ;
+    auto  tier = tiers.find(pinId(m_nodes[to].source->id, false, toPin));
+    addLink({from, fromPin}, {to, toPin}, linkTierCapacity(tier != tiers.end() ? tier->second : 0));
+  }
+  build();
+}
+
+void  FlowGraph::refresh(StatorNode* node) {
+  int index = indexOf(node);
+  if (index < 0)
+    return ;
+  readParams(m_nodes[index]);
+  if (index < m_exactStale.size())
+    m_exactStale[index] = 1;
+  markDirty(index);
+}
+
+void  FlowGraph::rebind(const Catalog& previous, const Catalog& next) {
+  for (auto& node: m_nodes) {
+    if (node.part != nullptr)
+      node.part = &next.parts()[node.part - previous.parts().data()];
+    if (node.recipe != nullptr)
+      node.recipe = &next.recipes()[node.recipe - previous.recipes().data()];
+  }
+}
+
+void  FlowGraph::readParams(FlowNode& node) {
+  switch (node.type) {
+    case SNT_IN_NODE:
+      node.value = static_cast<InputNode*>(node.source)->value;
+      break;
+    case SNT_PART_NODE:
+      {
+        auto partNode = static_cast<PartNode*>(node.source);
+        node.part = &*partNode->part;
+        node.ratios.clear();
+        for (auto& out: partNode->outRatios)
+          node.ratios.push_back(out->ratio);
+        node.ins.resize(partNode->inCount);
+      }
+      break;
+    case SNT_RECIPE_NODE:
+      node.recipe = &*static_cast<RecipeNode*>(node.source)->recipe;
+      node.value = static_cast<RecipeNode*>(node.source)->cycleTime;
+      break;
+    case SNT_GENERATOR_NODE:
+      {
+        auto generator = static_cast<GeneratorNode*>(node.source);
+        node.part = &*generator->fuel;
+        node.value = generator->capacity;
+      }
+      break;
+    case SNT_STORAGE_NODE:
+      node.value = static_cast<StorageNode*>(node.source)->capacity;
+      break;
+    case SNT_BLUEPRINT_NODE:
+      {
+        auto blueprint = static_cast<BlueprintNode*>(node.source);
+        node.value = blueprint->scale;
+        node.ratios = blueprint->blueprint->outputRates;
+        node.unitPower = blueprint->blueprint->power;
+      }
+      break;
+    default:
+      break;
+  }
+  shapePins(node);
+}
+
+void  FlowGraph::shapePins(FlowNode& node) {
+  switch (node.type) {
+    case SNT_IN_NODE:
+      node.outs.resize(1);
+      break;
+    case SNT_OUT_NODE:
+    case SNT_GENERATOR_NODE:
+      node.ins.resize(1);
+      break;
+    case SNT_STORAGE_NODE:
+      node.ins.resize(1);
+      node.outs.resize(1);
+      break;
+    case SNT_PART_NODE:
+    case SNT_BLUEPRINT_NODE:
+      node.outs.resize(node.ratios.size());
+      break;
+    case SNT_RECIPE_NODE:
+      node.ins.resize(node.recipe->inputs.size());
+      node.outs.resize(node.recipe->outputs.size());
+      break;
+    default:
+      break;
+  }
+  node.caps.resize(node.ins.size(), linkTierCapacity(0));
+  node.offered.resize(node.outs.size(), 0.0);
+}
+
+double  FlowGraph::inValue(const FlowNode& node, int pin) const {
+  const FlowPinRef& ref = node.ins[pin];
+  if (ref.node < 0)
+    return (0.0);
+  return (std::min(m_nodes[ref.node].outs[ref.pin], node.caps[pin]));
+}
+
+bool  FlowGraph::overloaded(int node, int pin) const {
+  const FlowNode&   consumer = m_nodes[node];
+  const FlowPinRef& ref = consumer.ins[pin];
+  if (ref.node < 0)
+    return (false);
+  return (m_nodes[ref.node].offered[ref.pin] > consumer.caps[pin] * (1.0 + 1e-9));
+}
+
+int   FlowGraph::indexOf(const BaseNode* node) const {
+  auto it = m_index.find(node);
+  if (it == m_index.end())
+    return (-1);
+  return (it->second);
+}
+
+std::string   flowNodeLabel(const FlowNode& node, int index) {
+  std::string suffix = " #" + std::to_string(index);
+  switch (node.type) {
+    case SNT_IN_NODE:
+      return ("Input" + suffix);
+    case SNT_OUT_NODE:
+      return ("Output" + suffix);
+    case SNT_PART_NODE:
+      return ("Part " + (node.part != nullptr ? node.part->name.str() : "?") + suffix);
+    case SNT_GENERATOR_NODE:
+      return ("Generator " + (node.part != nullptr ? node.part->name.str() : "?") + suffix);
+    case SNT_STORAGE_NODE:
+      return ("Storage" + suffix);
+    case SNT_RECIPE_NODE:
+      if (node.recipe != nullptr && !node.recipe->outputs.empty())
+        return ("Recipe " + node.recipe->outputs[0].name.str() + suffix);
+      return ("Recipe" + suffix);
+    case SNT_BLUEPRINT_NODE:
+      return ("Blueprint" + suffix);
+    default:
+      return ("Node" + suffix);
+  }
+}
+
+void          writeCsvField(std::ostream& out, const std::string& field) {
+  out << '"';
+  for (char c: field) {
+    if (c == '"')
+      out << '"';
+    out << c;
+  }
+  out << '"';
+}
+
+//Evaluation shared by the double and the exact path, Params gives the node
+//constants (value, out ratios, recipe quantities) in the evaluation number
+//type and clamps the throughput to the node limit. Returns the throughput.
+template<typename T, typename Params, typename In, typename Out>
+static T  evalFlowNode(const FlowNode& node, const Params& params, In in, Out out) {
+  switch (node.type) {
+    case SNT_IN_NODE:
+      {
+        T value = params.limit(params.value());
+        out(0, value);
+        return (value);
+      }
+    case SNT_OUT_NODE:
+    case SNT_GENERATOR_NODE:
+      return (in(0));
+    case SNT_STORAGE_NODE:
+      {
+        T quantity = params.limit(in(0));
+        out(0, quantity);
+        return (quantity);
+      }
+    case SNT_PART_NODE:
+      {
+        T quantity = T();
+        for (int i = 0; i < node.ins.size(); i++)
+          quantity += in(i);
+        quantity = params.limit(quantity);
+        for (int i = 0; i < node.outs.size(); i++)
+          out(i, quantity * params.ratio(i));
+        return (quantity);
+      }
+    case SNT_RECIPE_NODE:
+      {
+        T ratioMin = T();
+        for (int i = 0; i < node.recipe->inputs.size(); i++) {
+          T r = in(i) / params.inQuantity(i);
+          if (i == 0 || ratioMin > r)
+            ratioMin = r;
+        }
+        ratioMin = params.limit(ratioMin);
+        for (int i = 0; i < node.outs.size(); i++)
+          out(i, ratioMin * params.outQuantity(i));
+        return (ratioMin);
+      }
+    case SNT_BLUEPRINT_NODE:
+      {
+        T scale = params.limit(params.value());
+        for (int i = 0; i < node.outs.size(); i++)
+          out(i, scale * params.ratio(i));
+        return (scale);
+      }
+    default:
+      return (T());
+  }
+}
+
+struct  DoubleParams {
+  const FlowNode& node;
+  double          throughput;
+
+  double  limit(double value) const {return (std::min(value, throughput));}
+  double  value() const {return (node.value);}
+  double  ratio(int i) const {return (node.ratios[i]);}
+  double  inQuantity(int i) const {return (node.recipe->inputs[i].quantity);}
+  double  outQuantity(int i) const {return (node.recipe->outputs[i].quantity);}
+};
+
+//bound is the exact throughput limit of the node, nullptr when nothing holds it
+struct  ExactParamsView {
+  const FlowGraph::ExactParams& params;
+  const Rational*               bound;
+
+  Rational        limit(const Rational& value) const {
+    return (bound != nullptr && value > *bound ? *bound : value);
+  }
+  const Rational& value() const {return (params.value);}
+  const Rational& ratio(int i) const {return (params.ratios[i]);}
+  const Rational& inQuantity(int i) const {return (params.inQuantities[i]);}
+  const Rational& outQuantity(int i) const {return (params.outQuantities[i]);}
+};
+
+bool  FlowGraph::evalDemand(FlowNode& node) {
+  double  oldDemand = node.demand;
+  bool    changed = false;
+
+  node.demand = evalFlowNode<double>(node, DoubleParams{node, linkTierCapacity(0)},
+      [&](int pin) {
+        const FlowPinRef& ref = node.ins[pin];
+        if (ref.node < 0)
+          return (0.0);
+        return (std::min(m_nodes[ref.node].offered[ref.pin], node.caps[pin]));
+      },
+      [&](int pin, double value) {
+        if (node.offered[pin] != value) {
+          node.offered[pin] = value;
+          changed = true;
+        }
+      });
+  return (changed || oldDemand != node.demand);
+}
+
+//Part of what pin is offered the node still takes once it is held to its limit
+double  FlowGraph::accepted(const FlowNode& node, int pin) const {
+  const FlowPinRef& ref = node.ins[pin];
+  double            inflow = std::min(m_nodes[ref.node].offered[ref.pin], node.caps[pin]);
+
+  if (node.limit >= node.demand)
+    return (inflow);
+  switch (node.type) {
+    //Every building lost no longer consumes its share of every input,
+    //whatever was already in excess stays so
+    case SNT_RECIPE_NODE:
+      return (std::max(0.0, inflow - (node.demand - node.limit) * node.recipe->inputs[pin].quantity));
+    case SNT_PART_NODE:
+    case SNT_STORAGE_NODE:
+      return (node.demand > 0.0 ? inflow * node.limit / node.demand : inflow);
+    default:
+      return (inflow);
+  }
+}
+
+//The tightest of what every consumer takes from every out pin, as a share of
+//the throughput since out pins scale with it
+bool  FlowGraph::evalLimit(FlowNode& node) {
+  double  oldLimit = node.limit;
+  int     index = &node - m_nodes.data();
+
+  node.limit = linkTierCapacity(0);
+  for (int consumer: node.consumers) {
+    const FlowNode& target = m_nodes[consumer];
+    for (int pin = 0; pin < target.ins.size(); pin++) {
+      if (target.ins[pin].node != index)
+        continue ;
+      double  offered = node.offered[target.ins[pin].pin];
+      double  taken = accepted(target, pin);
+      if (offered > 0.0 && taken < offered)
+        node.limit = std::min(node.limit, node.demand * taken / offered);
+    }
+  }
+  return (oldLimit != node.limit);
+}
+
+bool  FlowGraph::evalNode(FlowNode& node) {
+  double  oldRate = node.rate;
+  bool    changed = false;
+
+  node.rate = evalFlowNode<double>(node, DoubleParams{node, node.limit},
+      [&](int pin) {return (inValue(node, pin));},
+      [&](int pin, double value) {
+        if (node.outs[pin] != value) {
+          node.outs[pin] = value;
+          changed = true;
+        }
+      });
+  //Only OutputNode, GeneratorNode, StorageNode, RecipeNode and BlueprintNode expose their rate
+  if (node.type == SNT_IN_NODE || node.type == SNT_PART_NODE)
+    node.rate = 0.0;
+  return (changed || oldRate != node.rate);
+}
+
+void  FlowGraph::readExactParams(int index) {
+  const FlowNode& node = m_nodes[index];
+  ExactParams&    params = m_exactParams[index];
+
+  params.value = Rational::fromDouble(node.value, m_exactTolerance);
+  params.ratios.clear();
+  for (double ratio: node.ratios)
+    params.ratios.push_back(Rational::fromDouble(ratio, m_exactTolerance));
+  params.caps.clear();
+  for (double cap: node.caps)
+    params.caps.push_back(cap == linkTierCapacity(0) ? Rational() : Rational::fromDouble(cap, m_exactTolerance));
+  params.inQuantities.clear();
+  params.outQuantities.clear();
+  if (node.recipe != nullptr) {
+    for (auto& in: node.recipe->inputs)
+      params.inQuantities.push_back(Rational::fromDouble(in.quantity, m_exactTolerance));
+    for (auto& out: node.recipe->outputs)
+      params.outQuantities.push_back(Rational::fromDouble(out.quantity, m_exactTolerance));
+  }
+  m_exactStale[index] = 0;
+}
+
+//Exact flow reaching an in pin from the out pins in outs, capped by its link
+Rational  FlowGraph::exactIn(int index, int pin, const std::vector<std::vector<Rational>>& outs) const {
+  const FlowNode&   node = m_nodes[index];
+  const FlowPinRef& ref = node.ins[pin];
+  if (ref.node < 0 || ref.pin >= outs[ref.node].size())
+    return (Rational());
+  const Rational&   value = outs[ref.node][ref.pin];
+  const Rational&   cap = m_exactParams[index].caps[pin];
+  return (node.caps[pin] != linkTierCapacity(0) && value > cap ? cap : value);
+}
+
+//accepted() on the exact demand sweep and limits
+Rational  FlowGraph::exactAccepted(int index, int pin) const {
+  const FlowNode& node = m_nodes[index];
+  Rational        inflow = exactIn(index, pin, m_exactOffered);
+  const Rational& demand = m_exactDemands[index];
+  const Rational& limit = m_exactLimits[index];
+
+  if (!m_exactLimited[index] || limit >= demand)
+    return (inflow);
+  switch (node.type) {
+    case SNT_RECIPE_NODE:
+      {
+        Rational  left = inflow - (demand - limit) * m_exactParams[index].inQuantities[pin];
+        return (left > Rational() ? left : Rational());
+      }
+    case SNT_PART_NODE:
+    case SNT_STORAGE_NODE:
+      return (demand > Rational() ? inflow * limit / demand : inflow);
+    default:
+      return (inflow);
+  }
+}
+
+//With a capped link anywhere the demand and limit sweeps are run again in
+//Rational, so the limits the last sweep applies are exact as well
+void  FlowGraph::evaluateExact() {
+  bool  capped = false;
+
+  m_exactOuts.resize(m_nodes.size());
+  m_exactRates.resize(m_nodes.size());
+  m_exactParams.resize(m_nodes.size());
+  m_exactStale.resize(m_nodes.size(), 1);
+  for (int index: m_order) {
+    if (m_exactStale[index])
+      readExactParams(index);
+    for (double cap: m_nodes[index].caps)
+      capped |= cap != linkTierCapacity(0);
+  }
+  m_exactLimited.assign(m_nodes.size(), 0);
+  if (capped) {
+    m_exactOffered.resize(m_nodes.size());
+    m_exactDemands.resize(m_nodes.size());
+    m_exactLimits.resize(m_nodes.size());
+    for (int index: m_order) {
+      std::vector<Rational>&  offered = m_exactOffered[index];
+      offered.resize(m_nodes[index].outs.size());
+      m_exactDemands[index] = evalFlowNode<Rational>(m_nodes[index], ExactParamsView{m_exactParams[index], nullptr},
+          [&](int pin) {return (exactIn(index, pin, m_exactOffered));},
+          [&](int pin, const Rational& value) {offered[pin] = value;});
+    }
+    for (auto it = m_order.rbegin(); it != m_order.rend(); it++) {
+      const FlowNode& node = m_nodes[*it];
+      for (int consumer: node.consumers) {
+        const FlowNode& target = m_nodes[consumer];
+        for (int pin = 0; pin < target.ins.size(); pin++) {
+          if (target.ins[pin].node != *it)
+            continue ;
+          const Rational& offered = m_exactOffered[*it][target.ins[pin].pin];
+          Rational        taken = exactAccepted(consumer, pin);
+          if (offered <= Rational() || taken >= offered)
+            continue ;
+          Rational        limit = m_exactDemands[*it] * taken / offered;
+          if (!m_exactLimited[*it] || limit < m_exactLimits[*it]) {
+            m_exactLimits[*it] = limit;
+            m_exactLimited[*it] = 1;
+          }
+        }
+      }
+    }
+  }
+  for (int index: m_order) {
+    std::vector<Rational>&  outs = m_exactOuts[index];
+    outs.resize(m_nodes[index].outs.size());
+    m_exactRates[index] = evalFlowNode<Rational>(m_nodes[index],
+        ExactParamsView{m_exactParams[index], m_exactLimited[index] ? &m_exactLimits[index] : nullptr},
+        [&](int pin) {return (exactIn(index, pin, m_exactOuts));},
+        [&](int pin, const Rational& value) {outs[pin] = value;});
+  }
+}
+
+void  FlowGraph::markDirty(int node) {
+  m_dirty.push_back(node);
+}
+
+void  FlowGraph::evaluate() {
+  m_touched.clear();
+  m_dirty.clear();
+  for (int index: m_order)
+    evalDemand(m_nodes[index]);
+  for (auto it = m_order.rbegin(); it != m_order.rend(); it++)
+    evalLimit(m_nodes[*it]);
+  for (int index: m_order) {
+    evalNode(m_nodes[index]);
+    m_touched.push_back(index);
+  }
+}
+
+//Run step on the seeds, then on the consumers (forward) or the producers
+//(backward) of every node it reports changed. Nodes are stepped at most once,
+//in evaluation order or its reverse, and listed in visited.
+template<typename Step>
+void  FlowGraph::sweep(const std::vector<int>& seeds, bool forward, Step step, std::vector<int>& visited) {
+  std::priority_queue<int>  queue;
+  auto                      push = [&](int index) {
+    if (!m_queued[index]) {
+      m_queued[index] = 1;
+      queue.push(forward ? -m_position[index] : m_position[index]);
+    }
+  };
+
+  visited.clear();
+  for (int index: seeds)
+    push(index);
+  while (!queue.empty()) {
+    int index = m_order[forward ? -queue.top() : queue.top()];
+    queue.pop();
+    m_queued[index] = 0;
+    visited.push_back(index);
+    FlowNode& node = m_nodes[index];
+    if (!step(node))
+      continue ;
+    //Nodes on the wrong side of us in the order are part of a cycle, leave them for the next update
+    if (forward) {
+      for (int consumer: node.consumers) {
+        if (m_position[consumer] > m_position[index])
+          push(consumer);
+      }
+    }
+    else {
+      for (auto& ref: node.ins) {
+        if (ref.node >= 0 && m_position[ref.node] < m_position[index])
+          push(ref.node);
+      }
+    }
+  }
+}
+
+const std::vector<int>&   FlowGraph::update() {
+  MemoryScope memory(MS_EVALUATION);
+  m_seeds.swap(m_dirty);
+  m_dirty.clear();
+  sweep(m_seeds, true, [this](FlowNode& node) {return (evalDemand(node));}, m_demanded);
+  //What a node takes from its producers changes with its demand and caps
+  m_seeds = m_demanded;
+  for (int index: m_demanded) {
+    for (auto& ref: m_nodes[index].ins) {
+      if (ref.node >= 0)
+        m_seeds.push_back(ref.node);
+    }
+  }
+  sweep(m_seeds, false, [this](FlowNode& node) {return (evalLimit(node));}, m_limited);
+  m_seeds = m_demanded;
+  m_seeds.insert(m_seeds.end(), m_limited.begin(), m_limited.end());
+  sweep(m_seeds, true, [this](FlowNode& node) {return (evalNode(node));}, m_touched);
+  return (m_touched);
+}
@@ -0,0 +1,129 @@
+#pragma once
+
+#include "stator/stator.hpp"
+#include "statorNode.hpp"
+#include "linkTier.hpp"
+#include "rational.hpp"
+#include <ostream>
+#include <unordered_map>
+#include <vector>
+
+struct  FlowPinRef {
+  int   node = -1;
+  int   pin = -1;
+};
+
+struct  FlowNode {
+  StatorNodeType          type = SNT_NA;
+  StatorNode*             source = nullptr; //nullptr when the graph isn't built from the editor
+  const Recipe*           recipe = nullptr;
+  const Part*             part = nullptr;
+  double                  value = 0.0;      //InputNode value, GeneratorNode/StorageNode capacity, BlueprintNode scale, RecipeNode cycle time
+  std::vector<double>     ratios;           //PartNode out ratios, BlueprintNode outputs per unit of scale
+  double                  unitPower = 0.0;  //BlueprintNode net power per unit of scale
+  std::vector<FlowPinRef> ins;              //source of every in pin, node == -1 if not linked
+  std::vector<double>     caps;             //capacity of the link into every in pin, infinity if uncapped
+  std::vector<double>     outs;             //evaluated flow of every out pin
+  std::vector<int>        consumers;
+  double                  rate = 0.0;       //RecipeNode building count, OutputNode/GeneratorNode/StorageNode input, BlueprintNode scale
+  //What the node would do if nothing downstream pushed back, then what it can
+  //do given the caps after it. Throughput is the rate, the value for an InputNode
+  //and the summed input for a PartNode.
+  std::vector<double>     offered;          //flow every out pin is asked to carry
+  double                  demand = 0.0;     //throughput before back-pressure
+  double                  limit = std::numeric_limits<double>::infinity();
+};
+
+//Node type, part or recipe and index, for reports that don't have the editor
+std::string   flowNodeLabel(const FlowNode& node, int index);
+//Field between double quotes, its own quotes doubled, for the CSV reports
+void          writeCsvField(std::ostream& out, const std::string& field);
+
+//Flat copy of a factory graph evaluated in topological order.
+//Links may be capped: a first forward sweep computes what every link is
+//asked to carry, a backward sweep turns the caps into a throughput limit per
+//node (a RecipeNode passes its lost buildings upstream as missing inputs),
+//then a forward sweep evaluates under those limits.
+//Changes are pushed with markDirty/refresh/setCap and update() only
+//sweeps the nodes whose values actually changed, in both directions.
+//evaluateExact() runs the sweeps with Rational instead of double, only the
+//last one when no link is capped.
+class FlowGraph {
+  public:
+    struct  ExactParams {
+      Rational              value;
+      std::vector<Rational> ratios;
+      std::vector<Rational> inQuantities;
+      std::vector<Rational> outQuantities;
+      std::vector<Rational> caps;   //Only meaningful for the capped pins
+    };
+
+    void                      clear();
+    int                       addNode(FlowNode node);
+    void                      addLink(FlowPinRef from, FlowPinRef to, double cap = linkTierCapacity(0));
+    void                      build();
+
+    //tiers maps the in pin ids (pinId) of capped links to their LinkTier
+    void                      compile(ImNodeFlow& grid, const std::unordered_map<uint64_t, int>& tiers = {});
+    void                      refresh(StatorNode* node);
+    //Point the parts and recipes from previous at the entries of next with
+    //the same index, catalogs keep indices across reloads
+    void                      rebind(const Catalog& previous, const Catalog& next);
+    void                      setCap(int node, int pin, double cap);
+
+    void                      markDirty(int node);
+    const std::vector<int>&   update();
+    void                      evaluate();
+    void                      evaluateExact();
+
+    //Doubles typed in the editor are read as the simplest fraction within this relative tolerance
+    void                      setExactTolerance(double tolerance) {
+      m_exactTolerance = tolerance;
+      m_exactStale.assign(m_exactStale.size(), 1);
+    }
+    const Rational&           exactRate(int node) const {return (m_exactRates[node]);}
+    const std::vector<Rational>&  exactOuts(int node) const {return (m_exactOuts[node]);}
+
+    //Flow reaching an in pin, capped by its link
+    double                    inValue(const FlowNode& node, int pin) const;
+    //The link into the pin is asked for more than its capacity
+    bool                      overloaded(int node, int pin) const;
+    int                       indexOf(const BaseNode* node) const;
+    std::vector<FlowNode>&    nodes() {return (m_nodes);}
+    const std::vector<FlowNode>&  nodes() const {return (m_nodes);}
+    const std::vector<int>&   order() const {return (m_order);}
+
+  private:
+    void  readParams(FlowNode& node);
+    void  shapePins(FlowNode& node);
+    bool  evalDemand(FlowNode& node);
+    bool  evalLimit(FlowNode& node);
+    bool  evalNode(FlowNode& node);
+    double  accepted(const FlowNode& node, int pin) const;
+    void  readExactParams(int index);
+    Rational  exactIn(int index, int pin, const std::vector<std::vector<Rational>>& outs) const;
+    Rational  exactAccepted(int index, int pin) const;
+    template<typename Step>
+    void  sweep(const std::vector<int>& seeds, bool forward, Step step, std::vector<int>& visited);
+
+    std::vector<FlowNode>   m_nodes;
+    std::vector<int>        m_order;
+    std::vector<int>        m_position;
+    std::vector<char>       m_queued;
+    std::vector<int>        m_dirty;
+    std::vector<int>        m_touched;
+    std::vector<int>        m_demanded;   //Swept by update() before the limits
+    std::vector<int>        m_limited;
+    std::vector<int>        m_seeds;
+    std::unordered_map<const BaseNode*, int>  m_index;
+
+    double                              m_exactTolerance = 5e-7;
+    std::vector<ExactParams>            m_exactParams;
+    std::vector<char>                   m_exactStale;
+    std::vector<std::vector<Rational>>  m_exactOuts;
+    std::vector<Rational>               m_exactRates;
+    std::vector<std::vector<Rational>>  m_exactOffered;   //The exact sweeps behind the limits, when capped
+    std::vector<Rational>               m_exactDemands;
+    std::vector<Rational>               m_exactLimits;
+    std::vector<char>                   m_exactLimited;
+};
@@ -0,0 +1,195 @@
+#include "iconAtlas.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <functional>
+
+#define STB_IMAGE_IMPLEMENTATION
+#include <stb_image.h>
+
+IconAtlas::IconAtlas(int workers) {
+  if (workers <= 0)
+    workers = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+  for (int i = 0; i < workers; i++)
+    m_workers.emplace_back(&IconAtlas::work, this);
+}
+
+IconAtlas::~IconAtlas() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_stop = true;
+  }
+  m_wake.notify_all();
+  for (auto& worker: m_workers)
+    worker.join();
+}
+
+void  IconAtlas::setDirectory(const std::string& directory) {
+  if (directory == m_directory)
+    return ;
+  m_directory = directory;
+  //Relative paths may now name other files, they are requested again. Their
+  //old cells stay allocated, a catalog directory rarely changes
+  m_ids.clear();
+}
+
+int   IconAtlas::request(const PooledString& path) {
+  if (path.empty())
+    return (-1);
+  auto it = m_ids.find(path);
+  if (it != m_ids.end())
+    return (it->second);
+
+  int   id = m_states.size();
+  int   cell = id % pageCells;
+  if (cell == 0) {
+    m_pages.emplace_back(new Page());
+    m_pages.back()->pixels.resize(pageSize * pageSize * 4, 0);
+  }
+  m_ids.emplace(path, id);
+  m_states.push_back(IS_DECODING);
+
+  std::filesystem::path file(path.view());
+  if (file.is_relative() && !m_directory.empty())
+    file = std::filesystem::path(m_directory) / file;
+  uint8_t*  target = m_pages.back()->pixels.data()
+    + ((cell / pageColumns) * cellSize * pageSize + (cell % pageColumns) * cellSize) * 4;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_jobs.push_back({id, file.string(), target});
+  }
+  m_wake.notify_one();
+  return (id);
+}
+
+void  IconAtlas::update() {
+  std::vector<Result> results;
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_results.empty())
+      return ;
+    results.swap(m_results);
+  }
+  for (auto& result: results) {
+    if (!result.valid) {
+      m_states[result.id] = IS_FAILED;
+      continue ;
+    }
+    m_states[result.id] = IS_DECODED;
+    m_pages[result.id / pageCells]->pending.push_back(result.id % pageCells);
+  }
+}
+
+void  IconAtlas::wait() {
+  {
+    std::unique_lock<std::mutex>  lock(m_mutex);
+    m_idle.wait(lock, [this](){return (m_jobs.empty() && m_busy == 0);});
+  }
+  update();
+}
+
+void  IconAtlas::uploaded(int page, int cell) {
+  m_states[page * pageCells + cell] = IS_READY;
+}
+
+void  IconAtlas::cellUv(int cell, ImVec2& uv0, ImVec2& uv1) {
+  float   step = (float)cellSize / pageSize;
+  float   inset = 0.5f / pageSize;  //Keeps linear filtering off the neighbour cells
+
+  uv0 = ImVec2((cell % pageColumns) * step + inset, (cell / pageColumns) * step + inset);
+  uv1 = ImVec2(uv0.x + step - 2 * inset, uv0.y + step - 2 * inset);
+}
+
+void  IconAtlas::draw(const PooledString& path, std::string_view label, float size) {
+  int   id = request(path);
+
+  if (id >= 0 && m_states[id] == IS_READY) {
+    ImVec2  uv0, uv1;
+    cellUv(id % pageCells, uv0, uv1);
+    ImGui::Image(m_pages[id / pageCells]->texture, ImVec2(size, size), uv0, uv1);
+    return ;
+  }
+  ImVec2      pos = ImGui::GetCursorScreenPos();
+  ImDrawList* drawList = ImGui::GetWindowDrawList();
+  size_t      hash = std::hash<std::string_view>()(label);
+  ImU32       color = IM_COL32(64 + hash % 128, 64 + (hash >> 8) % 128, 64 + (hash >> 16) % 128, 255);
+
+  drawList->AddRectFilled(pos, pos + ImVec2(size, size), color, size * 0.2f);
+  if (!label.empty()) {
+    char    letter[2] = {label[0], '\0'};
+    ImVec2  textSize = ImGui::CalcTextSize(letter);
+    drawList->AddText(pos + (ImVec2(size, size) - textSize) * 0.5f, IM_COL32_WHITE, letter);
+  }
+  ImGui::Dummy(ImVec2(size, size));
+}
+
+void  IconAtlas::work() {
+  while (true) {
+    Job job;
+    {
+      std::unique_lock<std::mutex>  lock(m_mutex);
+      m_wake.wait(lock, [this](){return (m_stop || !m_jobs.empty());});
+      if (m_stop)
+        return ;
+      job = std::move(m_jobs.front());
+      m_jobs.pop_front();
+      m_busy++;
+    }
+    //Cells never overlap, the page is written without the lock
+    bool  valid = decode(job.path, job.target);
+    {
+      std::lock_guard<std::mutex> lock(m_mutex);
+      m_results.push_back({job.id, valid});
+      m_busy--;
+    }
+    m_idle.notify_all();
+  }
+}
+
+//Box filter into the cell, aspect kept and centred. Colours are weighted by
+//alpha so transparent borders do not darken the edges
+bool  IconAtlas::decode(const std::string& path, uint8_t* target) {
+  int       width, height, channels;
+  uint8_t*  pixels = stbi_load(path.c_str(), &width, &height, &channels, 4);
+
+  if (pixels == nullptr)
+    return (false);
+  float scale = std::min((float)cellSize / width, (float)cellSize / height);
+  int   outWidth = std::clamp((int)std::lround(width * scale), 1, cellSize);
+  int   outHeight = std::clamp((int)std::lround(height * scale), 1, cellSize);
+  int   left = (cellSize - outWidth) / 2;
+  int   top = (cellSize - outHeight) / 2;
+
+  for (int y = 0; y < outHeight; y++) {
+    int   y0 = y * height / outHeight;
+    int   y1 = std::max(y0 + 1, (y + 1) * height / outHeight);
+    for (int x = 0; x < outWidth; x++) {
+      int       x0 = x * width / outWidth;
+      int       x1 = std::max(x0 + 1, (x + 1) * width / outWidth);
+      uint64_t  sum[4] = {0, 0, 0, 0};
+      for (int sy = y0; sy < y1; sy++) {
+        const uint8_t*  row = pixels + (sy * width) * 4;
+        for (int sx = x0; sx < x1; sx++) {
+          const uint8_t*  p = row + sx * 4;
+          sum[0] += p[0] * p[3];
+          sum[1] += p[1] * p[3];
+          sum[2] += p[2] * p[3];
+          sum[3] += p[3];
+        }
+      }
+      uint8_t*  out = target + ((top + y) * pageSize + left + x) * 4;
+      uint64_t  count = (uint64_t)(y1 - y0) * (x1 - x0);
+      if (sum[3] == 0) {
+        std::memset(out, 0, 4);
+        continue ;
+      }
+      out[0] = sum[0] / sum[3];
+      out[1] = sum[1] / sum[3];
+      out[2] = sum[2] / sum[3];
+      out[3] = sum[3] / count;
+    }
+  }
+  stbi_image_free(pixels);
+  return (true);
+}
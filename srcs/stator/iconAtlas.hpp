@@ -0,0 +1,96 @@
+#pragma once
+
+#include "stringPool.hpp"
+#include <imgui.h>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//Part icons decoded on worker threads into the cells of a few atlas pages.
+//Every icon is scaled to fit one cell, so packing is a running counter: icon
+//id i lives in page i / pageCells at cell i % pageCells. Nothing here touches
+//the GPU, the renderer uploads the cells listed in Page::pending and reports
+//them with uploaded(). Until then the icon is drawn as a placeholder.
+class IconAtlas {
+  public:
+    static constexpr int  cellSize = 64;
+    static constexpr int  pageSize = 1024;
+    static constexpr int  pageColumns = pageSize / cellSize;
+    static constexpr int  pageCells = pageColumns * pageColumns;
+
+    enum IconState {
+      IS_DECODING,
+      IS_DECODED,   //In its page, waiting for the upload
+      IS_READY,
+      IS_FAILED,
+    };
+
+    struct  Page {
+      std::vector<uint8_t>  pixels;       //RGBA, pageSize x pageSize
+      std::vector<int>      pending;      //Decoded cells not uploaded yet
+      ImTextureID           texture = 0;  //Set by the renderer
+    };
+
+    static IconAtlas& instance() {
+      static IconAtlas  atlas;
+      return (atlas);
+    }
+
+    //workers = 0 keeps one hardware thread for the UI
+    IconAtlas(int workers = 0);
+    ~IconAtlas();
+
+    //Relative icon paths are resolved against it, usually the catalog directory
+    void  setDirectory(const std::string& directory);
+    //Id of the icon at path, decoding is queued the first time. -1 for an empty path
+    int   request(const PooledString& path);
+    //Collect what the workers decoded since the last call, UI thread only
+    void  update();
+    //Block until every queued icon is decoded, then update()
+    void  wait();
+    //Called by the renderer once a cell is on the GPU
+    void  uploaded(int page, int cell);
+
+    IconState                             state(int id) const {return (m_states[id]);}
+    std::vector<std::unique_ptr<Page>>&   pages() {return (m_pages);}
+    static void                           cellUv(int cell, ImVec2& uv0, ImVec2& uv1);
+
+    //size x size item showing the icon, or a tile with the first letter of
+    //label until it is uploaded
+    void  draw(const PooledString& path, std::string_view label, float size);
+
+  private:
+    struct  Job {
+      int         id;
+      std::string path;
+      uint8_t*    target;   //Top left of the cell in its page
+    };
+    struct  Result {
+      int   id;
+      bool  valid;
+    };
+
+    void  work();
+    static bool   decode(const std::string& path, uint8_t* target);
+
+    std::string                           m_directory;
+    std::unordered_map<PooledString, int> m_ids;
+    std::vector<IconState>                m_states;
+    std::vector<std::unique_ptr<Page>>    m_pages;
+
+    std::mutex                m_mutex;
+    std::condition_variable   m_wake;
+    std::condition_variable   m_idle;
+    std::deque<Job>           m_jobs;
+    std::vector<Result>       m_results;
+    int                       m_busy = 0;
+    bool                      m_stop = false;
+    std::vector<std::thread>  m_workers;
+};
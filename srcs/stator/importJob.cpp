@@ -0,0 +1,69 @@
+#include "importJob.hpp"
+#include "catalogLoader.hpp"
+#include "memoryTracker.hpp"
+#include <boost/json/stream_parser.hpp>
+#include <filesystem>
+#include <fstream>
+
+static json::value  readJson(const std::string& path, std::atomic<float>* progress, std::atomic<bool>* cancel) {
+  MemoryScope         memory(MS_SERIALIZATION);
+  std::ifstream       file(path, std::ios::binary);
+  json::stream_parser parser;
+  std::vector<char>   buffer(1 << 20);
+  uintmax_t           size = std::max<uintmax_t>(std::filesystem::file_size(path), 1);
+  uintmax_t           read = 0;
+
+  if (!file)
+    throw std::runtime_error("can't open file");
+  while (file) {
+    file.read(buffer.data(), buffer.size());
+    parser.write(buffer.data(), file.gcount());
+    read += file.gcount();
+    //Parsing is most of the work, resolving the result takes the last tenth
+    if (progress != nullptr)
+      *progress = 0.9f * read / size;
+    if (cancel != nullptr && *cancel)
+      throw std::runtime_error("cancelled");
+  }
+  parser.finish();
+  return (parser.release());
+}
+
+ImportResult  importFile(const std::string& path, const Catalog& catalog
+    , std::atomic<float>* progress, std::atomic<bool>* cancel) {
+  ImportResult  result;
+  result.path = path;
+  try {
+    json::value   document = readJson(path, progress, cancel);
+    json::object* obj = document.if_object();
+    if (obj == nullptr)
+      throw std::runtime_error("not a json object");
+    if (obj->contains("parts")) {
+      result.kind = IK_PARTS;
+      result.parts = readParts(document, result.report);
+    }
+    else if (obj->contains("recipes")) {
+      result.kind = IK_RECIPES;
+      result.recipes = readRecipes(document, result.report);
+    }
+    else if (auto type = obj->if_contains("type"); type != nullptr && type->is_string()) {
+      if (type->as_string() == "SNT_FACTORY_NODE")
+        result.kind = IK_FACTORY;
+      else if (type->as_string() == "SNT_FRAGMENT")
+        result.kind = IK_FRAGMENT;
+      if (result.kind == IK_UNKNOWN || !planFromFragment(document, catalog, result.plan, &result.report))
+        throw std::runtime_error("unknown factory format");
+      obj->erase("nodes");
+      result.document = std::move(document);
+    }
+    else
+      throw std::runtime_error("neither a factory nor a catalog");
+  }
+  catch (const std::exception& e) {
+    result.kind = IK_UNKNOWN;
+    result.error = e.what();
+  }
+  if (progress != nullptr)
+    *progress = 1.f;
+  return (result);
+}
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "stator/stator.hpp"
+#include "factoryGenerator.hpp"
+#include <atomic>
+#include <memory>
+#include <string>
+#include <thread>
+
+enum ImportKind {
+  IK_UNKNOWN,
+  IK_FACTORY,
+  IK_FRAGMENT,
+  IK_PARTS,
+  IK_RECIPES,
+};
+
+struct  ImportResult {
+  std::string         path;
+  ImportKind          kind = IK_UNKNOWN;
+  std::string         error;
+  LoadReport          report;     //Entries skipped because they didn't validate
+  json::value         document;   //Factory header (name, blueprints), nodes are moved to plan
+  FactoryPlan         plan;
+  std::vector<Part>   parts;
+  std::vector<Recipe> recipes;
+};
+
+//Read, parse and resolve a factory save, a fragment or a catalog file.
+//progress goes from 0 to 1 as the file is streamed through the parser.
+//Invalid entries are skipped and listed in the result's report, error is
+//only set when nothing could be imported.
+ImportResult  importFile(const std::string& path, const Catalog& catalog
+    , std::atomic<float>* progress = nullptr, std::atomic<bool>* cancel = nullptr);
+
+//Runs importFile on its own thread against the catalog current when it
+//started. Entries are only ever appended by a reload, so indices resolved
+//against it stay valid in whatever catalog is current once it is done.
+class ImportJob {
+  public:
+    ~ImportJob() {
+      stop();
+    }
+
+    void  start(const std::string& path, CatalogRef catalog) {
+      stop();
+      m_path = path;
+      m_state = std::make_shared<State>();
+      auto state = m_state;
+      m_thread = std::thread([path, catalog = std::move(catalog), state]() {
+        state->result = importFile(path, *catalog, &state->progress, &state->cancel);
+        state->done = true;
+      });
+    }
+    void  stop() {
+      if (m_state)
+        m_state->cancel = true;
+      if (m_thread.joinable())
+        m_thread.join();
+      m_state = nullptr;
+    }
+
+    const std::string&  path() const {return (m_path);}
+    bool                done() const {return (m_state != nullptr && m_state->done);}
+    float               progress() const {return (m_state != nullptr ? m_state->progress.load() : 0.f);}
+    //Only once done
+    ImportResult        take() {
+      if (m_thread.joinable())
+        m_thread.join();
+      return (std::move(m_state->result));
+    }
+
+  private:
+    struct  State {
+      std::atomic<float>  progress = 0.f;
+      std::atomic<bool>   cancel = false;
+      std::atomic<bool>   done = false;
+      ImportResult        result;
+    };
+
+    std::string             m_path;
+    std::thread             m_thread;
+    std::shared_ptr<State>  m_state;
+};
@@ -0,0 +1,312 @@
+#include "layout.hpp"
+#include <algorithm>
+
+namespace {
+
+//Real nodes first then the dummies splitting long edges
+struct  Layered {
+  std::vector<int>                layer;
+  std::vector<ImVec2>             sizes;
+  std::vector<std::vector<int>>   up;
+  std::vector<std::vector<int>>   down;
+  std::vector<std::vector<int>>   layers;
+  std::vector<int>                position;
+};
+
+//Reverse the back edges of a DFS so the graph becomes acyclic
+std::vector<std::pair<int, int>>  acyclicEdges(const LayoutGraph& graph) {
+  size_t                          count = graph.sizes.size();
+  std::vector<std::vector<int>>   outgoing(count);
+  std::vector<char>               state(count, 0);
+  std::vector<std::pair<int, int>>  edges;
+
+  for (auto& edge: graph.edges) {
+    if (edge.first != edge.second && edge.first < count && edge.second < count)
+      outgoing[edge.first].push_back(edge.second);
+  }
+  edges.reserve(graph.edges.size());
+  std::vector<std::pair<int, int>>  stack;
+  for (int root = 0; root < count; root++) {
+    if (state[root])
+      continue ;
+    state[root] = 1;
+    stack.push_back({root, 0});
+    while (!stack.empty()) {
+      int node = stack.back().first;
+      int next = stack.back().second;
+      if (next == outgoing[node].size()) {
+        state[node] = 2;
+        stack.pop_back();
+        continue ;
+      }
+      stack.back().second++;
+      int to = outgoing[node][next];
+      if (state[to] == 1) {
+        edges.push_back({to, node});
+        continue ;
+      }
+      edges.push_back({node, to});
+      if (state[to] == 0) {
+        state[to] = 1;
+        stack.push_back({to, 0});
+      }
+    }
+  }
+  return (edges);
+}
+
+//Longest path from the sources, then from the sinks back every node with at
+//least as many outputs as inputs is pulled next to its first consumer, which
+//shortens more edges than it stretches. Inputs don't stretch across the whole
+//factory and long edges need far fewer dummies.
+void  assignLayers(Layered& graph, size_t count, const std::vector<std::pair<int, int>>& edges) {
+  std::vector<std::vector<int>>   outgoing(count);
+  std::vector<int>                inDegree(count, 0);
+  std::vector<int>                order;
+
+  for (auto& edge: edges) {
+    outgoing[edge.first].push_back(edge.second);
+    inDegree[edge.second]++;
+  }
+  order.reserve(count);
+  for (int i = 0; i < count; i++) {
+    if (inDegree[i] == 0)
+      order.push_back(i);
+  }
+  graph.layer.assign(count, 0);
+  for (int i = 0; i < order.size(); i++) {
+    for (int to: outgoing[order[i]]) {
+      graph.layer[to] = std::max(graph.layer[to], graph.layer[order[i]] + 1);
+      if (--inDegree[to] == 0)
+        order.push_back(to);
+    }
+  }
+  std::vector<int>  incoming(count, 0);
+  for (auto& edge: edges)
+    incoming[edge.second]++;
+  for (auto node = order.rbegin(); node != order.rend(); node++) {
+    if (outgoing[*node].empty() || outgoing[*node].size() < incoming[*node])
+      continue ;
+    int closest = graph.layer[outgoing[*node][0]];
+    for (int to: outgoing[*node])
+      closest = std::min(closest, graph.layer[to]);
+    graph.layer[*node] = closest - 1;
+  }
+}
+
+void  addDummies(Layered& graph, const std::vector<std::pair<int, int>>& edges) {
+  size_t  count = graph.layer.size();
+  graph.up.assign(count, {});
+  graph.down.assign(count, {});
+  for (auto& edge: edges) {
+    int from = edge.first;
+    for (int layer = graph.layer[from] + 1; layer < graph.layer[edge.second]; layer++) {
+      int dummy = graph.layer.size();
+      graph.layer.push_back(layer);
+      graph.sizes.push_back(ImVec2(0, 0));
+      graph.up.push_back({from});
+      graph.down.push_back({});
+      graph.down[from].push_back(dummy);
+      from = dummy;
+    }
+    graph.down[from].push_back(edge.second);
+    graph.up[edge.second].push_back(from);
+  }
+  int layerCount = 0;
+  for (int layer: graph.layer)
+    layerCount = std::max(layerCount, layer + 1);
+  graph.layers.assign(layerCount, {});
+  graph.position.assign(graph.layer.size(), 0);
+  for (int i = 0; i < graph.layer.size(); i++) {
+    graph.position[i] = graph.layers[graph.layer[i]].size();
+    graph.layers[graph.layer[i]].push_back(i);
+  }
+}
+
+//Inversions between two layers counted with a Fenwick tree, O(E log V)
+long  countCrossings(const Layered& graph, int layer) {
+  const std::vector<int>& lower = graph.layers[layer + 1];
+  std::vector<int>        tree(lower.size() + 1, 0);
+  std::vector<int>        targets;
+  long                    crossings = 0;
+  int                     inserted = 0;
+
+  for (int node: graph.layers[layer]) {
+    targets.clear();
+    for (int to: graph.down[node])
+      targets.push_back(graph.position[to]);
+    std::sort(targets.begin(), targets.end());
+    for (int target: targets) {
+      int below = 0;
+      for (int i = target + 1; i > 0; i -= i & -i)
+        below += tree[i];
+      crossings += inserted - below;
+      for (int i = target + 1; i < tree.size(); i += i & -i)
+        tree[i]++;
+      inserted++;
+    }
+  }
+  return (crossings);
+}
+
+long  countCrossings(const Layered& graph) {
+  long  crossings = 0;
+  for (int layer = 0; layer + 1 < graph.layers.size(); layer++)
+    crossings += countCrossings(graph, layer);
+  return (crossings);
+}
+
+//Sort a layer by the mean position of its neighbours in the fixed layer,
+//nodes without neighbours keep their place
+void  orderLayer(Layered& graph, int layer, bool useUp) {
+  std::vector<int>&                 nodes = graph.layers[layer];
+  std::vector<std::pair<double, int>> keys(nodes.size());
+
+  for (int i = 0; i < nodes.size(); i++) {
+    auto& neighbours = useUp ? graph.up[nodes[i]] : graph.down[nodes[i]];
+    double  key = i;
+    if (!neighbours.empty()) {
+      key = 0.0;
+      for (int neighbour: neighbours)
+        key += graph.position[neighbour];
+      key /= neighbours.size();
+    }
+    keys[i] = {key, nodes[i]};
+  }
+  std::stable_sort(keys.begin(), keys.end(), [](auto& a, auto& b) {
+    return (a.first < b.first);
+  });
+  for (int i = 0; i < nodes.size(); i++) {
+    nodes[i] = keys[i].second;
+    graph.position[nodes[i]] = i;
+  }
+}
+
+void  setOrder(Layered& graph, const std::vector<std::vector<int>>& layers) {
+  graph.layers = layers;
+  for (auto& nodes: graph.layers) {
+    for (int i = 0; i < nodes.size(); i++)
+      graph.position[nodes[i]] = i;
+  }
+}
+
+//Columns are as wide as their widest node, rows are stacked in order
+std::vector<ImVec2>  packCoordinates(const Layered& graph, const LayoutOptions& options) {
+  std::vector<ImVec2> coords(graph.layer.size());
+  float               x = options.origin.x;
+
+  for (auto& nodes: graph.layers) {
+    float width = 0.f;
+    float y = options.origin.y;
+    for (int node: nodes) {
+      coords[node] = ImVec2(x, y);
+      y += graph.sizes[node].y + options.nodeSpacing;
+      width = std::max(width, graph.sizes[node].x);
+    }
+    x += width + options.layerSpacing;
+  }
+  return (coords);
+}
+
+//Move every node toward the mean center of its neighbours in the previous
+//layer while keeping the order and spacing. A top down and a bottom up
+//placement both respect the spacing, so does their mean.
+void  alignLayer(const Layered& graph, std::vector<ImVec2>& coords, int layer, bool useUp, float spacing) {
+  const std::vector<int>& nodes = graph.layers[layer];
+  size_t                  count = nodes.size();
+  std::vector<float>      wanted(count);
+  std::vector<float>      forward(count);
+  std::vector<float>      backward(count);
+
+  if (count == 0)
+    return ;
+  for (int i = 0; i < count; i++) {
+    int   node = nodes[i];
+    auto& neighbours = useUp ? graph.up[node] : graph.down[node];
+    if (neighbours.empty()) {
+      wanted[i] = coords[node].y;
+      continue ;
+    }
+    float center = 0.f;
+    for (int neighbour: neighbours)
+      center += coords[neighbour].y + graph.sizes[neighbour].y * 0.5f;
+    wanted[i] = center / neighbours.size() - graph.sizes[node].y * 0.5f;
+  }
+  forward[0] = wanted[0];
+  for (int i = 1; i < count; i++)
+    forward[i] = std::max(wanted[i], forward[i - 1] + graph.sizes[nodes[i - 1]].y + spacing);
+  backward[count - 1] = wanted[count - 1];
+  for (int i = count - 2; i >= 0; i--)
+    backward[i] = std::min(wanted[i], backward[i + 1] - graph.sizes[nodes[i]].y - spacing);
+  for (int i = 0; i < count; i++)
+    coords[nodes[i]].y = (forward[i] + backward[i]) * 0.5f;
+}
+
+std::vector<ImVec2>  realNodes(std::vector<ImVec2> coords, size_t count) {
+  coords.resize(count);
+  return (coords);
+}
+
+}
+
+std::vector<ImVec2> computeLayout(const LayoutGraph& graph, const LayoutOptions& options, LayoutProgress* progress) {
+  size_t  count = graph.sizes.size();
+  Layered layered;
+
+  if (count == 0)
+    return (std::vector<ImVec2>());
+  layered.sizes = graph.sizes;
+  auto  edges = acyclicEdges(graph);
+  assignLayers(layered, count, edges);
+  addDummies(layered, edges);
+  if (progress != nullptr) {
+    progress->publish(realNodes(packCoordinates(layered, options), count), 0.1f);
+    if (progress->cancel)
+      return (realNodes(packCoordinates(layered, options), count));
+  }
+
+  //Alternate down and up barycenter sweeps, keep the best order seen
+  long                          best = countCrossings(layered);
+  std::vector<std::vector<int>> bestLayers = layered.layers;
+  for (int sweep = 0; sweep < options.sweeps && best > 0; sweep++) {
+    if (sweep % 2 == 0) {
+      for (int layer = 1; layer < layered.layers.size(); layer++)
+        orderLayer(layered, layer, true);
+    }
+    else {
+      for (int layer = layered.layers.size() - 2; layer >= 0; layer--)
+        orderLayer(layered, layer, false);
+    }
+    long  crossings = countCrossings(layered);
+    if (crossings < best) {
+      best = crossings;
+      bestLayers = layered.layers;
+    }
+    if (progress != nullptr) {
+      progress->publish(realNodes(packCoordinates(layered, options), count)
+          , 0.1f + 0.7f * (sweep + 1) / options.sweeps);
+      if (progress->cancel)
+        break ;
+    }
+  }
+  setOrder(layered, bestLayers);
+
+  std::vector<ImVec2> coords = packCoordinates(layered, options);
+  for (int pass = 0; pass < 4; pass++) {
+    if (pass % 2 == 0) {
+      for (int layer = 1; layer < layered.layers.size(); layer++)
+        alignLayer(layered, coords, layer, true, options.nodeSpacing);
+    }
+    else {
+      for (int layer = layered.layers.size() - 2; layer >= 0; layer--)
+        alignLayer(layered, coords, layer, false, options.nodeSpacing);
+    }
+  }
+  //Alignment may pull nodes above the origin
+  float top = coords[0].y;
+  for (auto& coord: coords)
+    top = std::min(top, coord.y);
+  for (auto& coord: coords)
+    coord.y += options.origin.y - top;
+  return (realNodes(coords, count));
+}
@@ -0,0 +1,205 @@
+#include "linkRenderer.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <map>
+
+void  LinkRenderer::computeControls(const std::vector<Link>& links, std::vector<Geometry>& geometry) const {
+  for (int i = 0; i < links.size(); i++) {
+    float   offset = std::max(50.f, std::fabs(links[i].to.x - links[i].from.x) * 0.5f);
+    Geometry& link = geometry[i];
+    link.controls[0] = links[i].from;
+    link.controls[1] = ImVec2(links[i].from.x + offset, links[i].from.y);
+    link.controls[2] = ImVec2(links[i].to.x - offset, links[i].to.y);
+    link.controls[3] = links[i].to;
+  }
+  if (!m_bundling)
+    return ;
+
+  //Pull the inner control points of a corridor toward their mean
+  struct  Bundle {
+    ImVec2  controls[2];
+    int     count = 0;
+  };
+  std::map<std::array<int, 4>, Bundle>  bundles;
+  std::vector<Bundle*>                  linkBundle(links.size());
+  for (int i = 0; i < links.size(); i++) {
+    std::array<int, 4>  key = {(int)std::floor(links[i].from.x / m_corridor), (int)std::floor(links[i].from.y / m_corridor)
+      , (int)std::floor(links[i].to.x / m_corridor), (int)std::floor(links[i].to.y / m_corridor)};
+    Bundle& bundle = bundles[key];
+    bundle.controls[0] += geometry[i].controls[1];
+    bundle.controls[1] += geometry[i].controls[2];
+    bundle.count++;
+    linkBundle[i] = &bundle;
+  }
+  for (int i = 0; i < links.size(); i++) {
+    Bundle* bundle = linkBundle[i];
+    if (bundle->count < 2)
+      continue ;
+    for (int c = 0; c < 2; c++) {
+      ImVec2  mean = bundle->controls[c] / (float)bundle->count;
+      ImVec2& control = geometry[i].controls[c + 1];
+      control = control + (mean - control) * m_strength;
+    }
+  }
+}
+
+void  LinkRenderer::tessellate(int index) {
+  Geometry& link = m_geometry[index];
+  ImVec2*   points = &m_points[index * (segments + 1)];
+
+  link.min = link.controls[0];
+  link.max = link.controls[0];
+  for (int i = 0; i <= segments; i++) {
+    float   t = (float)i / segments;
+    float   u = 1.f - t;
+    points[i] = link.controls[0] * (u * u * u) + link.controls[1] * (3.f * u * u * t)
+      + link.controls[2] * (3.f * u * t * t) + link.controls[3] * (t * t * t);
+    link.min = ImVec2(std::min(link.min.x, points[i].x), std::min(link.min.y, points[i].y));
+    link.max = ImVec2(std::max(link.max.x, points[i].x), std::max(link.max.y, points[i].y));
+  }
+}
+
+bool  LinkRenderer::update(const std::vector<Link>& links) {
+  bool  resized = links.size() != m_links.size();
+  bool  rekeyed = resized;
+  bool  changed = resized || m_forceUpdate;
+
+  for (int i = 0; i < links.size() && !rekeyed; i++)
+    rekeyed = m_links[i].key != links[i].key;
+  m_scratch.resize(links.size());
+  computeControls(links, m_scratch);
+  if (rekeyed) {
+    //Selection follows the links, wherever they moved in the list
+    m_selectedKeys.clear();
+    for (int i = 0; i < m_links.size(); i++) {
+      if (m_selected[i])
+        m_selectedKeys.insert(m_links[i].key);
+    }
+    m_links.resize(links.size());
+    m_geometry.resize(links.size());
+    m_points.resize(links.size() * (segments + 1));
+    m_selected.assign(links.size(), 0);
+    for (int i = 0; i < links.size(); i++)
+      m_selected[i] = m_selectedKeys.count(links[i].key) != 0;
+    hovered = -1;
+  }
+  bool  rebuild = rekeyed || m_forceUpdate;
+  for (int i = 0; i < links.size(); i++) {
+    bool  moved = rebuild;
+    for (int c = 0; c < 4 && !moved; c++)
+      moved = m_geometry[i].controls[c].x != m_scratch[i].controls[c].x || m_geometry[i].controls[c].y != m_scratch[i].controls[c].y;
+    m_links[i] = links[i];
+    if (!moved)
+      continue ;
+    if (!rebuild)
+      eraseCells(i);
+    std::copy(m_scratch[i].controls, m_scratch[i].controls + 4, m_geometry[i].controls);
+    tessellate(i);
+    if (!rebuild)
+      insertCells(i);
+    changed = true;
+  }
+  m_forceUpdate = false;
+  if (rebuild)
+    rebuildCells();
+  return (changed);
+}
+
+void  LinkRenderer::rebuildCells() {
+  m_cells.clear();
+  for (int i = 0; i < m_links.size(); i++)
+    insertCells(i);
+}
+
+void  LinkRenderer::insertCells(int index) {
+  ImVec2* points = &m_points[index * (segments + 1)];
+  for (int s = 0; s <= segments; s++) {
+    auto& cell = m_cells[cellKey(std::floor(points[s].x / m_cellSize), std::floor(points[s].y / m_cellSize))];
+    if (cell.empty() || cell.back() != index)
+      cell.push_back(index);
+  }
+}
+
+//Called before the link is tessellated again, its points still are the ones it was inserted with
+void  LinkRenderer::eraseCells(int index) {
+  ImVec2* points = &m_points[index * (segments + 1)];
+  for (int s = 0; s <= segments; s++) {
+    auto  cell = m_cells.find(cellKey(std::floor(points[s].x / m_cellSize), std::floor(points[s].y / m_cellSize)));
+    if (cell == m_cells.end())
+      continue ;
+    auto  found = std::find(cell->second.begin(), cell->second.end(), index);
+    if (found != cell->second.end())
+      cell->second.erase(found);
+    if (cell->second.empty())
+      m_cells.erase(cell);
+  }
+}
+
+int   LinkRenderer::hitTest(ImVec2 pos, float radius) const {
+  int   cellX = std::floor(pos.x / m_cellSize);
+  int   cellY = std::floor(pos.y / m_cellSize);
+  int   best = -1;
+  float bestDistance = radius * radius;
+
+  for (int x = cellX - 1; x <= cellX + 1; x++) {
+    for (int y = cellY - 1; y <= cellY + 1; y++) {
+      auto it = m_cells.find(cellKey(x, y));
+      if (it == m_cells.end())
+        continue ;
+      for (int link: it->second) {
+        const ImVec2* points = &m_points[link * (segments + 1)];
+        for (int s = 0; s < segments; s++) {
+          ImVec2  segment = points[s + 1] - points[s];
+          float   lengthSq = segment.x * segment.x + segment.y * segment.y;
+          ImVec2  delta = pos - points[s];
+          float   t = lengthSq > 0.f ? std::clamp((delta.x * segment.x + delta.y * segment.y) / lengthSq, 0.f, 1.f) : 0.f;
+          ImVec2  closest = delta - segment * t;
+          float   distance = closest.x * closest.x + closest.y * closest.y;
+          if (distance < bestDistance) {
+            bestDistance = distance;
+            best = link;
+          }
+        }
+      }
+    }
+  }
+  return (best);
+}
+
+void  LinkRenderer::draw(ImDrawList* drawList, const Transform& transform, ImVec2 clipMin, ImVec2 clipMax, float thickness) {
+  constexpr int chunkQuads = 4096;  //stays under 16 bit indices per reservation
+  ImVec2        uv = ImGui::GetFontTexUvWhitePixel();
+  ImVec2        canvasMin = (clipMin - transform.offset) / transform.scale;
+  ImVec2        canvasMax = (clipMax - transform.offset) / transform.scale;
+  int           reserved = 0;
+  int           written = 0;
+
+  for (int i = 0; i < m_links.size(); i++) {
+    Geometry& link = m_geometry[i];
+    if (link.max.x < canvasMin.x || link.min.x > canvasMax.x || link.max.y < canvasMin.y || link.min.y > canvasMax.y)
+      continue ;
+    if (reserved - written < segments) {
+      if (reserved > written)
+        drawList->PrimUnreserve((reserved - written) * 6, (reserved - written) * 4);
+      drawList->PrimReserve(chunkQuads * 6, chunkQuads * 4);
+      reserved = chunkQuads;
+      written = 0;
+    }
+    float   half = thickness * 0.5f * (m_selected[i] ? 2.f : i == hovered ? 1.5f : 1.f);
+    ImU32   color = m_links[i].color;
+    ImVec2* points = &m_points[i * (segments + 1)];
+    ImVec2  a = points[0] * transform.scale + transform.offset;
+    for (int s = 0; s < segments; s++) {
+      ImVec2  b = points[s + 1] * transform.scale + transform.offset;
+      ImVec2  direction = b - a;
+      float   length = std::sqrt(direction.x * direction.x + direction.y * direction.y);
+      ImVec2  normal = length > 0.f ? ImVec2(-direction.y, direction.x) * (half / length) : ImVec2(0, 0);
+      drawList->PrimQuadUV(a + normal, b + normal, b - normal, a - normal, uv, uv, uv, uv, color);
+      a = b;
+    }
+    written += segments;
+  }
+  if (reserved > written)
+    drawList->PrimUnreserve((reserved - written) * 6, (reserved - written) * 4);
+}
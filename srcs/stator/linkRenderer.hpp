@@ -0,0 +1,77 @@
+#pragma once
+
+#include <imgui.h>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+//Draws many bezier links from cached geometry. A link is only tessellated
+//and moved in the hit test cells again when its endpoints move, drawing writes the cached segments as quads
+//straight into the draw list in a few large reservations.
+class LinkRenderer {
+  public:
+    static constexpr int  segments = 16;
+
+    struct  Link {
+      const void* key;
+      ImVec2      from;   //canvas space
+      ImVec2      to;
+      ImU32       color;
+    };
+
+    //screen = canvas * scale + offset
+    struct  Transform {
+      ImVec2  offset;
+      float   scale = 1.f;
+    };
+
+    //Links whose ends fall in the same corridor cells share their middle
+    void  setBundling(bool enabled, float corridor = 200.f, float strength = 0.8f) {
+      m_bundling = enabled;
+      m_corridor = corridor;
+      m_strength = strength;
+      m_forceUpdate = true;
+    }
+    bool  bundling() const {return (m_bundling);}
+
+    //Returns true when the link set or any geometry changed
+    bool  update(const std::vector<Link>& links);
+    void  draw(ImDrawList* drawList, const Transform& transform, ImVec2 clipMin, ImVec2 clipMax, float thickness);
+
+    //Closest link within radius of a canvas position, -1 if none
+    int   hitTest(ImVec2 pos, float radius) const;
+
+    size_t                  size() const {return (m_links.size());}
+    const Link&             link(int index) const {return (m_links[index]);}
+    std::vector<char>&      selection() {return (m_selected);}
+    int                     hovered = -1;
+
+  private:
+    struct  Geometry {
+      ImVec2  controls[4];
+      ImVec2  min;
+      ImVec2  max;
+    };
+
+    void      computeControls(const std::vector<Link>& links, std::vector<Geometry>& geometry) const;
+    void      tessellate(int index);
+    void      rebuildCells();
+    void      insertCells(int index);
+    void      eraseCells(int index);
+    long long cellKey(int x, int y) const {return (((long long)x << 32) ^ (unsigned int)y);}
+
+    std::vector<Link>       m_links;
+    std::vector<Geometry>   m_geometry;
+    std::vector<ImVec2>     m_points;     //segments + 1 per link
+    std::vector<char>       m_selected;
+    std::vector<Geometry>   m_scratch;    //controls of the links being updated
+    std::unordered_set<const void*> m_selectedKeys;
+
+    std::unordered_map<long long, std::vector<int>> m_cells;
+    float                   m_cellSize = 100.f;
+
+    bool                    m_bundling = false;
+    float                   m_corridor = 200.f;
+    float                   m_strength = 0.8f;
+    bool                    m_forceUpdate = true;
+};
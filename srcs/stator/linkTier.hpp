@@ -0,0 +1,27 @@
+#pragma once
+
+#include <limits>
+
+//Belt and pipe tiers a link can be set to. Saves refer to them by index,
+//new tiers only ever go at the end.
+struct  LinkTier {
+  const char* name;
+  double      capacity; //Items or m3 per minute
+};
+
+inline constexpr LinkTier linkTiers[] = {
+  {"Unlimited", std::numeric_limits<double>::infinity()},
+  {"Conveyor Belt Mk.1", 60.0},
+  {"Conveyor Belt Mk.2", 120.0},
+  {"Conveyor Belt Mk.3", 270.0},
+  {"Conveyor Belt Mk.4", 480.0},
+  {"Conveyor Belt Mk.5", 780.0},
+  {"Conveyor Belt Mk.6", 1200.0},
+  {"Pipeline Mk.1", 300.0},
+  {"Pipeline Mk.2", 600.0},
+};
+inline constexpr int  linkTierCount = sizeof(linkTiers) / sizeof(linkTiers[0]);
+
+inline double   linkTierCapacity(int tier) {
+  return (tier > 0 && tier < linkTierCount ? linkTiers[tier].capacity : linkTiers[0].capacity);
+}
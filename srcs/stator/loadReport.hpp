@@ -0,0 +1,94 @@
+#pragma once
+
+#include "stator/stator.hpp"
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct  LoadIssue {
+  std::string   path;     //JSON path of the offending value, e.g. nodes[3].recipeId
+  std::string   message;
+};
+
+//Schema errors collected while loading. Loaders skip what is wrong and keep
+//going, so one bad entry costs that entry and not the whole file.
+class LoadReport {
+  public:
+    void  error(const std::string& path, const std::string& message) {
+      m_issues.push_back({path, message});
+    }
+
+    bool                            empty() const {return (m_issues.empty());}
+    const std::vector<LoadIssue>&   issues() const {return (m_issues);}
+
+    std::string   format() const {
+      std::string text;
+      for (auto& issue: m_issues)
+        text += issue.path + ": " + issue.message + "\n";
+      return (text);
+    }
+
+  private:
+    std::vector<LoadIssue>  m_issues;
+};
+
+inline std::string  fieldPath(const std::string& path, std::string_view key) {
+  return (path.empty() ? std::string(key) : path + "." + std::string(key));
+}
+
+inline std::string  indexPath(const std::string& path, std::string_view key, size_t index) {
+  return (fieldPath(path, key) + "[" + std::to_string(index) + "]");
+}
+
+//Typed field readers. A missing (when required) or mistyped field is
+//reported at path.key and false is returned, out is left untouched.
+inline const json::value*   readField(const json::object& obj, std::string_view key, const std::string& path
+    , LoadReport& report, bool required) {
+  const json::value*  value = obj.if_contains(key);
+  if (value == nullptr && required)
+    report.error(fieldPath(path, key), "missing");
+  return (value);
+}
+
+inline bool   readString(const json::object& obj, std::string_view key, std::string& out, const std::string& path
+    , LoadReport& report, bool required = true) {
+  const json::value*  value = readField(obj, key, path, report, required);
+  if (value == nullptr)
+    return (false);
+  if (!value->is_string()) {
+    report.error(fieldPath(path, key), "expected a string");
+    return (false);
+  }
+  out = value->as_string().c_str();
+  return (true);
+}
+
+inline bool   readNumber(const json::object& obj, std::string_view key, double& out, const std::string& path
+    , LoadReport& report, bool required = true) {
+  const json::value*  value = readField(obj, key, path, report, required);
+  if (value == nullptr)
+    return (false);
+  if (!value->is_number()) {
+    report.error(fieldPath(path, key), "expected a number");
+    return (false);
+  }
+  out = jsonNumber(*value);
+  return (true);
+}
+
+inline bool   readInteger(const json::object& obj, std::string_view key, int64_t& out, const std::string& path
+    , LoadReport& report, bool required = true) {
+  const json::value*  value = readField(obj, key, path, report, required);
+  if (value == nullptr)
+    return (false);
+  if (value->is_int64())
+    out = value->as_int64();
+  else if (value->is_uint64() && value->as_uint64() <= INT64_MAX)
+    out = value->as_uint64();
+  else {
+    report.error(fieldPath(path, key), "expected an integer");
+    return (false);
+  }
+  return (true);
+}
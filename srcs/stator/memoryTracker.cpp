@@ -0,0 +1,326 @@
+#include "memoryTracker.hpp"
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <imgui.h>
+#include <map>
+#include <mutex>
+#include <new>
+
+const char*   memorySubsystemName(MemorySubsystem subsystem) {
+  switch (subsystem) {
+    case MS_CATALOG:
+      return ("catalog");
+    case MS_GRAPH:
+      return ("graph");
+    case MS_EVALUATION:
+      return ("evaluation");
+    case MS_SERIALIZATION:
+      return ("serialization");
+    case MS_UI:
+      return ("ui");
+    default:
+      return ("other");
+  }
+}
+
+//Zero initialized before anything runs, operator new may be called from
+//other static constructors
+static std::atomic<int64_t>   s_liveBytes[MS_COUNT];
+static std::atomic<int64_t>   s_liveCount[MS_COUNT];
+static std::atomic<int64_t>   s_peakBytes[MS_COUNT];
+static std::atomic<int64_t>   s_totalBytes[MS_COUNT];
+static std::atomic<int64_t>   s_totalCount[MS_COUNT];
+static std::atomic<int64_t>   s_live;
+static std::atomic<int64_t>   s_peak;
+#ifdef STATOR_MEMORY_TRACKING
+static std::atomic<int64_t>   s_mark;   //Highest s_live since the innermost watermark started
+static thread_local MemorySubsystem s_current = MS_OTHER;
+
+static void   raise(std::atomic<int64_t>& peak, int64_t value) {
+  int64_t current = peak.load(std::memory_order_relaxed);
+  while (current < value && !peak.compare_exchange_weak(current, value, std::memory_order_relaxed))
+    ;
+}
+#endif
+
+static std::mutex&  watermarkMutex() {
+  static std::mutex mutex;
+  return (mutex);
+}
+
+static std::map<std::string, MemoryTracker::Watermark>&  watermarkEntries() {
+  static std::map<std::string, MemoryTracker::Watermark> entries;
+  return (entries);
+}
+
+MemoryTracker::Counters   MemoryTracker::counters(MemorySubsystem subsystem) {
+  Counters  counters;
+  counters.liveBytes = s_liveBytes[subsystem].load(std::memory_order_relaxed);
+  counters.liveCount = s_liveCount[subsystem].load(std::memory_order_relaxed);
+  counters.peakBytes = s_peakBytes[subsystem].load(std::memory_order_relaxed);
+  counters.totalBytes = s_totalBytes[subsystem].load(std::memory_order_relaxed);
+  counters.totalCount = s_totalCount[subsystem].load(std::memory_order_relaxed);
+  return (counters);
+}
+
+MemoryTracker::Counters   MemoryTracker::total() {
+  Counters  total;
+  for (int i = 0; i < MS_COUNT; i++) {
+    Counters  counters = MemoryTracker::counters((MemorySubsystem)i);
+    total.liveBytes += counters.liveBytes;
+    total.liveCount += counters.liveCount;
+    total.totalBytes += counters.totalBytes;
+    total.totalCount += counters.totalCount;
+  }
+  total.peakBytes = s_peak.load(std::memory_order_relaxed);
+  return (total);
+}
+
+std::vector<MemoryTracker::Watermark>   MemoryTracker::watermarks() {
+  std::lock_guard<std::mutex>   lock(watermarkMutex());
+  std::vector<Watermark>        result;
+  for (auto& entry: watermarkEntries())
+    result.push_back(entry.second);
+  return (result);
+}
+
+void  MemoryTracker::resetPeaks() {
+  for (int i = 0; i < MS_COUNT; i++)
+    s_peakBytes[i] = s_liveBytes[i].load(std::memory_order_relaxed);
+  s_peak = s_live.load(std::memory_order_relaxed);
+  std::lock_guard<std::mutex> lock(watermarkMutex());
+  for (auto& entry: watermarkEntries())
+    entry.second.peak = 0;
+}
+
+static json::object   countersJson(const MemoryTracker::Counters& counters) {
+  return (json::object{
+    {"liveBytes", counters.liveBytes},
+    {"liveCount", counters.liveCount},
+    {"peakBytes", counters.peakBytes},
+    {"totalBytes", counters.totalBytes},
+    {"totalCount", counters.totalCount},
+  });
+}
+
+json::object  MemoryTracker::toJson() {
+  json::object  subsystems;
+  json::array   marks;
+
+  for (int i = 0; i < MS_COUNT; i++)
+    subsystems[memorySubsystemName((MemorySubsystem)i)] = countersJson(counters((MemorySubsystem)i));
+  for (auto& mark: watermarks()) {
+    marks.push_back(json::object{
+      {"name", mark.name},
+      {"peak", mark.peak},
+      {"lastPeak", mark.lastPeak},
+      {"retained", mark.retained},
+      {"runs", mark.runs},
+    });
+  }
+  return (json::object{
+    {"enabled", enabled()},
+    {"subsystems", subsystems},
+    {"total", countersJson(total())},
+    {"watermarks", marks},
+  });
+}
+
+bool  MemoryTracker::writeJson(const std::string& path) {
+  std::ofstream file(path);
+  if (!file)
+    return (false);
+  file << json::serialize(toJson()) << '\n';
+  return (bool(file));
+}
+
+static void   drawBytes(int64_t bytes) {
+  if (bytes >= (int64_t)1 << 20 || bytes <= -((int64_t)1 << 20))
+    ImGui::Text("%.2f MiB", bytes / (1024.0 * 1024.0));
+  else
+    ImGui::Text("%.1f KiB", bytes / 1024.0);
+}
+
+void  MemoryTracker::draw() {
+  if (!enabled()) {
+    ImGui::TextUnformatted("Built without STATOR_MEMORY_TRACKING");
+    return ;
+  }
+  if (ImGui::Button("Reset peaks"))
+    resetPeaks();
+  if (ImGui::BeginTable("memory", 5, ImGuiTableFlags_Borders)) {
+    ImGui::TableSetupColumn("Subsystem");
+    ImGui::TableSetupColumn("Live");
+    ImGui::TableSetupColumn("Blocks");
+    ImGui::TableSetupColumn("Peak");
+    ImGui::TableSetupColumn("Allocations");
+    ImGui::TableHeadersRow();
+    for (int i = 0; i <= MS_COUNT; i++) {
+      Counters  counters = i < MS_COUNT ? MemoryTracker::counters((MemorySubsystem)i) : total();
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(i < MS_COUNT ? memorySubsystemName((MemorySubsystem)i) : "total");
+      ImGui::TableNextColumn();
+      drawBytes(counters.liveBytes);
+      ImGui::TableNextColumn();
+      ImGui::Text("%lld", (long long)counters.liveCount);
+      ImGui::TableNextColumn();
+      drawBytes(counters.peakBytes);
+      ImGui::TableNextColumn();
+      ImGui::Text("%lld", (long long)counters.totalCount);
+    }
+    ImGui::EndTable();
+  }
+  std::vector<Watermark>  marks = watermarks();
+  if (!marks.empty() && ImGui::BeginTable("watermarks", 5, ImGuiTableFlags_Borders)) {
+    ImGui::TableSetupColumn("Scope");
+    ImGui::TableSetupColumn("Peak");
+    ImGui::TableSetupColumn("Last peak");
+    ImGui::TableSetupColumn("Retained");
+    ImGui::TableSetupColumn("Runs");
+    ImGui::TableHeadersRow();
+    for (auto& mark: marks) {
+      ImGui::TableNextRow();
+      ImGui::TableNextColumn();
+      ImGui::TextUnformatted(mark.name.c_str());
+      ImGui::TableNextColumn();
+      drawBytes(mark.peak);
+      ImGui::TableNextColumn();
+      drawBytes(mark.lastPeak);
+      ImGui::TableNextColumn();
+      drawBytes(mark.retained);
+      ImGui::TableNextColumn();
+      ImGui::Text("%lld", (long long)mark.runs);
+    }
+    ImGui::EndTable();
+  }
+}
+
+#ifdef STATOR_MEMORY_TRACKING
+
+//Right in front of every block, offset back to what malloc returned
+struct  alignas(16) BlockHeader {
+  int64_t   size;
+  uint32_t  offset;
+  uint32_t  subsystem;
+};
+
+static void*  allocateBlock(size_t size, size_t alignment, MemorySubsystem subsystem) {
+  size_t  offset = std::max(alignment, sizeof(BlockHeader));
+  void*   raw;
+
+  if (alignment > alignof(std::max_align_t))
+    raw = std::aligned_alloc(alignment, (size + offset + alignment - 1) / alignment * alignment);
+  else
+    raw = std::malloc(size + offset);
+  if (raw == nullptr)
+    return (nullptr);
+  char*         block = (char*)raw + offset;
+  BlockHeader*  header = (BlockHeader*)block - 1;
+  header->size = size;
+  header->offset = offset;
+  header->subsystem = subsystem;
+  raise(s_peakBytes[subsystem], s_liveBytes[subsystem].fetch_add(size, std::memory_order_relaxed) + size);
+  s_liveCount[subsystem].fetch_add(1, std::memory_order_relaxed);
+  s_totalBytes[subsystem].fetch_add(size, std::memory_order_relaxed);
+  s_totalCount[subsystem].fetch_add(1, std::memory_order_relaxed);
+  int64_t live = s_live.fetch_add(size, std::memory_order_relaxed) + size;
+  raise(s_peak, live);
+  raise(s_mark, live);
+  return (block);
+}
+
+static void   releaseBlock(void* block) {
+  if (block == nullptr)
+    return ;
+  BlockHeader*  header = (BlockHeader*)block - 1;
+  s_liveBytes[header->subsystem].fetch_sub(header->size, std::memory_order_relaxed);
+  s_liveCount[header->subsystem].fetch_sub(1, std::memory_order_relaxed);
+  s_live.fetch_sub(header->size, std::memory_order_relaxed);
+  std::free((char*)block - header->offset);
+}
+
+//Throwing forms retry through the new handler like the standard ones
+static void*  allocateOrThrow(size_t size, size_t alignment) {
+  while (true) {
+    void* block = allocateBlock(size, alignment, s_current);
+    if (block != nullptr)
+      return (block);
+    std::new_handler  handler = std::get_new_handler();
+    if (handler == nullptr)
+      throw std::bad_alloc();
+    handler();
+  }
+}
+
+void*   MemoryTracker::allocate(size_t size, MemorySubsystem subsystem) {
+  return (allocateBlock(size, alignof(std::max_align_t), subsystem));
+}
+
+void    MemoryTracker::release(void* block) {
+  releaseBlock(block);
+}
+
+MemoryScope::MemoryScope(MemorySubsystem subsystem): m_previous(s_current) {
+  s_current = subsystem;
+}
+
+MemoryScope::~MemoryScope() {
+  s_current = m_previous;
+}
+
+MemoryWatermark::MemoryWatermark(const char* name): m_name(name) {
+  m_start = s_live.load(std::memory_order_relaxed);
+  m_outer = s_mark.exchange(m_start, std::memory_order_relaxed);
+}
+
+MemoryWatermark::~MemoryWatermark() {
+  int64_t peak = s_mark.load(std::memory_order_relaxed);
+  int64_t end = s_live.load(std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(watermarkMutex());
+    MemoryTracker::Watermark&   mark = watermarkEntries()[m_name];
+    mark.name = m_name;
+    mark.lastPeak = peak - m_start;
+    mark.peak = std::max(mark.peak, mark.lastPeak);
+    mark.retained = end - m_start;
+    mark.runs++;
+  }
+  raise(s_mark, std::max(m_outer, peak));
+}
+
+void*   operator new(size_t size) {return (allocateOrThrow(size, alignof(std::max_align_t)));}
+void*   operator new[](size_t size) {return (allocateOrThrow(size, alignof(std::max_align_t)));}
+void*   operator new(size_t size, std::align_val_t alignment) {return (allocateOrThrow(size, (size_t)alignment));}
+void*   operator new[](size_t size, std::align_val_t alignment) {return (allocateOrThrow(size, (size_t)alignment));}
+void*   operator new(size_t size, const std::nothrow_t&) noexcept {return (allocateBlock(size, alignof(std::max_align_t), s_current));}
+void*   operator new[](size_t size, const std::nothrow_t&) noexcept {return (allocateBlock(size, alignof(std::max_align_t), s_current));}
+void*   operator new(size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {return (allocateBlock(size, (size_t)alignment, s_current));}
+void*   operator new[](size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {return (allocateBlock(size, (size_t)alignment, s_current));}
+
+void    operator delete(void* block) noexcept {releaseBlock(block);}
+void    operator delete[](void* block) noexcept {releaseBlock(block);}
+void    operator delete(void* block, size_t) noexcept {releaseBlock(block);}
+void    operator delete[](void* block, size_t) noexcept {releaseBlock(block);}
+void    operator delete(void* block, std::align_val_t) noexcept {releaseBlock(block);}
+void    operator delete[](void* block, std::align_val_t) noexcept {releaseBlock(block);}
+void    operator delete(void* block, size_t, std::align_val_t) noexcept {releaseBlock(block);}
+void    operator delete[](void* block, size_t, std::align_val_t) noexcept {releaseBlock(block);}
+void    operator delete(void* block, const std::nothrow_t&) noexcept {releaseBlock(block);}
+void    operator delete[](void* block, const std::nothrow_t&) noexcept {releaseBlock(block);}
+void    operator delete(void* block, std::align_val_t, const std::nothrow_t&) noexcept {releaseBlock(block);}
+void    operator delete[](void* block, std::align_val_t, const std::nothrow_t&) noexcept {releaseBlock(block);}
+
+#else
+
+void*   MemoryTracker::allocate(size_t size, MemorySubsystem) {
+  return (std::malloc(size));
+}
+
+void    MemoryTracker::release(void* block) {
+  std::free(block);
+}
+
+#endif
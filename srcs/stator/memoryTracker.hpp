@@ -0,0 +1,107 @@
+#pragma once
+
+#include "stator/stator.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+//Live heap bytes and allocation counts per subsystem, built in with
+//-DSTATOR_MEMORY_TRACKING=ON. Global operator new/delete then put a small
+//header in front of every block naming the subsystem of the innermost
+//MemoryScope of the allocating thread, so a block is credited back to the
+//same subsystem wherever it is freed. Sizes are the requested ones, the
+//allocator's own overhead is left out. Without the option the scopes are
+//empty and nothing is replaced.
+enum  MemorySubsystem {
+  MS_OTHER,
+  MS_CATALOG,
+  MS_GRAPH,
+  MS_EVALUATION,
+  MS_SERIALIZATION,
+  MS_UI,
+  MS_COUNT,
+};
+
+const char*   memorySubsystemName(MemorySubsystem subsystem);
+
+class MemoryTracker {
+  public:
+    struct  Counters {
+      int64_t   liveBytes = 0;
+      int64_t   liveCount = 0;
+      int64_t   peakBytes = 0;    //Highest liveBytes since the last resetPeaks
+      int64_t   totalBytes = 0;   //Ever allocated
+      int64_t   totalCount = 0;
+    };
+    //Heap growth over a named MemoryWatermark scope, across all its runs
+    struct  Watermark {
+      std::string name;
+      int64_t     peak = 0;       //Highest live total above the start of a run
+      int64_t     lastPeak = 0;
+      int64_t     retained = 0;   //Live total at the end of the last run minus at its start
+      int64_t     runs = 0;
+    };
+
+    static constexpr bool   enabled() {
+#ifdef STATOR_MEMORY_TRACKING
+      return (true);
+#else
+      return (false);
+#endif
+    }
+    static Counters                 counters(MemorySubsystem subsystem);
+    static Counters                 total();
+    static std::vector<Watermark>   watermarks();
+    static void                     resetPeaks();
+
+    //{"enabled", "subsystems": {name: counters}, "total", "watermarks": [...]}
+    static json::object   toJson();
+    static bool           writeJson(const std::string& path);
+    static void           draw();
+
+    //For libraries taking allocation hooks, like ImGui
+    static void*          allocate(size_t size, MemorySubsystem subsystem);
+    static void           release(void* block);
+};
+
+#ifdef STATOR_MEMORY_TRACKING
+class MemoryScope {
+  public:
+    explicit MemoryScope(MemorySubsystem subsystem);
+    ~MemoryScope();
+
+    MemoryScope(const MemoryScope&) = delete;
+    MemoryScope&  operator=(const MemoryScope&) = delete;
+
+  private:
+    MemorySubsystem m_previous;
+};
+
+//Tracks the highest live total reached until it goes out of scope. Scopes may
+//nest, a peak inside counts for the ones around it. The mark is process wide,
+//other threads allocating meanwhile show up in it.
+class MemoryWatermark {
+  public:
+    explicit MemoryWatermark(const char* name);
+    ~MemoryWatermark();
+
+    MemoryWatermark(const MemoryWatermark&) = delete;
+    MemoryWatermark&  operator=(const MemoryWatermark&) = delete;
+
+  private:
+    const char* m_name;
+    int64_t     m_start;
+    int64_t     m_outer;
+};
+#else
+class MemoryScope {
+  public:
+    explicit MemoryScope(MemorySubsystem) {}
+};
+
+class MemoryWatermark {
+  public:
+    explicit MemoryWatermark(const char*) {}
+};
+#endif
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "flowGraph.hpp"
+#include <algorithm>
+#include <vector>
+
+//Factory wide power balance kept in sync with a FlowGraph.
+//update() only adjusts the totals for the nodes the last FlowGraph::update() touched,
+//recount() sums them again from every node so the rounding of those
+//adjustments doesn't pile up.
+class PowerBalance {
+  public:
+    void  reset(const FlowGraph& flow) {
+      m_contribution.assign(flow.nodes().size(), 0.0);
+      m_starved.assign(flow.nodes().size(), 0);
+      m_generation = 0.0;
+      m_consumption = 0.0;
+      m_starvedCount = 0;
+      for (int i = 0; i < flow.nodes().size(); i++)
+        updateNode(flow.nodes()[i], i);
+    }
+
+    void  update(const FlowGraph& flow, const std::vector<int>& touched) {
+      for (int index: touched)
+        updateNode(flow.nodes()[index], index);
+    }
+
+    //Same totals as reset() gives for the same contributions
+    void  recount() {
+      m_generation = 0.0;
+      m_consumption = 0.0;
+      for (double power: m_contribution) {
+        if (power > 0.0)
+          m_generation += power;
+        else
+          m_consumption -= power;
+      }
+    }
+
+    static double fuelRequired(const FlowNode& node) {
+      if (node.part == nullptr || node.part->energy <= 0.0)
+        return (0.0);
+      return (node.value * 60.0 / node.part->energy);
+    }
+
+    static double nodePower(const FlowNode& node) {
+      switch (node.type) {
+        case SNT_RECIPE_NODE:
+          return (-node.recipe->power * std::max(node.rate, 0.0));
+        case SNT_GENERATOR_NODE:
+          if (node.part == nullptr)
+            return (0.0);
+          return (std::min(node.value, std::max(node.rate, 0.0) * node.part->energy / 60.0));
+        case SNT_BLUEPRINT_NODE:
+          return (node.rate * node.unitPower);
+        default:
+          return (0.0);
+      }
+    }
+
+    double  generation() const {return (m_generation);}
+    double  consumption() const {return (m_consumption);}
+    double  net() const {return (m_generation - m_consumption);}
+    int     starvedCount() const {return (m_starvedCount);}
+    bool    isStarved(int node) const {return (m_starved[node] != 0);}
+
+    std::vector<int>  starvedGenerators() const {
+      std::vector<int>  starved;
+      for (int i = 0; i < m_starved.size(); i++) {
+        if (m_starved[i])
+          starved.push_back(i);
+      }
+      return (starved);
+    }
+
+  private:
+    void  updateNode(const FlowNode& node, int index) {
+      double  old = m_contribution[index];
+      double  power = nodePower(node);
+      if (old > 0.0)
+        m_generation -= old;
+      else
+        m_consumption += old;
+      if (power > 0.0)
+        m_generation += power;
+      else
+        m_consumption -= power;
+      m_contribution[index] = power;
+
+      char  starved = (node.type == SNT_GENERATOR_NODE && node.rate < fuelRequired(node));
+      m_starvedCount += starved - m_starved[index];
+      m_starved[index] = starved;
+    }
+
+    std::vector<double> m_contribution;
+    std::vector<char>   m_starved;
+    double              m_generation = 0.0;
+    double              m_consumption = 0.0;
+    int                 m_starvedCount = 0;
+};
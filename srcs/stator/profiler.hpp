@@ -0,0 +1,68 @@
+#pragma once
+
+#include <chrono>
+#include <imgui.h>
+#include <map>
+#include <string>
+
+//Rolling frame timings of named sections, drawn in the Profiler window
+class Profiler {
+  public:
+    struct  Entry {
+      double  last = 0.0;
+      double  average = 0.0;
+      double  peak = 0.0;
+    };
+
+    static Profiler&  instance() {
+      static Profiler profiler;
+      return (profiler);
+    }
+
+    void  record(const char* name, double milliseconds) {
+      Entry&  entry = m_entries[name];
+      entry.last = milliseconds;
+      entry.average = entry.average == 0.0 ? milliseconds : entry.average * 0.95 + milliseconds * 0.05;
+      entry.peak = std::max(entry.peak, milliseconds);
+    }
+
+    void  draw() {
+      if (ImGui::Button("Reset peaks")) {
+        for (auto& entry: m_entries)
+          entry.second.peak = 0.0;
+      }
+      if (!ImGui::BeginTable("profiler", 4))
+        return ;
+      ImGui::TableSetupColumn("Section");
+      ImGui::TableSetupColumn("Last ms");
+      ImGui::TableSetupColumn("Avg ms");
+      ImGui::TableSetupColumn("Peak ms");
+      ImGui::TableHeadersRow();
+      for (auto& entry: m_entries) {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::Text("%s", entry.first.c_str());
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", entry.second.last);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", entry.second.average);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", entry.second.peak);
+      }
+      ImGui::EndTable();
+    }
+
+  private:
+    std::map<std::string, Entry>  m_entries;
+};
+
+struct  ScopedTimer {
+  ScopedTimer(const char* name): name(name), start(std::chrono::steady_clock::now()) {}
+  ~ScopedTimer() {
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    Profiler::instance().record(name, elapsed.count());
+  }
+
+  const char*                             name;
+  std::chrono::steady_clock::time_point   start;
+};
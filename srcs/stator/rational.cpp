@@ -0,0 +1,115 @@
+#include "rational.hpp"
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cmath>
+
+namespace mp = boost::multiprecision;
+
+struct  BigRational {
+  mp::cpp_rational  value;
+};
+
+static mp::cpp_int  wideToBig(__int128 value) {
+  bool                negative = value < 0;
+  unsigned __int128   magnitude = negative ? -(unsigned __int128)value : (unsigned __int128)value;
+  mp::cpp_int         big = (uint64_t)(magnitude >> 64);
+  big <<= 64;
+  big += (uint64_t)magnitude;
+  return (negative ? mp::cpp_int(-big) : big);
+}
+
+BigRational  Rational::toBig(const Rational& r) {
+  if (r.m_big)
+    return (*r.m_big);
+  return (BigRational{mp::cpp_rational(r.m_num, r.m_den)});
+}
+
+Rational  Rational::fromDouble(double value, double tolerance) {
+  if (!std::isfinite(value))
+    return (Rational());
+  bool    negative = value < 0.0;
+  double  x = std::fabs(value);
+  double  limit = tolerance * std::max(1.0, x);
+
+  //Continued fraction expansion, stop at the first convergent close enough
+  int64_t num0 = 0, den0 = 1;
+  int64_t num1 = 1, den1 = 0;
+  double  rest = x;
+  for (int i = 0; i < 64; i++) {
+    double  a = std::floor(rest);
+    if (a > 1e15)
+      break;
+    int64_t ai = (int64_t)a;
+    int64_t num2, den2;
+    if (__builtin_mul_overflow(ai, num1, &num2) || __builtin_add_overflow(num2, num0, &num2)
+        || __builtin_mul_overflow(ai, den1, &den2) || __builtin_add_overflow(den2, den0, &den2))
+      break;
+    num0 = num1; den0 = den1;
+    num1 = num2; den1 = den2;
+    if (std::fabs(x - (double)num1 / (double)den1) <= limit)
+      break;
+    double  frac = rest - a;
+    if (frac <= 0.0)
+      break;
+    rest = 1.0 / frac;
+  }
+  if (den1 == 0)
+    return (Rational());
+  return (Rational(negative ? -num1 : num1, den1));
+}
+
+Rational  Rational::fromWideBig(Wide num, Wide den) {
+  Rational  r;
+  r.m_big = std::make_shared<BigRational>(BigRational{mp::cpp_rational(wideToBig(num), wideToBig(den))});
+  return (r);
+}
+
+Rational  Rational::bigOp(char op, const Rational& left, const Rational& right) {
+  mp::cpp_rational  a = toBig(left).value;
+  mp::cpp_rational  b = toBig(right).value;
+  mp::cpp_rational  result;
+  switch (op) {
+    case '+': result = a + b; break;
+    case '-': result = a - b; break;
+    case '*': result = a * b; break;
+    case '/':
+      if (b == 0)
+        return (Rational());
+      result = a / b;
+      break;
+  }
+  //Come back to the fast path as soon as the result fits again
+  mp::cpp_int num = mp::numerator(result);
+  mp::cpp_int den = mp::denominator(result);
+  if (num >= INT64_MIN && num <= INT64_MAX && den <= INT64_MAX) {
+    Rational  small;
+    small.m_num = num.convert_to<int64_t>();
+    small.m_den = den.convert_to<int64_t>();
+    return (small);
+  }
+  Rational  r;
+  r.m_big = std::make_shared<BigRational>(BigRational{result});
+  return (r);
+}
+
+int   Rational::bigCompare(const Rational& left, const Rational& right) {
+  mp::cpp_rational  a = toBig(left).value;
+  mp::cpp_rational  b = toBig(right).value;
+  return ((a > b) - (a < b));
+}
+
+double  Rational::toDouble() const {
+  if (m_big)
+    return (m_big->value.convert_to<double>());
+  return ((double)m_num / (double)m_den);
+}
+
+std::string Rational::toString() const {
+  if (m_big) {
+    if (mp::denominator(m_big->value) == 1)
+      return (mp::numerator(m_big->value).str());
+    return (m_big->value.str());
+  }
+  if (m_den == 1)
+    return (std::to_string(m_num));
+  return (std::to_string(m_num) + "/" + std::to_string(m_den));
+}
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <string>
+
+struct  BigRational;
+
+//Exact fraction, numerator and denominator are kept in int64 and only
+//promoted to an arbitrary precision BigRational when a result doesn't fit.
+//A division by zero gives 0, like an unconnected pin.
+class Rational {
+  public:
+    Rational(): m_num(0), m_den(1) {};
+    Rational(int64_t num, int64_t den = 1) {
+      *this = fromWide(num, den);
+    }
+
+    //Closest fraction of a double within tolerance (relative to the value)
+    static Rational fromDouble(double value, double tolerance = 1e-9);
+
+    Rational  operator+(const Rational& other) const {
+      if (m_big || other.m_big)
+        return (bigOp('+', *this, other));
+      if (m_den == other.m_den)
+        return (fromWide((Wide)m_num + other.m_num, m_den));
+      return (fromWide((Wide)m_num * other.m_den + (Wide)other.m_num * m_den, (Wide)m_den * other.m_den));
+    }
+    Rational  operator-(const Rational& other) const {
+      return (*this + (-other));
+    }
+    Rational  operator*(const Rational& other) const {
+      if (m_big || other.m_big)
+        return (bigOp('*', *this, other));
+      return (fromWide((Wide)m_num * other.m_num, (Wide)m_den * other.m_den));
+    }
+    Rational  operator/(const Rational& other) const {
+      if (m_big || other.m_big)
+        return (bigOp('/', *this, other));
+      if (other.m_num == 0)
+        return (Rational());
+      return (fromWide((Wide)m_num * other.m_den, (Wide)m_den * other.m_num));
+    }
+    Rational  operator-() const {
+      if (m_big)
+        return (bigOp('-', Rational(), *this));
+      return (fromWide(-(Wide)m_num, m_den));
+    }
+    Rational& operator+=(const Rational& other) {return (*this = *this + other);}
+
+    bool      operator<(const Rational& other) const {return (compare(other) < 0);}
+    bool      operator>(const Rational& other) const {return (compare(other) > 0);}
+    bool      operator<=(const Rational& other) const {return (compare(other) <= 0);}
+    bool      operator>=(const Rational& other) const {return (compare(other) >= 0);}
+    bool      operator==(const Rational& other) const {return (compare(other) == 0);}
+    bool      operator!=(const Rational& other) const {return (compare(other) != 0);}
+
+    int       compare(const Rational& other) const {
+      if (m_big || other.m_big)
+        return (bigCompare(*this, other));
+      Wide  left = (Wide)m_num * other.m_den;
+      Wide  right = (Wide)other.m_num * m_den;
+      return ((left > right) - (left < right));
+    }
+
+    double      toDouble() const;
+    std::string toString() const;
+    bool        isBig() const {return (m_big != nullptr);}
+
+  private:
+    using Wide = __int128;
+
+    static Rational fromWide(Wide num, Wide den) {
+      if (den == 0)
+        return (Rational());
+      if (den < 0) {
+        num = -num;
+        den = -den;
+      }
+      Wide  divisor = gcd(num < 0 ? -num : num, den);
+      if (divisor > 1) {
+        num /= divisor;
+        den /= divisor;
+      }
+      Rational  r;
+      if (num >= INT64_MIN && num <= INT64_MAX && den <= INT64_MAX) {
+        r.m_num = (int64_t)num;
+        r.m_den = (int64_t)den;
+      }
+      else
+        r = fromWideBig(num, den);
+      return (r);
+    }
+    static Wide     gcd(Wide a, Wide b) {
+      while (b != 0) {
+        Wide t = a % b;
+        a = b;
+        b = t;
+      }
+      return (a);
+    }
+
+    static BigRational  toBig(const Rational& r);
+    static Rational fromWideBig(Wide num, Wide den);
+    static Rational bigOp(char op, const Rational& left, const Rational& right);
+    static int      bigCompare(const Rational& left, const Rational& right);
+
+    int64_t                             m_num;
+    int64_t                             m_den;
+    std::shared_ptr<const BigRational>  m_big;
+};
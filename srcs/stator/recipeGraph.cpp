@@ -0,0 +1,331 @@
+#include "recipeGraph.hpp"
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+void  RecipeGraph::build(const Catalog& catalog) {
+  auto& parts = catalog.parts();
+  auto& recipes = catalog.recipes();
+  m_inputs.assign(recipes.size(), {});
+  m_outputs.assign(recipes.size(), {});
+  m_producers.assign(parts.size(), {});
+  m_consumers.assign(parts.size(), {});
+  for (int i = 0; i < recipes.size(); i++)
+    linkRecipe(i, recipes[i]);
+  m_depthsValid = false;
+  m_costValid.assign(parts.size(), 0);
+  m_costs.assign(parts.size(), {});
+}
+
+void  RecipeGraph::updateRecipes(const Catalog& catalog, const std::vector<int>& changed) {
+  auto& recipes = catalog.recipes();
+  if (catalog.parts().size() != m_producers.size()) {
+    build(catalog);
+    return ;
+  }
+  std::vector<int>  touchedParts;
+  auto  touch = [&](int recipe) {
+    for (auto& edge: m_outputs[recipe])
+      touchedParts.push_back(edge.node);
+  };
+  for (int recipe: changed) {
+    if (recipe < m_inputs.size()) {
+      touch(recipe);
+      unlinkRecipe(recipe);
+    }
+  }
+  size_t  oldSize = m_inputs.size();
+  for (int recipe = recipes.size(); recipe < oldSize; recipe++) {
+    touch(recipe);
+    unlinkRecipe(recipe);
+  }
+  m_inputs.resize(recipes.size());
+  m_outputs.resize(recipes.size());
+  for (int recipe: changed) {
+    if (recipe < recipes.size()) {
+      linkRecipe(recipe, recipes[recipe]);
+      touch(recipe);
+    }
+  }
+  std::vector<int>  affected = invalidateFrom(touchedParts);
+  if (m_depthsValid)
+    updateDepths(affected, changed);
+}
+
+void  RecipeGraph::linkRecipe(int recipe, const Recipe& data) {
+  if (data.removed)
+    return ;
+  for (int pin = 0; pin < data.inputs.size(); pin++) {
+    auto& in = data.inputs[pin];
+    if (in.part < 0)
+      continue ;
+    m_inputs[recipe].push_back({in.part, in.quantity, pin});
+    m_consumers[in.part].push_back({recipe, in.quantity, pin});
+  }
+  for (int pin = 0; pin < data.outputs.size(); pin++) {
+    auto& out = data.outputs[pin];
+    if (out.part < 0)
+      continue ;
+    m_outputs[recipe].push_back({out.part, out.quantity, pin});
+    m_producers[out.part].push_back({recipe, out.quantity, pin});
+  }
+}
+
+void  RecipeGraph::unlinkRecipe(int recipe) {
+  auto  removeRecipe = [recipe](std::vector<Edge>& edges) {
+    edges.erase(std::remove_if(edges.begin(), edges.end(), [recipe](Edge& edge) {
+      return (edge.node == recipe);
+    }), edges.end());
+  };
+  for (auto& edge: m_inputs[recipe])
+    removeRecipe(m_consumers[edge.node]);
+  for (auto& edge: m_outputs[recipe])
+    removeRecipe(m_producers[edge.node]);
+  m_inputs[recipe].clear();
+  m_outputs[recipe].clear();
+}
+
+
+RecipeGraph::Reachability  RecipeGraph::reachableFrom(const std::vector<int>& available) const {
+  Reachability      result;
+  std::vector<int>  missing(m_inputs.size());
+  std::vector<int>  queue;
+
+  result.parts.assign(m_producers.size(), 0);
+  result.recipes.assign(m_inputs.size(), 0);
+  auto  fire = [&](int recipe) {
+    result.recipes[recipe] = 1;
+    for (auto& out: m_outputs[recipe]) {
+      if (!result.parts[out.node]) {
+        result.parts[out.node] = 1;
+        queue.push_back(out.node);
+      }
+    }
+  };
+  for (int part: available) {
+    if (!result.parts[part]) {
+      result.parts[part] = 1;
+      queue.push_back(part);
+    }
+  }
+  for (int recipe = 0; recipe < m_inputs.size(); recipe++) {
+    missing[recipe] = m_inputs[recipe].size();
+    if (missing[recipe] == 0 && !m_outputs[recipe].empty())
+      fire(recipe);
+  }
+  for (int i = 0; i < queue.size(); i++) {
+    for (auto& consumer: m_consumers[queue[i]]) {
+      if (--missing[consumer.node] == 0)
+        fire(consumer.node);
+    }
+  }
+  return (result);
+}
+
+RecipeGraph::Reachability  RecipeGraph::requiredFor(int part) const {
+  Reachability      result;
+  std::vector<int>  queue = {part};
+
+  result.parts.assign(m_producers.size(), 0);
+  result.recipes.assign(m_inputs.size(), 0);
+  result.parts[part] = 1;
+  for (int i = 0; i < queue.size(); i++) {
+    for (auto& producer: m_producers[queue[i]]) {
+      if (result.recipes[producer.node])
+        continue ;
+      result.recipes[producer.node] = 1;
+      for (auto& in: m_inputs[producer.node]) {
+        if (!result.parts[in.node]) {
+          result.parts[in.node] = 1;
+          queue.push_back(in.node);
+        }
+      }
+    }
+  }
+  return (result);
+}
+
+//Knuth's generalisation of Dijkstra: a recipe is settled once all its inputs
+//are, parts come out of the queue in depth order so the last input settled
+//holds the deepest chain
+void  RecipeGraph::computeDepths() {
+  using Item = std::pair<int, int>;
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>>  queue;
+  std::vector<int>  missing(m_inputs.size());
+
+  m_depths.assign(m_producers.size(), unreachable);
+  m_recipeDepths.assign(m_inputs.size(), unreachable);
+  auto  settleRecipe = [&](int recipe, int depth) {
+    m_recipeDepths[recipe] = depth;
+    for (auto& out: m_outputs[recipe]) {
+      if (m_depths[out.node] == unreachable)
+        queue.push({depth, out.node});
+    }
+  };
+  for (int part = 0; part < m_producers.size(); part++) {
+    if (isRaw(part))
+      queue.push({0, part});
+  }
+  for (int recipe = 0; recipe < m_inputs.size(); recipe++) {
+    missing[recipe] = m_inputs[recipe].size();
+    if (missing[recipe] == 0)
+      settleRecipe(recipe, 1);
+  }
+  while (!queue.empty()) {
+    auto [depth, part] = queue.top();
+    queue.pop();
+    if (m_depths[part] != unreachable)
+      continue ;
+    m_depths[part] = depth;
+    for (auto& consumer: m_consumers[part]) {
+      if (--missing[consumer.node] == 0)
+        settleRecipe(consumer.node, depth + 1);
+    }
+  }
+  m_depthsValid = true;
+}
+
+//Depths only move downstream of the changed recipes: the affected parts, and
+//the recipes changed or consuming one of them, are settled again with the
+//same queue while everything else keeps its depth. A recipe's inputs that
+//keep theirs give the least depth it can have, one of them unreachable
+//counts as an input that never arrives.
+void  RecipeGraph::updateDepths(const std::vector<int>& parts, const std::vector<int>& changed) {
+  using Item = std::pair<int, int>;
+  std::priority_queue<Item, std::vector<Item>, std::greater<Item>>  queue;
+  std::vector<char> affected(m_producers.size(), 0);
+  std::vector<int>  missing(m_inputs.size(), -1);   //-1 for the recipes keeping their depth
+  std::vector<int>  floor(m_inputs.size(), 0);
+  std::vector<int>  reset;
+
+  m_recipeDepths.resize(m_inputs.size(), unreachable);
+  for (int part: parts) {
+    affected[part] = 1;
+    m_depths[part] = unreachable;
+  }
+  auto  resetRecipe = [&](int recipe) {
+    if (missing[recipe] >= 0)
+      return ;
+    m_recipeDepths[recipe] = unreachable;
+    missing[recipe] = 0;
+    for (auto& in: m_inputs[recipe]) {
+      if (affected[in.node] || m_depths[in.node] == unreachable)
+        missing[recipe]++;
+      else
+        floor[recipe] = std::max(floor[recipe], m_depths[in.node]);
+    }
+    reset.push_back(recipe);
+  };
+  auto  settleRecipe = [&](int recipe, int depth) {
+    m_recipeDepths[recipe] = depth;
+    for (auto& out: m_outputs[recipe]) {
+      if (m_depths[out.node] == unreachable)
+        queue.push({depth, out.node});
+    }
+  };
+  for (int recipe: changed) {
+    if (recipe < m_inputs.size())
+      resetRecipe(recipe);
+  }
+  for (int part: parts) {
+    for (auto& consumer: m_consumers[part])
+      resetRecipe(consumer.node);
+  }
+  for (int recipe: reset) {
+    if (missing[recipe] == 0)
+      settleRecipe(recipe, floor[recipe] + 1);
+  }
+  for (int part: parts) {
+    if (isRaw(part))
+      queue.push({0, part});
+    for (auto& producer: m_producers[part]) {
+      if (missing[producer.node] < 0 && m_recipeDepths[producer.node] != unreachable)
+        queue.push({m_recipeDepths[producer.node], part});
+    }
+  }
+  while (!queue.empty()) {
+    auto [depth, part] = queue.top();
+    queue.pop();
+    if (m_depths[part] != unreachable)
+      continue ;
+    m_depths[part] = depth;
+    for (auto& consumer: m_consumers[part]) {
+      if (missing[consumer.node] > 0 && --missing[consumer.node] == 0)
+        settleRecipe(consumer.node, std::max(depth, floor[consumer.node]) + 1);
+    }
+  }
+}
+
+int   RecipeGraph::depth(int part) {
+  if (!m_depthsValid)
+    computeDepths();
+  return (m_depths[part]);
+}
+
+int   RecipeGraph::defaultRecipe(int part) {
+  if (!m_depthsValid)
+    computeDepths();
+  int best = -1;
+  for (auto& producer: m_producers[part]) {
+    int recipeDepth = m_recipeDepths[producer.node];
+    if (recipeDepth == unreachable)
+      continue ;
+    if (best < 0 || recipeDepth < m_recipeDepths[best])
+      best = producer.node;
+  }
+  return (best);
+}
+
+const std::unordered_map<int, double>&  RecipeGraph::rawCost(int part) {
+  if (!m_depthsValid)
+    computeDepths();
+  if (m_costValid[part])
+    return (m_costs[part]);
+
+  std::unordered_map<int, double>&  cost = m_costs[part];
+  int                               recipe = defaultRecipe(part);
+  //Mark valid first so a cycle back to this part reads it as raw instead of recursing
+  cost.clear();
+  cost[part] = 1.0;
+  m_costValid[part] = 1;
+  if (recipe < 0)
+    return (cost);
+  double  produced = 0.0;
+  for (auto& out: m_outputs[recipe]) {
+    if (out.node == part)
+      produced += out.quantity;
+  }
+  std::unordered_map<int, double>  total;
+  for (auto& in: m_inputs[recipe]) {
+    for (auto& raw: rawCost(in.node))
+      total[raw.first] += raw.second * in.quantity / produced;
+  }
+  cost = total;
+  return (cost);
+}
+
+//Walks every consumer whether its cost is cached or not, a part never asked
+//for can still sit between the changed ones and cached costs further down.
+//Returns the parts reached, the given ones included.
+std::vector<int>  RecipeGraph::invalidateFrom(const std::vector<int>& parts) {
+  std::vector<char> seen(m_producers.size(), 0);
+  std::vector<int>  queue;
+  for (int part: parts) {
+    if (!seen[part]) {
+      seen[part] = 1;
+      queue.push_back(part);
+    }
+  }
+  for (int i = 0; i < queue.size(); i++) {
+    m_costValid[queue[i]] = 0;
+    for (auto& consumer: m_consumers[queue[i]]) {
+      for (auto& out: m_outputs[consumer.node]) {
+        if (!seen[out.node]) {
+          seen[out.node] = 1;
+          queue.push_back(out.node);
+        }
+      }
+    }
+  }
+  return (queue);
+}
@@ -0,0 +1,70 @@
+#pragma once
+
+#include "stator/stator.hpp"
+#include "catalog.hpp"
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+//Bipartite part <-> recipe graph built once from the catalog.
+//Parts and recipes are addressed by their index in the catalog arrays.
+class RecipeGraph {
+  public:
+    struct  Edge {
+      int     node;     //part index for recipe edges, recipe index for part edges
+      double  quantity;
+      int     pin;      //Slot in the recipe's inputs or outputs, the RecipeNode pin.
+                        //Unknown parts are skipped so it may differ from the edge's own index.
+    };
+
+    struct  Reachability {
+      std::vector<char> parts;
+      std::vector<char> recipes;
+    };
+
+    static constexpr int  unreachable = -1;
+
+    void                build(const Catalog& catalog);
+    //Rebuild only the edges of the given recipes (by index) after a catalog
+    //reload, the depths and costs of what they feed are recomputed, the
+    //others kept
+    void                updateRecipes(const Catalog& catalog, const std::vector<int>& changed);
+
+    bool                isRaw(int part) const {return (m_producers[part].empty());}
+
+    //Everything that can be built from the given parts alone
+    Reachability        reachableFrom(const std::vector<int>& available) const;
+    //Every part and recipe that may take part in producing the given part
+    Reachability        requiredFor(int part) const;
+    //Smallest number of recipes to chain from raw parts, unreachable if it can't be built
+    int                 depth(int part);
+    //Raw parts needed per unit of the part following its shallowest recipe
+    const std::unordered_map<int, double>&  rawCost(int part);
+    int                 defaultRecipe(int part);
+    bool                costCached(int part) const {return (m_costValid[part]);}
+
+    const std::vector<Edge>&  recipeInputs(int recipe) const {return (m_inputs[recipe]);}
+    const std::vector<Edge>&  recipeOutputs(int recipe) const {return (m_outputs[recipe]);}
+    const std::vector<Edge>&  producers(int part) const {return (m_producers[part]);}
+    const std::vector<Edge>&  consumers(int part) const {return (m_consumers[part]);}
+    size_t                    partCount() const {return (m_producers.size());}
+    size_t                    recipeCount() const {return (m_inputs.size());}
+
+  private:
+    void  linkRecipe(int recipe, const Recipe& data);
+    void  unlinkRecipe(int recipe);
+    void  computeDepths();
+    void  updateDepths(const std::vector<int>& parts, const std::vector<int>& changed);
+    std::vector<int>  invalidateFrom(const std::vector<int>& parts);
+
+    std::vector<std::vector<Edge>>        m_inputs;
+    std::vector<std::vector<Edge>>        m_outputs;
+    std::vector<std::vector<Edge>>        m_producers;
+    std::vector<std::vector<Edge>>        m_consumers;
+
+    bool                                          m_depthsValid = false;
+    std::vector<int>                              m_depths;
+    std::vector<int>                              m_recipeDepths;
+    std::vector<char>                             m_costValid;
+    std::vector<std::unordered_map<int, double>>  m_costs;
+};
@@ -0,0 +1,190 @@
+#include "searchIndex.hpp"
+#include <algorithm>
+#include <cctype>
+
+std::string   SearchIndex::lower(const std::string& text) {
+  std::string result = text;
+  std::transform(result.begin(), result.end(), result.begin(), ::tolower);
+  return (result);
+}
+
+//Text holds no NUL, so grams of 1, 2 and 3 characters never share a key
+uint32_t      SearchIndex::gram(const char* text, int length) {
+  uint32_t  key = 0;
+  for (int i = 0; i < length; i++)
+    key |= (uint32_t)(uint8_t)text[i] << (8 * i);
+  return (key);
+}
+
+void  SearchIndex::build(const Catalog& catalog) {
+  auto& parts = catalog.parts();
+  auto& recipes = catalog.recipes();
+  m_parts.clear();
+  m_recipes.clear();
+  m_entries.clear();
+  m_grams.clear();
+  m_producers.assign(parts.size(), {});
+  m_consumers.assign(parts.size(), {});
+
+  std::vector<int>  partEntry(parts.size(), -1);
+  for (auto& part: parts) {
+    if (part.removed)
+      continue ;
+    partEntry[&part - parts.data()] = m_parts.size();
+    m_entries.push_back({SEK_PART, (int)m_parts.size(), lower(part.name.str()), part.name.str()});
+    m_parts.push_back(&part);
+  }
+  for (auto& recipe: recipes) {
+    if (recipe.removed)
+      continue ;
+    int         entry = m_entries.size();
+    std::string label;
+    for (auto& in: recipe.inputs) {
+      label += (label.empty() ? "" : " + ") + in.name.str();
+      if (in.part >= 0 && partEntry[in.part] >= 0)
+        m_consumers[partEntry[in.part]].push_back(entry);
+    }
+    label += " -> ";
+    for (int i = 0; i < recipe.outputs.size(); i++) {
+      auto& out = recipe.outputs[i];
+      label += (i == 0 ? "" : " + ") + out.name.str();
+      if (out.part >= 0 && partEntry[out.part] >= 0)
+        m_producers[partEntry[out.part]].push_back(entry);
+    }
+    m_entries.push_back({SEK_RECIPE, (int)m_recipes.size(), lower(label), label});
+    m_recipes.push_back(&recipe);
+  }
+
+  for (int i = 0; i < m_entries.size(); i++) {
+    const std::string&  text = m_entries[i].text;
+    for (int c = 0; c < text.size(); c++) {
+      for (int length = 1; length <= 3 && c + length <= text.size(); length++) {
+        std::vector<int>& postings = m_grams[gram(&text[c], length)];
+        if (postings.empty() || postings.back() != i)
+          postings.push_back(i);
+      }
+    }
+  }
+  m_hits.assign(m_entries.size(), 0);
+}
+
+SearchResult  SearchIndex::result(int entry, int score) {
+  SearchResult  result;
+  result.kind = m_entries[entry].kind;
+  result.entry = entry;
+  result.score = score;
+  if (result.kind == SEK_PART)
+    result.part = m_parts[m_entries[entry].index];
+  else
+    result.recipe = m_recipes[m_entries[entry].index];
+  return (result);
+}
+
+const std::string&  SearchIndex::label(const SearchResult& result) const {
+  return (m_entries[result.entry].label);
+}
+
+void  SearchIndex::matchText(const std::string& text, std::vector<std::pair<int, int>>& scored, bool partsOnly) {
+  int   entryCount = partsOnly ? m_parts.size() : m_entries.size();
+
+  auto  substringScore = [&](int entry) {
+    size_t  pos = m_entries[entry].text.find(text);
+    if (pos == std::string::npos)
+      return (0);
+    return (2000 + (pos == 0 ? 1000 : 0) - (int)m_entries[entry].text.size());
+  };
+
+  //Too short for trigrams, the entries holding the whole query are listed
+  if (text.size() < 3) {
+    auto it = m_grams.find(gram(text.data(), text.size()));
+    if (it == m_grams.end())
+      return ;
+    for (int entry: it->second) {
+      if (entry >= entryCount)
+        break;
+      scored.push_back({entry, substringScore(entry)});
+    }
+    return ;
+  }
+
+  std::vector<uint32_t> grams;
+  for (int c = 0; c + 3 <= text.size(); c++)
+    grams.push_back(gram(&text[c], 3));
+  std::sort(grams.begin(), grams.end());
+  grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+
+  std::vector<int>  touched;
+  for (uint32_t key: grams) {
+    auto it = m_grams.find(key);
+    if (it == m_grams.end())
+      continue ;
+    for (int entry: it->second) {
+      if (entry >= entryCount)
+        break;
+      if (m_hits[entry]++ == 0)
+        touched.push_back(entry);
+    }
+  }
+  for (int entry: touched) {
+    int hits = m_hits[entry];
+    m_hits[entry] = 0;
+    int score = hits == grams.size() ? substringScore(entry) : 0;
+    if (score == 0 && hits * 2 >= (int)grams.size())
+      score = hits * 1000 / grams.size();
+    if (score > 0)
+      scored.push_back({entry, score});
+  }
+}
+
+std::vector<SearchResult> SearchIndex::query(const std::string& text, size_t maxResults) {
+  std::vector<std::pair<int, int>>  scored;
+  std::string                       query = lower(text);
+
+  while (!query.empty() && query.back() == ' ')
+    query.pop_back();
+  while (!query.empty() && query.front() == ' ')
+    query.erase(0, 1);
+  if (query.empty())
+    return (std::vector<SearchResult>());
+
+  std::vector<std::vector<int>>*  related = nullptr;
+  if (query.rfind("produces ", 0) == 0) {
+    related = &m_producers;
+    query.erase(0, 9);
+  }
+  else if (query.rfind("consumes ", 0) == 0) {
+    related = &m_consumers;
+    query.erase(0, 9);
+  }
+
+  if (related != nullptr) {
+    std::vector<std::pair<int, int>>  parts;
+    matchText(query, parts, true);
+    std::vector<char> seen(m_entries.size(), 0);
+    for (auto& part: parts) {
+      for (int entry: (*related)[part.first]) {
+        if (!seen[entry]) {
+          seen[entry] = 1;
+          scored.push_back({entry, part.second});
+        }
+      }
+    }
+  }
+  else
+    matchText(query, scored, false);
+
+  //Short queries match much of the catalog, only the listed part is sorted
+  auto  cut = scored.begin() + std::min(scored.size(), maxResults);
+  std::partial_sort(scored.begin(), cut, scored.end(), [this](auto& a, auto& b) {
+    if (a.second != b.second)
+      return (a.second > b.second);
+    return (m_entries[a.first].label < m_entries[b.first].label);
+  });
+  scored.erase(cut, scored.end());
+
+  std::vector<SearchResult> results;
+  results.reserve(scored.size());
+  for (auto& score: scored)
+    results.push_back(result(score.first, score.second));
+  return (results);
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include "stator/stator.hpp"
+#include "catalog.hpp"
+#include <cstdint>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+enum SearchEntryKind {
+  SEK_PART,
+  SEK_RECIPE,
+};
+
+struct  SearchResult {
+  SearchEntryKind kind;
+  const Part*     part = nullptr;
+  const Recipe*   recipe = nullptr;
+  int             entry = 0;
+  int             score = 0;
+};
+
+//Trigram index over part names and recipe inputs/outputs built once after
+//the catalog is loaded, with the single characters and pairs for queries
+//shorter than a trigram. Understands "produces X" and "consumes X" to list
+//the recipes with X in their outputs or inputs, anything else is matched
+//against part names and recipe descriptions, exact substrings first then
+//entries sharing enough trigrams with the query (typos).
+class SearchIndex {
+  public:
+    void                      build(const Catalog& catalog);
+    std::vector<SearchResult> query(const std::string& text, size_t maxResults = 200);
+
+    const std::string&        label(const SearchResult& result) const;
+
+  private:
+    struct  Entry {
+      SearchEntryKind kind;
+      int             index;
+      std::string     text;   //lowercase searchable text
+      std::string     label;
+    };
+
+    static std::string  lower(const std::string& text);
+    static uint32_t     gram(const char* text, int length);
+
+    void                matchText(const std::string& text, std::vector<std::pair<int, int>>& scored, bool partsOnly);
+    SearchResult        result(int entry, int score);
+
+    std::vector<const Part*>                        m_parts;
+    std::vector<const Recipe*>                      m_recipes;
+    std::vector<Entry>                              m_entries;
+    std::unordered_map<uint32_t, std::vector<int>>  m_grams;
+    std::vector<std::vector<int>>                   m_producers; //recipe entries per part entry
+    std::vector<std::vector<int>>                   m_consumers;
+    std::vector<uint16_t>                           m_hits;
+};
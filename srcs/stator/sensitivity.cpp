@@ -0,0 +1,360 @@
+#include "sensitivity.hpp"
+#include "memoryTracker.hpp"
+#include <algorithm>
+
+void  Sensitivity::compute(const FlowGraph& flow) {
+  MemoryScope                   memory(MS_EVALUATION);
+  const std::vector<FlowNode>&  nodes = flow.nodes();
+  const std::vector<int>&       order = flow.order();
+  int                           count = nodes.size();
+
+  m_outputs.clear();
+  m_params.clear();
+  m_outputLabels.clear();
+  m_paramLabels.clear();
+  m_paramFirst.assign(count, -1);
+  m_inFirst.assign(count + 1, 0);
+  m_outFirst.assign(count + 1, 0);
+  for (int i = 0; i < count; i++) {
+    const FlowNode& node = nodes[i];
+    m_inFirst[i + 1] = m_inFirst[i] + node.ins.size();
+    m_outFirst[i + 1] = m_outFirst[i] + node.outs.size();
+    if (node.type == SNT_OUT_NODE) {
+      m_outputs.push_back(i);
+      m_outputLabels.push_back(flowNodeLabel(node, i));
+    }
+    else if (node.type == SNT_IN_NODE) {
+      m_paramFirst[i] = m_params.size();
+      m_params.push_back({i, -1});
+      m_paramLabels.push_back(flowNodeLabel(node, i));
+    }
+    else if (node.type == SNT_PART_NODE && !node.ratios.empty()) {
+      m_paramFirst[i] = m_params.size();
+      for (int pin = 0; pin < node.ratios.size(); pin++) {
+        m_params.push_back({i, pin});
+        m_paramLabels.push_back(flowNodeLabel(node, i) + " ratio " + std::to_string(pin + 1));
+      }
+    }
+  }
+
+  m_terms.clear();
+  m_termFirst.assign(1, 0);
+  m_paramVars.resize(m_params.size());
+  for (int i = 0; i < m_params.size(); i++)
+    m_paramVars[i] = closeVariable(true);
+  m_offeredVars.assign(m_outFirst[count], -1);
+  m_outVars.assign(m_outFirst[count], -1);
+  m_demandVars.assign(count, -1);
+  m_limitVars.assign(count, -1);
+  m_rateVars.assign(count, -1);
+  m_branches.assign(count, NodeBranch());
+  m_capped.assign(m_inFirst[count], 0);
+  for (int index: order)
+    recordNode(flow, index, true);
+  for (auto it = order.rbegin(); it != order.rend(); it++)
+    recordLimit(flow, *it);
+  for (int index: order)
+    recordNode(flow, index, false);
+
+  m_entries.clear();
+  m_rowFirst.assign(1, 0);
+  m_values.assign(m_termFirst.size() - 1, 0.0);
+  m_active.assign(m_termFirst.size() - 1, 0);
+  for (int row = 0; row < m_outputs.size(); row++) {
+    propagate(row);
+    m_rowFirst.push_back(m_entries.size());
+  }
+  m_values.clear();
+  m_values.shrink_to_fit();
+  m_active.clear();
+  m_active.shrink_to_fit();
+}
+
+double  Sensitivity::at(int output, int param) const {
+  auto  first = m_entries.begin() + m_rowFirst[output];
+  auto  last = m_entries.begin() + m_rowFirst[output + 1];
+  auto  it = std::lower_bound(first, last, param, [](const Entry& entry, int param) {return (entry.param < param);});
+  return (it != last && it->param == param ? it->value : 0.0);
+}
+
+void  Sensitivity::addTerm(int source, double weight) {
+  if (source >= 0 && weight != 0.0)
+    m_terms.push_back({source, weight});
+}
+
+//Turns the terms added since the last variable into a new one
+int   Sensitivity::closeVariable(bool keepEmpty) {
+  if (!keepEmpty && m_terms.size() == m_termFirst.back())
+    return (-1);
+  m_termFirst.push_back(m_terms.size());
+  return (m_termFirst.size() - 2);
+}
+
+//What an out pin carries per unit of throughput
+double  Sensitivity::outFactor(const FlowNode& node, int pin) const {
+  switch (node.type) {
+    case SNT_IN_NODE:
+    case SNT_STORAGE_NODE:
+      return (1.0);
+    case SNT_PART_NODE:
+    case SNT_BLUEPRINT_NODE:
+      return (node.ratios[pin]);
+    case SNT_RECIPE_NODE:
+      return (node.recipe->outputs[pin].quantity);
+    default:
+      return (0.0);
+  }
+}
+
+//evalFlowNode on the offered flows without limit for the demand sweep, on
+//the evaluated flows under the node limit for the last one
+void  Sensitivity::recordNode(const FlowGraph& flow, int index, bool demand) {
+  const std::vector<FlowNode>&  nodes = flow.nodes();
+  const FlowNode&               node = nodes[index];
+  std::vector<int>&             slotVars = demand ? m_offeredVars : m_outVars;
+  double                        free = 0.0;
+  int                           freeVar = -1;
+  int                           input = -1;
+  auto                          in = [&](int pin, double& value) {
+    const FlowPinRef& ref = node.ins[pin];
+    value = 0.0;
+    if (ref.node < 0 || ref.pin >= nodes[ref.node].outs.size())
+      return (-1);
+    double  carried = demand ? nodes[ref.node].offered[ref.pin] : nodes[ref.node].outs[ref.pin];
+    if (node.caps[pin] < carried) {
+      value = node.caps[pin];
+      m_capped[m_inFirst[index] + pin] = 1;
+      return (-1);
+    }
+    value = carried;
+    return (slotVars[m_outFirst[ref.node] + ref.pin]);
+  };
+
+  switch (node.type) {
+    case SNT_IN_NODE:
+      free = node.value;
+      freeVar = m_paramVars[m_paramFirst[index]];
+      break;
+    case SNT_BLUEPRINT_NODE:
+      free = node.value;
+      break;
+    case SNT_OUT_NODE:
+    case SNT_GENERATOR_NODE:
+    case SNT_STORAGE_NODE:
+      freeVar = in(0, free);
+      break;
+    case SNT_PART_NODE:
+      {
+        std::vector<int>  vars(node.ins.size());
+        for (int pin = 0; pin < node.ins.size(); pin++) {
+          double  value;
+          vars[pin] = in(pin, value);
+          free += value;
+        }
+        for (int var: vars)
+          addTerm(var, 1.0);
+        freeVar = closeVariable();
+      }
+      break;
+    case SNT_RECIPE_NODE:
+      {
+        int   inputVar = -1;
+        for (int pin = 0; pin < node.recipe->inputs.size(); pin++) {
+          double  value;
+          int     var = in(pin, value);
+          double  ratio = value / node.recipe->inputs[pin].quantity;
+          if (pin == 0 || free > ratio) {
+            free = ratio;
+            input = pin;
+            inputVar = var;
+          }
+        }
+        if (input >= 0)
+          addTerm(inputVar, 1.0 / node.recipe->inputs[input].quantity);
+        freeVar = closeVariable();
+      }
+      break;
+    default:
+      return ;
+  }
+
+  double  throughput = free;
+  int     throughputVar = freeVar;
+  if (demand)
+    m_demandVars[index] = freeVar;
+  else {
+    NodeBranch& branch = m_branches[index];
+    bool        clamped = node.type != SNT_OUT_NODE && node.type != SNT_GENERATOR_NODE;
+    if (clamped && node.limit < free) {
+      throughput = node.limit;
+      throughputVar = m_limitVars[index];
+      branch.branch = SB_LIMITED;
+    }
+    else {
+      branch = NodeBranch();
+      if (input >= 0) {
+        branch.branch = SB_INPUT;
+        branch.pin = input;
+      }
+    }
+    m_rateVars[index] = throughputVar;
+  }
+  for (int pin = 0; pin < node.outs.size(); pin++) {
+    addTerm(throughputVar, outFactor(node, pin));
+    if (node.type == SNT_PART_NODE)
+      addTerm(m_paramVars[m_paramFirst[index] + pin], throughput);
+    slotVars[m_outFirst[index] + pin] = closeVariable();
+  }
+}
+
+//FlowGraph::accepted, variable gets what the result moves with
+double  Sensitivity::recordAccepted(const FlowGraph& flow, int target, int pin, int& variable) {
+  const std::vector<FlowNode>&  nodes = flow.nodes();
+  const FlowNode&               node = nodes[target];
+  const FlowPinRef&             ref = node.ins[pin];
+  double                        carried = nodes[ref.node].offered[ref.pin];
+  double                        inflow = std::min(carried, node.caps[pin]);
+  int                           inflowVar = node.caps[pin] < carried ? -1 : m_offeredVars[m_outFirst[ref.node] + ref.pin];
+  double                        demand = node.demand;
+  double                        limit = node.limit;
+
+  variable = inflowVar;
+  if (limit >= demand)
+    return (inflow);
+  switch (node.type) {
+    case SNT_RECIPE_NODE:
+      {
+        double  quantity = node.recipe->inputs[pin].quantity;
+        double  taken = inflow - (demand - limit) * quantity;
+        if (taken <= 0.0) {
+          variable = -1;
+          return (0.0);
+        }
+        addTerm(inflowVar, 1.0);
+        addTerm(m_demandVars[target], -quantity);
+        addTerm(m_limitVars[target], quantity);
+        variable = closeVariable();
+        return (taken);
+      }
+    case SNT_PART_NODE:
+    case SNT_STORAGE_NODE:
+      if (demand <= 0.0)
+        return (inflow);
+      addTerm(inflowVar, limit / demand);
+      addTerm(m_limitVars[target], inflow / demand);
+      addTerm(m_demandVars[target], -inflow * limit / (demand * demand));
+      variable = closeVariable();
+      return (inflow * limit / demand);
+    default:
+      return (inflow);
+  }
+}
+
+//FlowGraph::evalLimit, keeping the consumer pin that sets the limit
+void  Sensitivity::recordLimit(const FlowGraph& flow, int index) {
+  const std::vector<FlowNode>&  nodes = flow.nodes();
+  const FlowNode&               node = nodes[index];
+  double                        limit = linkTierCapacity(0);
+  NodeBranch&                   branch = m_branches[index];
+
+  for (int consumer: node.consumers) {
+    const FlowNode& target = nodes[consumer];
+    for (int pin = 0; pin < target.ins.size(); pin++) {
+      if (target.ins[pin].node != index)
+        continue ;
+      int     slot = m_outFirst[index] + target.ins[pin].pin;
+      double  offered = node.offered[target.ins[pin].pin];
+      int     takenVar;
+      double  taken = recordAccepted(flow, consumer, pin, takenVar);
+      if (!(offered > 0.0 && taken < offered) || !(node.demand * taken / offered < limit))
+        continue ;
+      limit = node.demand * taken / offered;
+      addTerm(m_demandVars[index], taken / offered);
+      addTerm(takenVar, node.demand / offered);
+      addTerm(m_offeredVars[slot], -node.demand * taken / (offered * offered));
+      m_limitVars[index] = closeVariable();
+      branch.node = consumer;
+      branch.pin = pin;
+    }
+  }
+}
+
+//Reverse sweep from one output over the variables it reaches, highest first
+//so every adjoint is complete before it is passed on. It costs what the
+//output depends on and not the whole tape. The parameters are the first
+//variables, variable i is parameter i. m_values and m_active are clear
+//between calls.
+void  Sensitivity::propagate(int row) {
+  int   params = m_params.size();
+  int   seed = m_rateVars[m_outputs[row]];
+
+  if (seed >= 0) {
+    m_values[seed] = 1.0;
+    m_active[seed] = 1;
+    m_queue.push(seed);
+  }
+  while (!m_queue.empty()) {
+    int     var = m_queue.top();
+    double  adjoint = m_values[var];
+    m_queue.pop();
+    m_reached.push_back(var);
+    for (int term = m_termFirst[var]; term < m_termFirst[var + 1]; term++) {
+      int source = m_terms[term].source;
+      m_values[source] += adjoint * m_terms[term].weight;
+      if (!m_active[source]) {
+        m_active[source] = 1;
+        m_queue.push(source);
+      }
+    }
+  }
+  //Reached from the highest variable down, the parameters come last
+  size_t  first = m_entries.size();
+  for (int var: m_reached) {
+    if (var < params && m_values[var] != 0.0)
+      m_entries.push_back({var, m_values[var]});
+    m_values[var] = 0.0;
+    m_active[var] = 0;
+  }
+  std::reverse(m_entries.begin() + first, m_entries.end());
+  m_reached.clear();
+}
+
+void  Sensitivity::writeCsv(std::ostream& out) const {
+  out << "output";
+  for (auto& label: m_paramLabels) {
+    out << ',';
+    writeCsvField(out, label);
+  }
+  out << '\n';
+  for (int row = 0; row < m_outputs.size(); row++) {
+    const Entry*  entry = rowBegin(row);
+    writeCsvField(out, m_outputLabels[row]);
+    for (int column = 0; column < m_params.size(); column++) {
+      bool  set = entry != rowEnd(row) && entry->param == column;
+      out << ',' << (set ? (entry++)->value : 0.0);
+    }
+    out << '\n';
+  }
+}
+
+void  Sensitivity::writeBranches(std::ostream& out, const FlowGraph& flow) const {
+  const std::vector<FlowNode>&  nodes = flow.nodes();
+
+  for (int index: flow.order()) {
+    const FlowNode&   node = nodes[index];
+    const NodeBranch& branch = m_branches[index];
+    if (branch.branch == SB_LIMITED) {
+      out << flowNodeLabel(node, index) << ": held at " << node.limit;
+      if (branch.node >= 0)
+        out << " by " << flowNodeLabel(nodes[branch.node], branch.node) << " pin " << branch.pin + 1;
+      out << '\n';
+    }
+    //Which input holds a recipe only says something when it has a choice
+    else if (branch.branch == SB_INPUT && node.recipe->inputs.size() > 1)
+      out << flowNodeLabel(node, index) << ": limited by " << node.recipe->inputs[branch.pin].name.view() << '\n';
+    for (int pin = 0; pin < node.ins.size(); pin++) {
+      if (capped(index, pin))
+        out << flowNodeLabel(node, index) << ": link into pin " << pin + 1 << " capped at " << node.caps[pin] << '\n';
+    }
+  }
+}
@@ -0,0 +1,106 @@
+#pragma once
+
+#include "flowGraph.hpp"
+#include <ostream>
+#include <queue>
+#include <string>
+#include <vector>
+
+//Derivatives of every OutputNode rate with respect to every InputNode value
+//and PartNode out ratio, where the FlowGraph was last evaluated. The flow is
+//piecewise linear: compute() replays the three sweeps of the evaluation on
+//their current values, keeps the branch every min and clamp took (the input
+//holding a RecipeNode, the link caps and back-pressure limits that bind) and
+//records the derivative of each step as a linear tape. On a tie it takes the
+//branch the evaluator took, links closing a cycle count as constants.
+//Each output then goes back over the part of the tape it depends on, so the
+//matrix costs about what finite differences would touch in one sweep and is
+//kept sparse, most outputs only depend on a few parameters.
+class Sensitivity {
+  public:
+    enum  Branch {
+      SB_FREE,      //Follows its inputs, or its value for a source
+      SB_LIMITED,   //Held by its limit from what follows
+      SB_INPUT,     //RecipeNode held by one of its inputs
+    };
+    //SB_INPUT: pin is the limiting input. SB_LIMITED: node and pin are the
+    //consumer in pin taking the least of what the node offers.
+    struct  NodeBranch {
+      Branch  branch = SB_FREE;
+      int     node = -1;
+      int     pin = -1;
+    };
+    struct  Param {
+      int   node;
+      int   pin;    //-1 for an InputNode value, the out pin of a PartNode ratio
+    };
+    struct  Entry {
+      int     param;
+      double  value;
+    };
+
+    void  compute(const FlowGraph& flow);
+
+    const std::vector<int>&         outputs() const {return (m_outputs);}
+    const std::vector<Param>&       params() const {return (m_params);}
+    const std::vector<std::string>& outputLabels() const {return (m_outputLabels);}
+    const std::vector<std::string>& paramLabels() const {return (m_paramLabels);}
+    //d output / d param, output and param index the lists above
+    double                          at(int output, int param) const;
+    //The non zero entries of an output by increasing param
+    const Entry*                    rowBegin(int output) const {return (m_entries.data() + m_rowFirst[output]);}
+    const Entry*                    rowEnd(int output) const {return (m_entries.data() + m_rowFirst[output + 1]);}
+    size_t                          nonZeros() const {return (m_entries.size());}
+    const NodeBranch&               branch(int node) const {return (m_branches[node]);}
+    //The link into the pin is asked for more than its cap, or carries it
+    bool                            capped(int node, int pin) const {return (m_capped[m_inFirst[node] + pin]);}
+    size_t                          tapeSize() const {return (m_terms.size());}
+
+    //One row per output, one column per parameter
+    void  writeCsv(std::ostream& out) const;
+    //Every node not simply following its inputs, and every binding cap
+    void  writeBranches(std::ostream& out, const FlowGraph& flow) const;
+
+  private:
+    struct  Term {
+      int     source;
+      double  weight;
+    };
+
+    //Tape variables are numbered in creation order, their terms only refer to
+    //earlier ones. A variable without terms is a constant and reads as -1.
+    void    addTerm(int source, double weight);
+    int     closeVariable(bool keepEmpty = false);
+
+    void    recordNode(const FlowGraph& flow, int index, bool demand);
+    void    recordLimit(const FlowGraph& flow, int index);
+    double  recordAccepted(const FlowGraph& flow, int target, int pin, int& variable);
+    void    propagate(int row);
+    double  outFactor(const FlowNode& node, int pin) const;
+
+    std::vector<int>          m_outputs;
+    std::vector<Param>        m_params;
+    std::vector<int>          m_paramFirst;   //Per node, its first parameter, -1 if none
+    std::vector<std::string>  m_outputLabels;
+    std::vector<std::string>  m_paramLabels;
+    std::vector<Entry>        m_entries;
+    std::vector<int>          m_rowFirst;     //Per output, its first entry, then the end
+
+    std::vector<NodeBranch>   m_branches;
+    std::vector<int>          m_inFirst;
+    std::vector<int>          m_outFirst;
+    std::vector<char>         m_capped;       //Per in slot
+
+    std::vector<Term>         m_terms;
+    std::vector<int>          m_termFirst;    //Per variable, then the end
+    std::vector<int>          m_paramVars;
+    std::vector<int>          m_offeredVars;  //Per out slot
+    std::vector<int>          m_outVars;
+    std::vector<int>          m_demandVars;   //Per node
+    std::vector<int>          m_limitVars;
+    std::vector<int>          m_rateVars;
+    std::vector<double>       m_values;       //Adjoint per variable
+    std::vector<char>         m_active;       //Per variable, reached by the current output
+    std::vector<int>          m_reached;
+    std::priority_queue<int>  m_queue;
+};
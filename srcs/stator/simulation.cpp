@@ -0,0 +1,354 @@
+#include "simulation.hpp"
+#include "memoryTracker.hpp"
+#include <algorithm>
+#include <cmath>
+
+static constexpr double s_epsilon = 1e-9;
+
+void  Simulation::reset(const FlowGraph& flow, const SimulationOptions& options) {
+  MemoryScope                   memory(MS_EVALUATION);
+  const std::vector<FlowNode>&  nodes = flow.nodes();
+  int                           count = nodes.size();
+
+  m_options = options;
+  m_options.tick = std::max(m_options.tick, 1e-3);
+  m_ticks = 0;
+  m_ticksPerSample = std::max<int64_t>(1, std::llround(m_options.sampleInterval / m_options.tick));
+  m_order = flow.order();
+  m_types.resize(count);
+  m_inFirst.assign(count + 1, 0);
+  m_outFirst.assign(count + 1, 0);
+  for (int i = 0; i < count; i++) {
+    m_types[i] = nodes[i].type;
+    m_inFirst[i + 1] = m_inFirst[i] + nodes[i].ins.size();
+    m_outFirst[i + 1] = m_outFirst[i] + nodes[i].outs.size();
+  }
+  m_value.assign(count, 0.0);
+  m_cycle.assign(count, 0.0);
+  m_progress.assign(count, -1.0);
+  m_level.assign(count, 0.0);
+  m_held.assign(count, 0);
+  m_window.assign(count, 0.0);
+  m_inLevel.assign(m_inFirst[count], 0.0);
+  m_inCapacity.assign(m_inFirst[count], m_options.linkBuffer);
+  m_inRoom.assign(m_inFirst[count], 0.0);
+  m_inRate.assign(m_inFirst[count], 0.0);
+  for (int i = 0; i < count; i++) {
+    for (int pin = 0; pin < nodes[i].caps.size(); pin++)
+      m_inRate[m_inFirst[i] + pin] = nodes[i].caps[pin] * m_options.tick / 60.0;
+  }
+  m_need.assign(m_inFirst[count], 0.0);
+  m_yield.assign(m_outFirst[count], 0.0);
+  m_outStock.assign(m_outFirst[count], 0.0);
+
+  //Out slot -> linked in slots, grouped by out slot
+  m_targetFirst.assign(m_outFirst[count] + 1, 0);
+  for (int i = 0; i < count; i++) {
+    for (auto& ref: nodes[i].ins) {
+      if (ref.node >= 0 && ref.pin < nodes[ref.node].outs.size())
+        m_targetFirst[m_outFirst[ref.node] + ref.pin + 1]++;
+    }
+  }
+  for (int slot = 0; slot < m_outFirst[count]; slot++)
+    m_targetFirst[slot + 1] += m_targetFirst[slot];
+  std::vector<int>  cursor(m_targetFirst.begin(), m_targetFirst.end() - 1);
+  m_targets.resize(m_targetFirst.back());
+  for (int i = 0; i < count; i++) {
+    for (int pin = 0; pin < nodes[i].ins.size(); pin++) {
+      const FlowPinRef& ref = nodes[i].ins[pin];
+      if (ref.node >= 0 && ref.pin < nodes[ref.node].outs.size())
+        m_targets[cursor[m_outFirst[ref.node] + ref.pin]++] = m_inFirst[i] + pin;
+    }
+  }
+
+  m_stats.assign(count, NodeStats());
+  for (int i = 0; i < count; i++) {
+    const FlowNode& node = nodes[i];
+    NodeStats&      stats = m_stats[i];
+    int             outs = m_outFirst[i];
+    int             ins = m_inFirst[i];
+    stats.label = flowNodeLabel(node, i);
+    switch (node.type) {
+      case SNT_IN_NODE:
+        m_yield[outs] = node.value;
+        stats.steadyRate = node.outs[0];
+        break;
+      case SNT_BLUEPRINT_NODE:
+        for (int pin = 0; pin < node.outs.size(); pin++)
+          m_yield[outs + pin] = node.value * node.ratios[pin];
+        break;
+      case SNT_PART_NODE:
+        for (int pin = 0; pin < node.outs.size(); pin++)
+          m_yield[outs + pin] = std::max(node.ratios[pin], 0.0);
+        break;
+      case SNT_RECIPE_NODE:
+        {
+          double  cycle = node.value > 0.0 ? node.value : m_options.cycleTime;
+          double  batch = node.rate * cycle / 60.0;
+          if (batch <= 0.0 || node.recipe == nullptr)
+            break ;
+          m_value[i] = node.rate;
+          m_cycle[i] = cycle;
+          for (int pin = 0; pin < node.ins.size(); pin++) {
+            m_need[ins + pin] = node.recipe->inputs[pin].quantity * batch;
+            m_inCapacity[ins + pin] = std::max(m_options.linkBuffer, 2.0 * m_need[ins + pin]);
+          }
+          for (int pin = 0; pin < node.outs.size(); pin++)
+            m_yield[outs + pin] = node.recipe->outputs[pin].quantity * batch;
+          stats.steadyRate = node.rate;
+        }
+        break;
+      case SNT_GENERATOR_NODE:
+        m_value[i] = node.part != nullptr && node.part->energy > 0.0 ? node.value * 60.0 / node.part->energy : 0.0;
+        stats.steadyRate = std::min(node.rate, m_value[i]);
+        break;
+      case SNT_STORAGE_NODE:
+        m_value[i] = std::max(node.value, 0.0);
+        stats.steadyRate = node.rate;
+        break;
+      case SNT_OUT_NODE:
+        stats.steadyRate = node.rate;
+        break;
+      default:
+        break;
+    }
+  }
+  m_sampleTimes.clear();
+}
+
+void  Simulation::run(double seconds) {
+  MemoryScope memory(MS_EVALUATION);
+  int64_t ticks = std::llround(seconds / m_options.tick);
+  size_t  samples = m_sampleTimes.size() + ticks / m_ticksPerSample + 1;
+
+  m_sampleTimes.reserve(samples);
+  for (auto& stats: m_stats)
+    stats.samples.reserve(samples);
+  for (int64_t i = 0; i < ticks; i++) {
+    m_ticks++;
+    step(m_options.tick);
+    if (m_ticks % m_ticksPerSample == 0)
+      sample();
+  }
+}
+
+//What the in pins linked to the out slot still take this tick
+double  Simulation::room(int outSlot) const {
+  double  room = 0.0;
+  for (int t = m_targetFirst[outSlot]; t < m_targetFirst[outSlot + 1]; t++) {
+    int in = m_targets[t];
+    room += std::max(0.0, std::min(m_inCapacity[in] - m_inLevel[in], m_inRoom[in]));
+  }
+  return (room);
+}
+
+//Split amount evenly between the linked in pins, what a full buffer or a
+//capped link refuses goes to the others on the second pass. Returns what was taken.
+double  Simulation::distribute(int outSlot, double amount) {
+  int     first = m_targetFirst[outSlot];
+  int     last = m_targetFirst[outSlot + 1];
+  double  pushed = 0.0;
+
+  for (int pass = 0; pass < 2 && amount - pushed > s_epsilon; pass++) {
+    int open = 0;
+    for (int t = first; t < last; t++)
+      open += std::min(m_inCapacity[m_targets[t]] - m_inLevel[m_targets[t]], m_inRoom[m_targets[t]]) > s_epsilon;
+    if (open == 0)
+      break ;
+    double  share = (amount - pushed) / open;
+    for (int t = first; t < last; t++) {
+      int     in = m_targets[t];
+      double  moved = std::min({share, m_inCapacity[in] - m_inLevel[in], m_inRoom[in]});
+      if (moved <= s_epsilon)
+        continue ;
+      m_inLevel[in] += moved;
+      m_inRoom[in] -= moved;
+      pushed += moved;
+    }
+  }
+  return (pushed);
+}
+
+void  Simulation::step(double dt) {
+  double  now = time();
+
+  //What every link can still carry this tick
+  std::copy(m_inRate.begin(), m_inRate.end(), m_inRoom.begin());
+  for (int index: m_order) {
+    int inBegin = m_inFirst[index];
+    int inEnd = m_inFirst[index + 1];
+    int outBegin = m_outFirst[index];
+    int outEnd = m_outFirst[index + 1];
+    switch (m_types[index]) {
+      //Sources run at their rate, what the links refuse is never produced
+      case SNT_IN_NODE:
+      case SNT_BLUEPRINT_NODE:
+        for (int slot = outBegin; slot < outEnd; slot++)
+          m_window[index] += distribute(slot, m_yield[slot] * dt / 60.0);
+        break;
+      //Every out pin gets its ratio of what is taken in, as in the
+      //evaluator ratios summing past 1 make items and below 1 lose some. The
+      //linked out pin with the least room holds back the whole node, like
+      //the back-pressure limit.
+      case SNT_PART_NODE:
+        {
+          double  available = 0.0;
+          double  taken = 1.0;
+          for (int slot = inBegin; slot < inEnd; slot++)
+            available += m_inLevel[slot];
+          if (available <= s_epsilon)
+            break ;
+          for (int slot = outBegin; slot < outEnd; slot++) {
+            if (m_yield[slot] > s_epsilon && m_targetFirst[slot] < m_targetFirst[slot + 1])
+              taken = std::min(taken, room(slot) / (available * m_yield[slot]));
+          }
+          if (taken <= s_epsilon)
+            break ;
+          for (int slot = outBegin; slot < outEnd; slot++)
+            distribute(slot, available * taken * m_yield[slot]);
+          for (int slot = inBegin; slot < inEnd; slot++)
+            m_inLevel[slot] *= 1.0 - taken;
+          m_window[index] += available * taken;
+        }
+        break;
+      case SNT_RECIPE_NODE:
+        craft(index, dt);
+        break;
+      case SNT_STORAGE_NODE:
+        {
+          double&     level = m_level[index];
+          double      capacity = m_value[index];
+          NodeStats&  stats = m_stats[index];
+          for (int slot = inBegin; slot < inEnd; slot++) {
+            double  taken = std::min(m_inLevel[slot], capacity - level);
+            m_inLevel[slot] -= taken;
+            level += taken;
+          }
+          double  pushed = outBegin < outEnd ? distribute(outBegin, level) : 0.0;
+          level -= pushed;
+          m_window[index] += pushed;
+          if (capacity > 0.0 && level >= capacity - s_epsilon) {
+            if (stats.filledAt < 0.0)
+              stats.filledAt = now;
+            m_held[index] = 1;
+          }
+          else if (m_held[index] && level <= s_epsilon && stats.emptiedAt < 0.0)
+            stats.emptiedAt = now;
+        }
+        break;
+      case SNT_OUT_NODE:
+        for (int slot = inBegin; slot < inEnd; slot++) {
+          m_window[index] += m_inLevel[slot];
+          m_inLevel[slot] = 0.0;
+        }
+        break;
+      case SNT_GENERATOR_NODE:
+        for (int slot = inBegin; slot < inEnd; slot++) {
+          double  burnt = m_value[index] > 0.0 ? std::min(m_inLevel[slot], m_value[index] * dt / 60.0) : 0.0;
+          m_inLevel[slot] -= burnt;
+          m_window[index] += burnt;
+        }
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+//Start a craft once every input holds one and the outputs have room for
+//one more, its products appear when the cycle ends
+void  Simulation::craft(int index, double dt) {
+  double  cycle = m_cycle[index];
+  int     inBegin = m_inFirst[index];
+  int     inEnd = m_inFirst[index + 1];
+  int     outBegin = m_outFirst[index];
+  int     outEnd = m_outFirst[index + 1];
+
+  if (cycle <= 0.0)
+    return ;
+  while (dt > 0.0) {
+    if (m_progress[index] < 0.0) {
+      bool  ready = true;
+      for (int slot = inBegin; ready && slot < inEnd; slot++)
+        ready = m_inLevel[slot] >= m_need[slot] * (1.0 - s_epsilon);
+      for (int slot = outBegin; ready && slot < outEnd; slot++)
+        ready = m_outStock[slot] <= m_yield[slot] * (1.0 + s_epsilon);
+      if (!ready)
+        break ;
+      for (int slot = inBegin; slot < inEnd; slot++)
+        m_inLevel[slot] = std::max(0.0, m_inLevel[slot] - m_need[slot]);
+      m_progress[index] = 0.0;
+    }
+    double  advance = std::min(dt, cycle - m_progress[index]);
+    m_progress[index] += advance;
+    m_window[index] += advance;
+    dt -= advance;
+    if (m_progress[index] < cycle - s_epsilon)
+      break ;
+    m_progress[index] = -1.0;
+    for (int slot = outBegin; slot < outEnd; slot++) {
+      m_outStock[slot] += m_yield[slot];
+      m_outStock[slot] -= distribute(slot, m_outStock[slot]);
+    }
+  }
+  for (int slot = outBegin; slot < outEnd; slot++) {
+    if (m_outStock[slot] > s_epsilon)
+      m_outStock[slot] -= distribute(slot, m_outStock[slot]);
+  }
+}
+
+bool  Simulation::tracked(int node) const {
+  StatorNodeType  type = m_types[node];
+  return ((type == SNT_OUT_NODE || type == SNT_GENERATOR_NODE || type == SNT_RECIPE_NODE)
+      && m_stats[node].steadyRate > 0.0);
+}
+
+void  Simulation::sample() {
+  double  interval = m_ticksPerSample * m_options.tick;
+  double  now = time();
+
+  m_sampleTimes.push_back(now);
+  for (int i = 0; i < m_stats.size(); i++) {
+    NodeStats&  stats = m_stats[i];
+    if (m_types[i] == SNT_RECIPE_NODE)
+      stats.rate = m_value[i] * m_window[i] / interval;
+    else
+      stats.rate = m_window[i] * 60.0 / interval;
+    m_window[i] = 0.0;
+    stats.samples.push_back(m_types[i] == SNT_STORAGE_NODE ? m_level[i] : stats.rate);
+    if (!tracked(i))
+      continue ;
+    if (std::abs(stats.rate - stats.steadyRate) > m_options.tolerance * stats.steadyRate)
+      stats.settledAt = -1.0;
+    else if (stats.settledAt < 0.0)
+      stats.settledAt = now - interval;
+  }
+}
+
+double  Simulation::settleTime() const {
+  double  settled = 0.0;
+
+  for (int i = 0; i < m_stats.size(); i++) {
+    if (!tracked(i))
+      continue ;
+    if (m_stats[i].settledAt < 0.0)
+      return (-1.0);
+    settled = std::max(settled, m_stats[i].settledAt);
+  }
+  return (settled);
+}
+
+void  Simulation::writeCsv(std::ostream& out) const {
+  out << "time";
+  for (auto& stats: m_stats) {
+    out << ',';
+    writeCsvField(out, stats.label);
+  }
+  out << '\n';
+  for (int row = 0; row < m_sampleTimes.size(); row++) {
+    out << m_sampleTimes[row];
+    for (auto& stats: m_stats)
+      out << ',' << stats.samples[row];
+    out << '\n';
+  }
+}
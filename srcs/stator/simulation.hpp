@@ -0,0 +1,85 @@
+#pragma once
+
+#include "flowGraph.hpp"
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+struct  SimulationOptions {
+  double  tick = 0.1;             //Seconds per step
+  double  sampleInterval = 60.0;  //Seconds between two samples
+  double  linkBuffer = 50.0;      //Items a link holds, raised to two cycles of its consumer
+  double  cycleTime = 4.0;        //Seconds per craft of the RecipeNodes without their own
+  double  tolerance = 0.05;       //Relative gap to the steady rate still counted as reached
+};
+
+//Time-domain run of a compiled FlowGraph. Every linked in pin buffers the
+//items its link carries, at most at the link capacity, RecipeNodes craft one
+//cycle at a time at their steady-state building count, StorageNodes fill up
+//when what follows can't keep up and sinks consume what reaches them. It tells how long a line
+//takes to reach the rates the evaluator computed and when storage fills or
+//runs dry. reset() copies what it needs into flat arrays, ticks allocate nothing.
+class Simulation {
+  public:
+    //Times are in seconds, -1 while it did not happen
+    struct  NodeStats {
+      std::string         label;
+      double              steadyRate = 0.0; //Evaluator rate: items/min, buildings for a RecipeNode
+      double              rate = 0.0;       //Same unit, measured over the last sample
+      double              settledAt = -1.0; //Since when the rate stays within tolerance
+      double              filledAt = -1.0;  //StorageNode first full
+      double              emptiedAt = -1.0; //StorageNode first empty after it was full
+      std::vector<float>  samples;          //Rate, content for a StorageNode
+    };
+
+    void    reset(const FlowGraph& flow, const SimulationOptions& options = SimulationOptions());
+    //Advance by whole ticks until seconds of simulated time went by
+    void    run(double seconds);
+
+    double                          time() const {return (m_ticks * m_options.tick);}
+    const std::vector<float>&       sampleTimes() const {return (m_sampleTimes);}
+    const std::vector<NodeStats>&   stats() const {return (m_stats);}
+    //When the last sink or recipe reached its steady rate, -1 if one still hasn't
+    double                          settleTime() const;
+    //One row per sample: time then every node's sample
+    void                            writeCsv(std::ostream& out) const;
+
+  private:
+    void    step(double dt);
+    void    craft(int node, double dt);
+    void    sample();
+    double  room(int outSlot) const;
+    double  distribute(int outSlot, double amount);
+    bool    tracked(int node) const;
+
+    SimulationOptions   m_options;
+    int64_t             m_ticks = 0;
+    int64_t             m_ticksPerSample = 1;
+
+    //Per node, ins and outs are slots m_inFirst[node] to m_inFirst[node + 1]
+    std::vector<StatorNodeType> m_types;
+    std::vector<int>            m_order;
+    std::vector<int>            m_inFirst;
+    std::vector<int>            m_outFirst;
+    std::vector<double>         m_value;      //RecipeNode buildings, GeneratorNode fuel/min, StorageNode capacity
+    std::vector<double>         m_cycle;      //RecipeNode seconds per craft, 0 when it can't run
+    std::vector<double>         m_progress;   //RecipeNode seconds into the current craft, -1 when idle
+    std::vector<double>         m_level;      //StorageNode content
+    std::vector<char>           m_held;       //StorageNode was full once
+    std::vector<double>         m_window;     //Items moved, or RecipeNode busy seconds, since the last sample
+    //Per in slot
+    std::vector<double>         m_inLevel;
+    std::vector<double>         m_inCapacity;
+    std::vector<double>         m_inRate;     //Items the link carries per tick, infinity if uncapped
+    std::vector<double>         m_inRoom;     //Left of m_inRate this tick
+    std::vector<double>         m_need;       //RecipeNode items per craft
+    //Per out slot
+    std::vector<double>         m_yield;      //RecipeNode items per craft, PartNode ratio, source items/min
+    std::vector<double>         m_outStock;   //RecipeNode items crafted and not taken yet
+    std::vector<int>            m_targetFirst;
+    std::vector<int>            m_targets;    //In slots linked to every out slot
+
+    std::vector<float>          m_sampleTimes;
+    std::vector<NodeStats>      m_stats;
+};
@@ -1,53 +1,35 @@
 #pragma once
+#include "stringPool.hpp"
 #include <boost/json.hpp>
 #include <imgui.h>
 #include <string>
+#include <vector>
 
 namespace json = boost::json;
 
-struct  PartWithQuantity {
-  PartWithQuantity() {};
-  PartWithQuantity(json::object part) {
-    name = part["Part"].as_string();
-    if (part["Quantity"].is_int64())
-      quantity = (double)part["Quantity"].as_int64();
-    else
-      quantity = (double)part["Quantity"].as_double();
-  }
+inline double jsonNumber(const json::value& value) {
+  return (value.to_number<double>());
+}
 
-  std::string   name;
-  double        quantity;
+//Read from the catalog files by readParts/readRecipes (catalogLoader.hpp),
+//the index fields are filled by Catalog::build (catalog.hpp). Names are
+//pooled, a quantity shares the text of the part it names.
+struct  PartWithQuantity {
+  PooledString  name;
+  double        quantity = 0.0;
+  int           part = -1;  //Catalog index, -1 if no such part
 };
 
-struct  Recipe ;
-
 struct  Part {
-  Part(json::object partJson) {
-    name = partJson["name"].as_string();
-    imgPath = partJson["img"].as_string();
-  }
-
-  void  addRecipe(Recipe& recipe) {
-    recipes.push_back(&recipe);
-  }
-
-  std::string           name;
-  std::string           imgPath;
-  std::vector<Recipe*>  recipes;
+  PooledString      name;
+  PooledString      imgPath;
+  double            energy = 0.0; //MJ per unit, 0 if the part can't be burned
+  std::vector<int>  recipes;      //Catalog indices of the recipes producing it
+  bool              removed = false; //Dropped by a reload, kept so indices stay valid
 };
 
 struct  Recipe {
-  Recipe(json::object recipeJson) {
-    id = recipeJson["RecipeId"].as_int64();
-    for (auto& input: recipeJson["Input"].as_array()) {
-      inputs.push_back(PartWithQuantity(input.as_object()));
-    }
-    for (auto& output: recipeJson["Output"].as_array()) {
-      outputs.push_back(PartWithQuantity(output.as_object()));
-    }
-  }
-  
-  void  drawPopUp() {
+  void  drawPopUp() const {
     ImGui::Text("IN:");
     for (auto& in: inputs) {
       ImGui::Text("%s, %lf", in.name.c_str(), in.quantity);
@@ -56,12 +38,12 @@ struct  Recipe {
     for (auto& out: outputs) {
       ImGui::Text("%s, %lf", out.name.c_str(), out.quantity);
     }
+    ImGui::Text("POWER: %lf MW", power);
   }
 
-  int                             id;
+  int                             id = 0;
+  double                          power = 0.0; //MW drawn by one building
   std::vector<PartWithQuantity>   inputs; 
   std::vector<PartWithQuantity>   outputs; 
+  bool                            removed = false; //Dropped by a reload, kept so indices stay valid
 };
-
-static std::vector<Part>    partsGlobalArray;
-static std::vector<Recipe>  recipesGlobalArray;
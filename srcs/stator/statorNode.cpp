@@ -11,5 +11,11 @@ StatorNodeType  sntFromString(std::string type) {
     return (SNT_IN_NODE);
   if (type == "SNT_OUT_NODE")
     return (SNT_OUT_NODE);
+  if (type == "SNT_GENERATOR_NODE")
+    return (SNT_GENERATOR_NODE);
+  if (type == "SNT_BLUEPRINT_NODE")
+    return (SNT_BLUEPRINT_NODE);
+  if (type == "SNT_STORAGE_NODE")
+    return (SNT_STORAGE_NODE);
   return (SNT_NA);
 }
@@ -1,10 +1,13 @@
 #pragma once
+#include <algorithm>
+#include <cstdint>
 #include <boost/json.hpp>
 #include <functional>
 #include <imgui.h>
 #include <string>
 #include "ImNodeFlow.h"
-#include "stator.hpp"
+#include "catalog.hpp"
+#include "iconAtlas.hpp"
 
 enum StatorNodeType {
   SNT_NA,
@@ -13,6 +16,9 @@ enum StatorNodeType {
   SNT_PART_NODE,
   SNT_IN_NODE,
   SNT_OUT_NODE,
+  SNT_GENERATOR_NODE,
+  SNT_BLUEPRINT_NODE,
+  SNT_STORAGE_NODE,
 };
 
 StatorNodeType  sntFromString(std::string type);
@@ -20,13 +26,42 @@ StatorNodeType  sntFromString(std::string type);
 namespace json = boost::json;
 using namespace ImFlow;
 
+struct  StatorNode;
+
+struct  StatorNodeListener {
+  virtual void  nodeValueChanged(StatorNode* node) = 0;
+  virtual void  nodePinsChanged() = 0;
+};
+
 struct  StatorNode : BaseNode {
   virtual void            drawPopUp() {;}
   virtual StatorNodeType  statorNodeType() = 0;
   virtual json::value     toJson() = 0;
   virtual void            fromJson(json::value value) {;}
+
+  //Tell the owning factory a value changed (valueChanged) or pins were added/removed (pinsChanged)
+  void                    valueChanged() {
+    if (owner != nullptr)
+      owner->nodeValueChanged(this);
+  }
+  void                    pinsChanged() {
+    if (owner != nullptr)
+      owner->nodePinsChanged();
+  }
+
+  StatorNodeListener*     owner = nullptr;
+  uint64_t                id = 0;           //Unique in the owning factory, kept across saves
 };
 
+//Pin ids are derived from the node id and the pin index, so they stay valid
+//for as long as the pin keeps its place on the node
+inline uint64_t   pinId(uint64_t node, bool out, int index) {
+  return ((node << 16) | ((uint64_t)out << 15) | (uint64_t)(index & 0x7fff));
+}
+inline uint64_t   pinNode(uint64_t pin) {return (pin >> 16);}
+inline bool       pinIsOut(uint64_t pin) {return ((pin >> 15) & 1);}
+inline int        pinSlot(uint64_t pin) {return (pin & 0x7fff);}
+
 struct  InputNode: public StatorNode {
   InputNode(double v = 0.0): value(v) {
     setTitle("Input");
@@ -35,7 +70,8 @@ struct  InputNode: public StatorNode {
 
   void  draw() override {
     ImGui::SetNextItemWidth(100.f);
-    ImGui::InputDouble("##Val", &value);
+    if (ImGui::InputDouble("##Val", &value))
+      valueChanged();
   }
 
   StatorNodeType  statorNodeType() override {
@@ -45,12 +81,12 @@ struct  InputNode: public StatorNode {
   json::value     toJson() override {
     json::object value = {
       {"type", "SNT_IN_NODE"},
-      {"value", value},
+      {"value", this->value},
     };
     return (value);
   }
   void            fromJson(json::value value) override {
-    this->value = value.as_object()["value"].as_double();
+    this->value = jsonNumber(value.as_object()["value"]);
   }
 
   double  value = 0.0;
@@ -65,7 +101,12 @@ struct  OutputNode: public StatorNode {
   void  draw() override {
     double r = this->getInVal<double>("in");
     ImGui::SetNextItemWidth(100.f);
-    ImGui::Text("%f", r);
+    if (!exactValue.empty())
+      ImGui::Text("%s", exactValue.c_str());
+    else if (flowRate >= 0.0 && flowRate < r * (1.0 - 1e-9))
+      ImGui::TextColored(ImVec4(0.9, 0.6, 0.2, 1.0), "%f (link caps)", flowRate);
+    else
+      ImGui::Text("%f", r);
   }
 
   StatorNodeType  statorNodeType() override {
@@ -78,11 +119,47 @@ struct  OutputNode: public StatorNode {
     };
     return (value);
   }
+
+  std::string exactValue; //Filled by the editor in exact mode
+  double      flowRate = -1.0;  //Filled by the editor, lower than the input when link caps hold it back
+};
+
+//Container between two links. The evaluator passes its input through, the
+//simulation fills it up to capacity when what follows can't keep up.
+struct  StorageNode: public StatorNode {
+  StorageNode(double a_capacity = 2400.0): capacity(a_capacity) {
+    setTitle("Storage");
+    addIN<double>("in", 0, ConnectionFilter::SameType());
+    addOUT<double>("out")->behaviour([this](){return (getInVal<double>("in"));});
+  }
+
+  void  draw() override {
+    ImGui::SetNextItemWidth(100.f);
+    if (ImGui::InputDouble("items##capacity", &capacity))
+      valueChanged();
+  }
+
+  StatorNodeType  statorNodeType() override {
+    return (SNT_STORAGE_NODE);
+  };
+
+  json::value     toJson() override {
+    json::object value = {
+      {"type", "SNT_STORAGE_NODE"},
+      {"capacity", capacity},
+    };
+    return (value);
+  }
+  void            fromJson(json::value value) override {
+    capacity = jsonNumber(value.as_object()["capacity"]);
+  }
+
+  double  capacity;
 };
 
 struct  PartNode: public StatorNode {
-  PartNode(Part& a_part): part(a_part) {
-    setTitle(part.name.c_str());
+  PartNode(PartHandle a_part): part(a_part) {
+    setTitle(part->name.c_str());
     setStyle(NodeStyle::red());
 
     addInPin();
@@ -108,6 +185,7 @@ struct  PartNode: public StatorNode {
     inCount += 1;
     std::string name = "in" + std::to_string(inCount);
     addIN<double>(name, 0, ConnectionFilter::SameType());
+    pinsChanged();
   }
 
   void  addOutPin(double r = 1.0) {
@@ -122,12 +200,14 @@ struct  PartNode: public StatorNode {
       }
       return (pin->calcQuantity(quantity));
     });
+    pinsChanged();
   }
   void  removeIn() {
     if (inCount > 0) {
       std::string name = "in" + std::to_string(inCount);
       dropIN(name);
       inCount -= 1;
+      pinsChanged();
     }
   }
   void  removeOut() {
@@ -136,6 +216,7 @@ struct  PartNode: public StatorNode {
       dropOUT(name);
       delete(outRatios.back());
       outRatios.resize(outRatios.size() - 1);
+      pinsChanged();
     }
   }
   void  reset() {
@@ -146,11 +227,13 @@ struct  PartNode: public StatorNode {
   }
 
   void  draw() override {
+    IconAtlas::instance().draw(part->imgPath, part->name, 32.f);
     int i = 0;
     for (auto& out: outRatios) {
       ImGui::SetNextItemWidth(100.f);
       ImGui::PushID(i);
-      ImGui::InputDouble("##out", &out->ratio);
+      if (ImGui::InputDouble("##out", &out->ratio))
+        valueChanged();
       ImGui::PopID();
       i++;
     }
@@ -184,7 +267,7 @@ struct  PartNode: public StatorNode {
     }
     json::object value = {
       {"type", "SNT_PART_NODE"},
-      {"name", part.name},
+      {"name", part->name.view()},
       {"inCount", inCount},
       {"outs", outs},
     };
@@ -193,42 +276,74 @@ struct  PartNode: public StatorNode {
 
   void            fromJson(json::value value) override {
     reset();
-    int inN = value.as_object()["inCount"].as_int64();
+    int inN = value.as_object()["inCount"].to_number<int>();
     while (inCount < inN) {
       addInPin();
     }
     json::array outs = value.as_object()["outs"].as_array();
     for (auto& out: outs) {
-      addOutPin(out.as_double());
+      addOutPin(jsonNumber(out));
     }
   }
 
   int                       inCount = 0;
-  Part&                     part;
+  PartHandle                part;
   std::vector<OutRatioPin*> outRatios;
 };
 
 
 struct  RecipeNode: public StatorNode {
-  RecipeNode(Recipe& a_recipe): recipe(a_recipe) {
+  RecipeNode(RecipeHandle a_recipe): recipe(a_recipe) {
     setTitle("Recipe");
     setStyle(NodeStyle::green());
-    for (auto& in: recipe.inputs) {
-      addIN<double>(in.name, 0, ConnectionFilter::SameType());
+    addPins();
+  }
+
+  void  addPins() {
+    for (auto& in: recipe->inputs) {
+      addIN<double>(in.name.str(), 0, ConnectionFilter::SameType());
     }
-    for (auto& out: recipe.outputs) {
-      addOUT<double>(out.name)->behaviour([this, out](){
+    for (int i = 0; i < recipe->outputs.size(); i++) {
+      addOUT<double>(recipe->outputs[i].name.str())->behaviour([this, i](){
         double ratioMin = calcRatio();
-        return (ratioMin * out.quantity);
+        return (ratioMin * recipe->outputs[i].quantity);
       });
     }
   }
 
-  inline double  calcRatio(PartWithQuantity& in) {return (getInVal<double>(in.name) / in.quantity);}
+  //Rebuild the pins when a catalog reload renamed, added or removed parts
+  //of the recipe, links to dropped pins go with them
+  void  rebind() {
+    auto& ins = getIns();
+    auto& outs = getOuts();
+    bool  same = ins.size() == recipe->inputs.size() && outs.size() == recipe->outputs.size();
+    for (int i = 0; same && i < ins.size(); i++)
+      same = ins[i]->getName() == recipe->inputs[i].name;
+    for (int i = 0; same && i < outs.size(); i++)
+      same = outs[i]->getName() == recipe->outputs[i].name;
+    if (same)
+      return ;
+    std::vector<std::string>  inNames;
+    std::vector<std::string>  outNames;
+    for (auto& pin: ins)
+      inNames.push_back(pin->getName());
+    for (auto& pin: outs)
+      outNames.push_back(pin->getName());
+    for (auto& name: inNames)
+      dropIN(name);
+    for (auto& name: outNames)
+      dropOUT(name);
+    addPins();
+    pinsChanged();
+  }
+
+  inline double  calcRatio(const PartWithQuantity& in) {return (getInVal<double>(in.name.view()) / in.quantity);}
   double  calcRatio() {
-    double ratioMin = calcRatio(recipe.inputs[0]);
-    for (int i = 1; i < recipe.inputs.size(); i++) {
-      double r = calcRatio(recipe.inputs[i]);
+    if (recipe->inputs.empty())
+      return (0.0);
+    double ratioMin = calcRatio(recipe->inputs[0]);
+    for (int i = 1; i < recipe->inputs.size(); i++) {
+      double r = calcRatio(recipe->inputs[i]);
       if (ratioMin > r)
         ratioMin = r;
     }
@@ -237,16 +352,21 @@ struct  RecipeNode: public StatorNode {
 
   void  drawPopUp() override {
     ImGui::Separator();
-    recipe.drawPopUp();
+    recipe->drawPopUp();
     double  ratioMin = calcRatio();
     ImGui::Separator();
     ImGui::Text("Surplus:");
-    for (auto& in: recipe.inputs) {
-      double inVal = this->getInVal<double>(in.name);
+    for (auto& in: recipe->inputs) {
+      double inVal = this->getInVal<double>(in.name.view());
       double r = inVal / in.quantity;
       if (r > ratioMin)
         ImGui::Text("%s: %lf", in.name.c_str(), inVal * (r - ratioMin));
     }
+    ImGui::Separator();
+    ImGui::Text("Power: %lf MW", recipe->power * ratioMin);
+    ImGui::SetNextItemWidth(100.f);
+    if (ImGui::InputDouble("Cycle time (s)", &cycleTime) && cycleTime >= 0.0)
+      valueChanged();
   }
 
   StatorNodeType  statorNodeType() override {
@@ -256,10 +376,66 @@ struct  RecipeNode: public StatorNode {
   json::value     toJson() override {
     json::object value = {
       {"type", "SNT_RECIPE_NODE"},
-      {"recipeId", recipe.id},
+      {"recipeId", recipe->id},
     };
+    if (cycleTime > 0.0)
+      value["cycleTime"] = cycleTime;
     return (value);
   }
+  void            fromJson(json::value value) override {
+    if (auto cycle = value.as_object().if_contains("cycleTime"); cycle != nullptr && cycle->is_number())
+      cycleTime = jsonNumber(*cycle);
+  }
+
+  RecipeHandle  recipe;
+  double        cycleTime = 0.0;  //Seconds per craft for the simulation, 0 for its default
+};
+
+
+struct  GeneratorNode: public StatorNode {
+  GeneratorNode(PartHandle a_fuel, double a_capacity = 75.0): fuel(a_fuel), capacity(a_capacity) {
+    setTitle("Generator");
+    setStyle(NodeStyle::brown());
+    addIN<double>(fuel->name.str(), 0, ConnectionFilter::SameType());
+  }
+
+  //Fuel burned per minute when running at full capacity
+  double  fuelRequired() {
+    if (fuel->energy <= 0.0)
+      return (0.0);
+    return (capacity * 60.0 / fuel->energy);
+  }
+  double  powerGenerated(double fuelIn) {
+    return (std::min(capacity, fuelIn * fuel->energy / 60.0));
+  }
+
+  void  draw() override {
+    double fuelIn = getInVal<double>(fuel->name.view());
+    IconAtlas::instance().draw(fuel->imgPath, fuel->name, 32.f);
+    ImGui::SetNextItemWidth(100.f);
+    if (ImGui::InputDouble("MW##capacity", &capacity))
+      valueChanged();
+    ImGui::Text("%lf MW", powerGenerated(fuelIn));
+    if (fuelIn < fuelRequired())
+      ImGui::TextColored({0.9, 0.2, 0.2, 1.0}, "Starved: %lf/%lf", fuelIn, fuelRequired());
+  }
+
+  StatorNodeType  statorNodeType() override {
+    return (SNT_GENERATOR_NODE);
+  };
+
+  json::value     toJson() override {
+    json::object value = {
+      {"type", "SNT_GENERATOR_NODE"},
+      {"name", fuel->name.view()},
+      {"capacity", capacity},
+    };
+    return (value);
+  }
+  void            fromJson(json::value value) override {
+    capacity = jsonNumber(value.as_object()["capacity"]);
+  }
 
-  Recipe&   recipe;
+  PartHandle  fuel;
+  double      capacity;
 };
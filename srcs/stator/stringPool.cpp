@@ -0,0 +1,71 @@
+#include "stringPool.hpp"
+#include "memoryTracker.hpp"
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <vector>
+
+namespace {
+  constexpr size_t  chunkSize = 64 * 1024;
+
+  struct  Pool {
+    std::mutex                            mutex;
+    std::unordered_set<std::string_view>  strings;  //Views into the chunks
+    std::vector<std::unique_ptr<char[]>>  chunks;
+    char*                                 next = nullptr;
+    size_t                                left = 0;
+    size_t                                bytes = 0;
+  };
+
+  //Leaked on purpose, static destructors may still read pooled strings
+  Pool&   pool() {
+    static Pool*  instance = new Pool();
+    return (*instance);
+  }
+}
+
+PooledString::PooledString(std::string_view text) {
+  if (text.empty())
+    return ;
+  Pool&                       strings = pool();
+  std::lock_guard<std::mutex> lock(strings.mutex);
+  auto                        it = strings.strings.find(text);
+  if (it == strings.strings.end()) {
+    MemoryScope memory(MS_CATALOG);
+    size_t      size = text.size() + 1;
+    char*       copy;
+    if (size > chunkSize / 4) {
+      //Long strings get a block of their own, the current chunk keeps filling up
+      strings.chunks.emplace_back(new char[size]);
+      strings.bytes += size;
+      copy = strings.chunks.back().get();
+    }
+    else {
+      if (size > strings.left) {
+        strings.chunks.emplace_back(new char[chunkSize]);
+        strings.bytes += chunkSize;
+        strings.next = strings.chunks.back().get();
+        strings.left = chunkSize;
+      }
+      copy = strings.next;
+      strings.next += size;
+      strings.left -= size;
+    }
+    std::memcpy(copy, text.data(), text.size());
+    copy[text.size()] = 0;
+    it = strings.strings.insert(std::string_view(copy, text.size())).first;
+  }
+  m_text = it->data();
+  m_size = it->size();
+}
+
+size_t  PooledString::poolBytes() {
+  std::lock_guard<std::mutex> lock(pool().mutex);
+  return (pool().bytes);
+}
+
+size_t  PooledString::poolCount() {
+  std::lock_guard<std::mutex> lock(pool().mutex);
+  return (pool().strings.size());
+}
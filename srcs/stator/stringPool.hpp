@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+//Catalog text interned in one process wide pool. Every distinct string is
+//copied once, NUL terminated, into 64 KiB chunks that are never freed, so
+//the names a part and every recipe quantity refer to share one copy, equal
+//strings compare by address and copying one copies a pointer. Interning
+//takes a lock, reading doesn't.
+class PooledString {
+  public:
+    PooledString() = default;
+    PooledString(std::string_view text);
+    PooledString(const std::string& text): PooledString(std::string_view(text)) {}
+    PooledString(const char* text): PooledString(std::string_view(text)) {}
+
+    const char*       c_str() const {return (m_text);}
+    size_t            size() const {return (m_size);}
+    bool              empty() const {return (m_size == 0);}
+    std::string_view  view() const {return (std::string_view(m_text, m_size));}
+    std::string       str() const {return (std::string(m_text, m_size));}
+    operator std::string_view() const {return (view());}
+
+    //Bytes taken by the chunks, and distinct strings in them
+    static size_t     poolBytes();
+    static size_t     poolCount();
+
+    friend bool operator==(const PooledString& a, const PooledString& b) {return (a.m_text == b.m_text);}
+    friend bool operator!=(const PooledString& a, const PooledString& b) {return (a.m_text != b.m_text);}
+    friend bool operator==(const PooledString& a, std::string_view b) {return (a.view() == b);}
+    friend bool operator!=(const PooledString& a, std::string_view b) {return (a.view() != b);}
+    friend bool operator==(const PooledString& a, const std::string& b) {return (a.view() == b);}
+    friend bool operator!=(const PooledString& a, const std::string& b) {return (a.view() != b);}
+    friend bool operator==(const PooledString& a, const char* b) {return (a.view() == b);}
+    friend bool operator!=(const PooledString& a, const char* b) {return (a.view() != b);}
+    friend bool operator==(const std::string& a, const PooledString& b) {return (b == a);}
+    friend bool operator!=(const std::string& a, const PooledString& b) {return (b != a);}
+
+  private:
+    //The empty string is never pooled, so every empty one has this address
+    static constexpr char s_empty[1] = {0};
+
+    const char* m_text = s_empty;
+    size_t      m_size = 0;
+};
+
+//Same as for a std::string of the text, so both can key the same lookups
+namespace std {
+  template<>
+  struct  hash<PooledString> {
+    size_t  operator()(const PooledString& text) const {return (hash<string_view>()(text.view()));}
+  };
+}
@@ -3,6 +3,8 @@
 #include "thread"
 #include <GLFW/glfw3.h>
 #include <boost/json/parse.hpp>
+#include <chrono>
+#include <cmath>
 #include <filesystem>
 #include <fstream>
 #include <hephaestus/core/hephResult.hpp>
@@ -12,6 +14,7 @@
 #include <iostream>
 #include <iterator>
 #include <memory>
+#include <sstream>
 #include <string>
 #include <vulkan/vulkan_core.h>
 
@@ -39,13 +42,27 @@ void  StatorGui::callbackKey(GLFWwindow* window, int key, int scancode, int acti
   }
 
 	if (key == GLFW_KEY_F5 && action == GLFW_PRESS) {
+    reloadCatalog();
   }
 
 	if (mods & GLFW_MOD_CONTROL && key == GLFW_KEY_Q) {
 		m_quit = true;
 	}
 
-	if (mods & GLFW_MOD_CONTROL && key == GLFW_KEY_D) {
+  //Text fields keep their own shortcuts
+  if (action == GLFW_PRESS && mods & GLFW_MOD_CONTROL && !ImGui::GetIO().WantTextInput) {
+    if (key == GLFW_KEY_C)
+      m_factoryEditor->copy();
+    if (key == GLFW_KEY_X)
+      m_factoryEditor->cut();
+    if (key == GLFW_KEY_V)
+      m_factoryEditor->paste();
+    if (key == GLFW_KEY_D)
+      m_factoryEditor->duplicate(1);
+  }
+
+	if (mods & GLFW_MOD_CONTROL && key == GLFW_KEY_P && action == GLFW_PRESS) {
+		m_showSearchPalette = true;
 	}
 }
 
@@ -79,32 +96,235 @@ void  StatorGui::callbackPathDrop(GLFWwindow* window, int count, const char** pa
 		filePath = paths[i];
 		std::string extension = filePath.extension();
 		std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    if (extension != ".json") {
+      std::cerr << "Can't import " << filePath << ": unsupported file type" << std::endl;
+      continue ;
+    }
+    //Every file gets its own thread, the result is applied by updateImports
+    m_imports.push_back(std::make_unique<ImportJob>());
+    m_imports.back()->start(filePath.string(), m_catalog.load());
   }
 }
 
-StatorGui::StatorGui(std::string partsJsonPath, std::string recipesJsonPath) {
+StatorGui::StatorGui(std::string partsJsonPath, std::string recipesJsonPath)
+  : m_partsJsonPath(partsJsonPath), m_recipesJsonPath(recipesJsonPath) {
+  LoadReport          report;
   glfwInit();
-  std::ifstream jsonPartsFile(partsJsonPath);
-  json::value docParts = json::parse(jsonPartsFile);
-  for (auto& part: docParts.as_object()["parts"].as_array()) {
-    partsGlobalArray.push_back(Part(part.as_object()));
+  std::vector<Part>   parts = loadParts(partsJsonPath, report);
+  std::vector<Recipe> recipes = loadRecipes(recipesJsonPath, report);
+  if (!report.empty())
+    std::cerr << "Skipped invalid catalog entries:\n" << report.format();
+  CatalogRef  catalog = Catalog::build(std::move(parts), std::move(recipes));
+  m_catalog.store(catalog);
+  m_searchIndex.build(*catalog);
+  m_recipeGraph.build(*catalog);
+  m_reachAvailable.assign(catalog->parts().size(), 0);
+  m_catalogWatcher.watch({partsJsonPath, recipesJsonPath});
+  IconAtlas::instance().setDirectory(std::filesystem::path(partsJsonPath).parent_path().string());
+  openDocument(std::make_unique<FactoryEditor>(catalog));
+}
+
+//Merge the catalog files back in and refresh only what depends on the
+//entries that changed. A file that fails to parse leaves everything as is.
+void  StatorGui::reloadCatalog() {
+  std::vector<Part>   parts;
+  std::vector<Recipe> recipes;
+  LoadReport          report;
+  try {
+    parts = loadParts(m_partsJsonPath, report);
+    recipes = loadRecipes(m_recipesJsonPath, report);
   }
+  catch (const std::exception& e) {
+    std::cerr << "Catalog reload failed, keeping the current one: " << e.what() << std::endl;
+    return ;
+  }
+  if (!report.empty())
+    std::cerr << "Skipped invalid catalog entries:\n" << report.format();
+  mergeCatalog(std::move(parts), std::move(recipes));
+}
 
-  std::ifstream jsonRecipesFile(recipesJsonPath);
-  json::value docRecipes = json::parse(jsonRecipesFile);
-  for (auto& recipe: docRecipes.as_object()["recipes"].as_array()) {
-    recipesGlobalArray.push_back(Recipe(recipe.as_object()));
+//Merge a complete catalog in, publish the result and refresh only what
+//depends on the entries that changed
+void  StatorGui::mergeCatalog(std::vector<Part> parts, std::vector<Recipe> recipes) {
+  CatalogRef  catalog;
+  CatalogDiff diff = applyCatalog(*m_catalog.load(), std::move(parts), std::move(recipes), catalog);
+  if (diff.empty())
+    return ;
+  m_catalog.store(catalog);
+
+  m_searchIndex.build(*catalog);
+  m_searchResults = m_searchIndex.query(m_searchBuffer);
+  m_searchSelected = 0;
+  if (diff.addedParts.empty() && diff.removedParts.empty() && diff.changedParts.empty()) {
+    std::vector<int>  changed = diff.changedRecipes;
+    changed.insert(changed.end(), diff.addedRecipes.begin(), diff.addedRecipes.end());
+    changed.insert(changed.end(), diff.removedRecipes.begin(), diff.removedRecipes.end());
+    m_recipeGraph.updateRecipes(*catalog, changed);
+  }
+  else
+    m_recipeGraph.build(*catalog);
+  m_reachAvailable.resize(catalog->parts().size(), 0);
+  updateReachable();
+  //Background documents only take note, they are evaluated once focused
+  for (auto& document: m_documents) {
+    document->blueprints().rebuild(*catalog);
+    document->catalogChanged(diff, catalog);
   }
+  if (m_stagedEditor != nullptr) {
+    m_stagedEditor->blueprints().rebuild(*catalog);
+    m_stagedEditor->catalogChanged(diff, catalog);
+  }
+}
 
-  for (auto& recipe: recipesGlobalArray) {
-    for (auto& out: recipe.outputs) {
-      for (auto& part: partsGlobalArray) {
-        if (part.name == out.name) {
-          part.addRecipe(recipe);
-        }
+void  StatorGui::updateImports() {
+  for (int i = 0; i < m_imports.size(); ) {
+    if (!m_imports[i]->done()) {
+      i++;
+      continue ;
+    }
+    ImportResult  result = m_imports[i]->take();
+    m_imports.erase(m_imports.begin() + i);
+    applyImport(result);
+  }
+  if (m_stagedEditor == nullptr && !m_pendingImports.empty()) {
+    ImportResult  result = std::move(m_pendingImports.front());
+    m_pendingImports.erase(m_pendingImports.begin());
+    applyImport(result);
+  }
+  //A few milliseconds of node creation per frame so a big save doesn't freeze the UI
+  if (m_stagedEditor != nullptr && m_stagedEditor->insertPlanStep(m_stagedInsertion, 0.004)) {
+    openDocument(std::move(m_stagedEditor));
+    m_stagedInsertion = PlanInsertion();
+  }
+}
+
+//Entries of the current catalog that are still live. A partial import keeps
+//the other file's side as it is, entries flagged removed must stay removed.
+template<typename Entry>
+static std::vector<Entry>   liveEntries(const std::vector<Entry>& entries) {
+  std::vector<Entry>  live;
+  live.reserve(entries.size());
+  for (auto& entry: entries) {
+    if (!entry.removed)
+      live.push_back(entry);
+  }
+  return (live);
+}
+
+void  StatorGui::applyImport(ImportResult& result) {
+  if (!result.error.empty()) {
+    std::cerr << "Can't import " << result.path << ": " << result.error << std::endl;
+    return ;
+  }
+  if (!result.report.empty()) {
+    std::cerr << "Skipped invalid entries in " << result.path << ":\n" << result.report.format();
+    result.report = LoadReport();
+  }
+  switch (result.kind) {
+    case IK_FACTORY:
+      //Factories are built one at a time, the others wait for their turn
+      if (m_stagedEditor != nullptr) {
+        m_pendingImports.push_back(std::move(result));
+        break;
+      }
+      m_stagedEditor = std::make_unique<FactoryEditor>(m_catalog.load());
+      m_stagedInsertion = PlanInsertion();
+      m_stagedEditor->loadHeader(result.document, result.plan);
+      if (m_stagedEditor->name().empty())
+        m_stagedEditor->setName(std::filesystem::path(result.path).stem().string());
+      m_stagedInsertion.plan = std::move(result.plan);
+      m_stagedInsertion.keepIds = true;
+      break;
+    case IK_FRAGMENT:
+      m_factoryEditor->insertPlan(result.plan);
+      break;
+    case IK_PARTS:
+      m_partsJsonPath = result.path;
+      m_catalogWatcher.watch({m_partsJsonPath, m_recipesJsonPath});
+      IconAtlas::instance().setDirectory(std::filesystem::path(m_partsJsonPath).parent_path().string());
+      mergeCatalog(std::move(result.parts), liveEntries(m_catalog.load()->recipes()));
+      break;
+    case IK_RECIPES:
+      m_recipesJsonPath = result.path;
+      m_catalogWatcher.watch({m_partsJsonPath, m_recipesJsonPath});
+      mergeCatalog(liveEntries(m_catalog.load()->parts()), std::move(result.recipes));
+      break;
+    default:
+      break;
+  }
+}
+
+void  StatorGui::openDocument(std::unique_ptr<FactoryEditor> document) {
+  m_documents.push_back(std::move(document));
+  m_factoryEditor = m_documents.back().get();
+  m_selectDocument = m_factoryEditor;
+}
+
+void  StatorGui::closeDocument(FactoryEditor* document) {
+  for (int i = 0; i < m_documents.size(); i++) {
+    if (m_documents[i].get() != document)
+      continue ;
+    m_documents.erase(m_documents.begin() + i);
+    break;
+  }
+  if (m_documents.empty())
+    openDocument(std::make_unique<FactoryEditor>(m_catalog.load()));
+  else if (m_factoryEditor == document) {
+    m_factoryEditor = m_documents.back().get();
+    m_selectDocument = m_factoryEditor;
+  }
+}
+
+//Only the focused document is drawn, and so updated and evaluated
+void  StatorGui::drawDocuments() {
+  FactoryEditor*  closed = nullptr;
+
+  if (ImGui::BeginTabBar("Documents", ImGuiTabBarFlags_Reorderable)) {
+    for (auto& document: m_documents) {
+      bool        open = true;
+      std::string name = document->name().empty() ? "Untitled" : document->name();
+      int         flags = m_selectDocument == document.get() ? ImGuiTabItemFlags_SetSelected : ImGuiTabItemFlags_None;
+      ImGui::PushID(document.get());
+      if (ImGui::BeginTabItem(name.c_str(), &open, flags)) {
+        m_factoryEditor = document.get();
+        document->draw();
+        ImGui::EndTabItem();
       }
+      ImGui::PopID();
+      if (!open)
+        closed = document.get();
+    }
+    ImGui::EndTabBar();
+  }
+  m_selectDocument = nullptr;
+  if (closed != nullptr)
+    closeDocument(closed);
+}
+
+void  StatorGui::drawImports() {
+  if (m_imports.empty() && m_stagedEditor == nullptr)
+    return ;
+  ImGui::SetNextWindowPos(ImVec2(m_width - 20.f, m_height - 20.f), ImGuiCond_Always, ImVec2(1.f, 1.f));
+  if (ImGui::Begin("Importing", nullptr, ImGuiWindowFlags_AlwaysAutoResize | ImGuiWindowFlags_NoDecoration)) {
+    for (auto& job: m_imports) {
+      ImGui::TextUnformatted(std::filesystem::path(job->path()).filename().c_str());
+      ImGui::ProgressBar(job->progress(), ImVec2(250.f, 0.f));
     }
+    if (m_stagedEditor != nullptr) {
+      ImGui::TextUnformatted("Building factory");
+      ImGui::ProgressBar(m_stagedInsertion.progress(), ImVec2(250.f, 0.f));
+    }
+  }
+  ImGui::End();
+}
+
+void  StatorGui::updateReachable() {
+  std::vector<int>  available;
+  for (int i = 0; i < m_reachAvailable.size(); i++) {
+    if (m_reachAvailable[i])
+      available.push_back(i);
   }
+  m_reachable = m_recipeGraph.reachableFrom(available);
 }
 
 HephResult	StatorGui::create() {
@@ -131,6 +351,8 @@ HephResult	StatorGui::create() {
 	HEPH_CHECK_RESULT(m_commandPool.allocate(m_commandBuffers.size(), m_commandBuffers.data()));
 
 	HEPH_CHECK_RESULT(setupImGui().errorFormat("Failed to setup ImGui! {}"));
+	HEPH_CHECK_RESULT(m_iconUploader.create(m_device, m_hephInstance.getPhysicalDevices()[0], m_commandBuffers.size())
+      .errorFormat("Failed to create icon uploader! {}"));
 
 	return (HephResult());
 }
@@ -152,6 +374,7 @@ void  StatorGui::destroy() {
 
 	vkDeviceWaitIdle(m_device.device);
 	{
+    m_iconUploader.destroy();
     ImGui_ImplVulkan_Shutdown();
     ImGui_ImplGlfw_Shutdown();
     ImGui::DestroyContext();
@@ -176,6 +399,10 @@ void  StatorGui::run() {
 		double now = glfwGetTime();
 		double deltaTime = now - lastUpdateTime;
     glfwPollEvents();
+    if (m_catalogWatcher.poll(now))
+      reloadCatalog();
+    updateImports();
+    IconAtlas::instance().update();
     HEPH_PRINT_RESULT(render());
 		if (deltaTime < m_framerate) {
 			//std::cout << "expect: " <<  m_framerate << "delta: " << deltaTime << std::endl;
@@ -186,6 +413,8 @@ void  StatorGui::run() {
 }
 
 HephResult	StatorGui::renderGui() {
+	MemoryScope	memory(MS_UI);
+
 	ImGui_ImplVulkan_NewFrame();
 	ImGui_ImplGlfw_NewFrame();
 	ImGui::NewFrame();
@@ -196,9 +425,19 @@ HephResult	StatorGui::renderGui() {
 
 	if (ImGui::Begin("NodeEditor", &m_winLayout.showNodeEditor, ImGuiWindowFlags_NoDecoration)) {
 		m_winLayout.main.set();
-    m_factoryEditor.draw();
+    drawDocuments();
   }
 	ImGui::End();
+  drawSearchPalette();
+  drawReachability();
+  drawGenerator();
+  drawBlueprints();
+  drawProfiler();
+  drawMemory();
+  drawImports();
+  drawCompare();
+  drawSimulation();
+  drawSensitivity();
 	return (HephResult());
 }
 
@@ -222,6 +461,7 @@ HephResult	StatorGui::render() {
   renderGui();
 
   vkBeginCommandBuffer(commandBuffer, &beginInfo);
+  m_iconUploader.record(commandBuffer, presentData.imageCurrent, IconAtlas::instance());
   {
     VkClearValue clearValue = (VkClearValue){0.2f, 0.2f, 0.2f, 1.0f};
     VkRenderPassBeginInfo     renderPassInfo = {
@@ -277,16 +517,54 @@ void  StatorGui::drawTopBar() {
   if (m_showTopBar) {
     if (ImGui::BeginMainMenuBar()) {
       if (ImGui::BeginMenu("File")) {
+        if (ImGui::MenuItem("New"))
+          openDocument(std::make_unique<FactoryEditor>(m_catalog.load()));
         if (ImGui::MenuItem("Open...")) {
         }
+        if (ImGui::MenuItem("Close"))
+          closeDocument(m_factoryEditor);
         ImGui::EndMenu();
       }
       if (ImGui::BeginMenu("Edit")) {
+        if (ImGui::MenuItem("Copy", "Ctrl+C"))
+          m_factoryEditor->copy();
+        if (ImGui::MenuItem("Cut", "Ctrl+X"))
+          m_factoryEditor->cut();
+        if (ImGui::MenuItem("Paste", "Ctrl+V"))
+          m_factoryEditor->paste();
+        if (ImGui::MenuItem("Duplicate", "Ctrl+D"))
+          m_factoryEditor->duplicate(1);
+        ImGui::SetNextItemWidth(80.f);
+        ImGui::InputInt("##Copies", &m_duplicateCopies);
+        ImGui::SameLine();
+        if (ImGui::MenuItem("Duplicate N times"))
+          m_factoryEditor->duplicate(m_duplicateCopies);
+        ImGui::Separator();
+        if (ImGui::MenuItem("Make blueprint from selection"))
+          m_factoryEditor->makeBlueprint("Blueprint " + std::to_string(m_factoryEditor->blueprints().entries().size() + 1));
+        ImGui::Separator();
         if (ImGui::MenuItem("Prefences")) {
         }
         ImGui::EndMenu();
       }
       if (ImGui::BeginMenu("Tools")) {
+        if (ImGui::MenuItem("Search...", "Ctrl+P"))
+          m_showSearchPalette = true;
+        ImGui::MenuItem("Reachability", nullptr, &m_showReachability);
+        ImGui::MenuItem("Generate factory", nullptr, &m_showGenerator);
+        ImGui::MenuItem("Blueprints", nullptr, &m_showBlueprints);
+        ImGui::MenuItem("Profiler", nullptr, &m_showProfiler);
+        ImGui::MenuItem("Memory", nullptr, &m_showMemory);
+        ImGui::MenuItem("Compare documents", nullptr, &m_showCompare);
+        ImGui::MenuItem("Simulation", nullptr, &m_showSimulation);
+        ImGui::MenuItem("Sensitivity", nullptr, &m_showSensitivity);
+        if (ImGui::MenuItem("Reload catalog", "F5"))
+          reloadCatalog();
+        ImGui::Separator();
+        if (ImGui::MenuItem("Auto layout"))
+          m_factoryEditor->autoLayout();
+        if (ImGui::MenuItem("Auto layout in background"))
+          m_factoryEditor->startAutoLayout();
         ImGui::EndMenu();
       }
       if (ImGui::BeginMenu("Help")) {
@@ -310,23 +588,33 @@ void  StatorGui::drawPartSelector() {
     ImGui::SetNextWindowPos(ImVec2(0, m_windowInfoTopBar.size.y));
     ImGui::SetNextWindowSize(ImVec2(0, m_height - m_windowInfoTopBar.size.y));
     if (ImGui::Begin("File selector", &m_showPartSelectorPanel, ImGuiWindowFlags_NoDecoration)) {
-      for (auto& part : partsGlobalArray) {
-        if (ImGui::BeginMenu(part.name.c_str())) {
-          if (ImGui::Selectable(part.name.c_str()))
-            m_factoryEditor.placeNodeAt<PartNode>({300, 100}, part);
-          int i = 1;
-          for (auto& recipe: part.recipes) {
-            std::string name = "recipe " + std::to_string(i);
-            if (ImGui::BeginMenu(name.c_str())) {
-              recipe->drawPopUp();
-              if (ImGui::Selectable("ADD")) {
-                m_factoryEditor.placeNodeAt<RecipeNode>({300, 100}, *recipe);
+      CatalogRef        catalog = m_catalog.load();
+      ImGuiListClipper  clipper;
+      clipper.Begin(catalog->parts().size());
+      while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+          auto& part = catalog->parts()[row];
+          IconAtlas::instance().draw(part.imgPath, part.name, ImGui::GetTextLineHeight());
+          ImGui::SameLine();
+          if (ImGui::BeginMenu(part.name.c_str())) {
+            if (ImGui::Selectable(part.name.c_str()))
+              m_factoryEditor->placeNodeAt<PartNode>({300, 100}, PartHandle(catalog, row));
+            if (part.energy > 0.0 && ImGui::Selectable("Generator"))
+              m_factoryEditor->placeNodeAt<GeneratorNode>({300, 100}, PartHandle(catalog, row));
+            int i = 1;
+            for (int recipe: part.recipes) {
+              std::string name = "recipe " + std::to_string(i);
+              if (ImGui::BeginMenu(name.c_str())) {
+                catalog->recipes()[recipe].drawPopUp();
+                if (ImGui::Selectable("ADD")) {
+                  m_factoryEditor->placeNodeAt<RecipeNode>({300, 100}, RecipeHandle(catalog, recipe));
+                }
+                ImGui::EndMenu();
               }
-              ImGui::EndMenu();
+              i++;
             }
-            i++;
+            ImGui::EndMenu();
           }
-          ImGui::EndMenu();
         }
       }
       m_windowInfoPartSelectorPanel.getInfo();
@@ -334,3 +622,446 @@ void  StatorGui::drawPartSelector() {
     }
   }
 }
+
+void  StatorGui::placeSearchResult(const SearchResult& result) {
+  if (result.kind == SEK_PART)
+    m_factoryEditor->placeNodeAt<PartNode>({300, 100}, PartHandle(m_catalog.load(), *result.part));
+  else
+    m_factoryEditor->placeNodeAt<RecipeNode>({300, 100}, RecipeHandle(m_catalog.load(), *result.recipe));
+}
+
+void  StatorGui::drawSearchPalette() {
+  if (!m_showSearchPalette)
+    return ;
+  ImGuiIO& io = ImGui::GetIO();
+  ImGui::SetNextWindowPos(ImVec2(io.DisplaySize.x * 0.5f, io.DisplaySize.y * 0.2f), ImGuiCond_Appearing, ImVec2(0.5f, 0.0f));
+  ImGui::SetNextWindowSize(ImVec2(600, 400), ImGuiCond_Appearing);
+  if (ImGui::Begin("Search", &m_showSearchPalette)) {
+    if (ImGui::IsWindowAppearing())
+      ImGui::SetKeyboardFocusHere();
+    ImGui::SetNextItemWidth(-1.f);
+    if (ImGui::InputTextWithHint("##search", "part, recipe, produces X, consumes X", m_searchBuffer, sizeof(m_searchBuffer))) {
+      m_searchResults = m_searchIndex.query(m_searchBuffer);
+      m_searchSelected = 0;
+    }
+    if (ImGui::IsKeyPressed(ImGuiKey_DownArrow) && m_searchSelected + 1 < m_searchResults.size())
+      m_searchSelected++;
+    if (ImGui::IsKeyPressed(ImGuiKey_UpArrow) && m_searchSelected > 0)
+      m_searchSelected--;
+    if (ImGui::IsKeyPressed(ImGuiKey_Escape))
+      m_showSearchPalette = false;
+    if (ImGui::IsKeyPressed(ImGuiKey_Enter) && m_searchSelected < m_searchResults.size()) {
+      placeSearchResult(m_searchResults[m_searchSelected]);
+      m_showSearchPalette = false;
+    }
+
+    if (ImGui::BeginChild("##results")) {
+      ImGuiListClipper  clipper;
+      clipper.Begin(m_searchResults.size());
+      while (clipper.Step()) {
+        for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+          auto& result = m_searchResults[row];
+          ImGui::PushID(row);
+          std::string label = (result.kind == SEK_PART ? "[part] " : "[recipe] ") + m_searchIndex.label(result);
+          if (ImGui::Selectable(label.c_str(), row == m_searchSelected)) {
+            placeSearchResult(result);
+            m_showSearchPalette = false;
+          }
+          if (result.kind == SEK_RECIPE && ImGui::IsItemHovered()) {
+            ImGui::BeginTooltip();
+            result.recipe->drawPopUp();
+            ImGui::EndTooltip();
+          }
+          ImGui::PopID();
+        }
+      }
+    }
+    ImGui::EndChild();
+  }
+  ImGui::End();
+}
+
+void  StatorGui::drawReachability() {
+  if (!m_showReachability)
+    return ;
+  ImGui::SetNextWindowSize(ImVec2(700, 500), ImGuiCond_FirstUseEver);
+  if (ImGui::Begin("Reachability", &m_showReachability)) {
+    CatalogRef  catalog = m_catalog.load();
+    auto&       parts = catalog->parts();
+    bool        changed = ImGui::IsWindowAppearing();
+    if (ImGui::BeginTable("##reach", 3, ImGuiTableFlags_Borders)) {
+      ImGui::TableSetupColumn("Available");
+      ImGui::TableSetupColumn("Can build");
+      ImGui::TableSetupColumn("Raw cost");
+      ImGui::TableHeadersRow();
+      ImGui::TableNextRow();
+
+      ImGui::TableNextColumn();
+      if (ImGui::BeginChild("##available", ImVec2(0, 400))) {
+        for (int i = 0; i < parts.size(); i++) {
+          bool  available = m_reachAvailable[i];
+          ImGui::PushID(i);
+          if (ImGui::Checkbox(parts[i].name.c_str(), &available)) {
+            m_reachAvailable[i] = available;
+            changed = true;
+          }
+          ImGui::PopID();
+        }
+      }
+      ImGui::EndChild();
+      if (changed)
+        updateReachable();
+
+      ImGui::TableNextColumn();
+      if (ImGui::BeginChild("##reachable", ImVec2(0, 400))) {
+        for (int i = 0; i < m_reachable.parts.size(); i++) {
+          if (m_reachable.parts[i] && !m_reachAvailable[i]) {
+            if (ImGui::Selectable(parts[i].name.c_str(), m_reachTarget == i))
+              m_reachTarget = i;
+          }
+        }
+      }
+      ImGui::EndChild();
+
+      ImGui::TableNextColumn();
+      if (m_reachTarget >= 0) {
+        ImGui::Text("%s", parts[m_reachTarget].name.c_str());
+        ImGui::Text("Depth: %d", m_recipeGraph.depth(m_reachTarget));
+        ImGui::Separator();
+        for (auto& cost: m_recipeGraph.rawCost(m_reachTarget))
+          ImGui::Text("%s: %lf", parts[cost.first].name.c_str(), cost.second);
+      }
+      ImGui::EndTable();
+    }
+  }
+  ImGui::End();
+}
+
+void  StatorGui::drawGenerator() {
+  if (!m_showGenerator)
+    return ;
+  ImGui::SetNextWindowSize(ImVec2(500, 400), ImGuiCond_FirstUseEver);
+  if (ImGui::Begin("Generate factory", &m_showGenerator)) {
+    CatalogRef  catalog = m_catalog.load();
+    auto&       parts = catalog->parts();
+    const char* targetName = m_generatorTarget >= 0 ? parts[m_generatorTarget].name.c_str() : "";
+    if (ImGui::BeginCombo("Target", targetName)) {
+      for (int i = 0; i < parts.size(); i++) {
+        if (m_recipeGraph.isRaw(i))
+          continue ;
+        if (ImGui::Selectable(parts[i].name.c_str(), i == m_generatorTarget)) {
+          m_generatorTarget = i;
+          m_generatorAlternates.clear();
+        }
+      }
+      ImGui::EndCombo();
+    }
+    ImGui::InputDouble("Rate /min", &m_generatorRate);
+
+    if (m_generatorTarget >= 0) {
+      ImGui::Separator();
+      ImGui::Text("Alternates:");
+      auto required = m_recipeGraph.requiredFor(m_generatorTarget);
+      for (int part = 0; part < required.parts.size(); part++) {
+        auto& producers = m_recipeGraph.producers(part);
+        if (!required.parts[part] || producers.size() < 2)
+          continue ;
+        auto  it = m_generatorAlternates.find(part);
+        int   current = it != m_generatorAlternates.end() ? it->second : m_recipeGraph.defaultRecipe(part);
+        std::string preview = "recipe " + std::to_string(current);
+        ImGui::PushID(part);
+        if (ImGui::BeginCombo(parts[part].name.c_str(), preview.c_str())) {
+          for (auto& producer: producers) {
+            std::string name = "recipe " + std::to_string(producer.node);
+            if (ImGui::Selectable(name.c_str(), producer.node == current))
+              m_generatorAlternates[part] = producer.node;
+            if (ImGui::IsItemHovered()) {
+              ImGui::BeginTooltip();
+              catalog->recipes()[producer.node].drawPopUp();
+              ImGui::EndTooltip();
+            }
+          }
+          ImGui::EndCombo();
+        }
+        ImGui::PopID();
+      }
+      ImGui::Separator();
+      if (ImGui::Button("Generate")) {
+        FactoryPlan plan = generateFactory(m_recipeGraph, m_generatorTarget, m_generatorRate, m_generatorAlternates);
+        LayoutOptions options;
+        options.origin = ImVec2(300, 100);
+        layoutPlan(plan, options);
+        m_factoryEditor->insertPlan(plan);
+      }
+    }
+  }
+  ImGui::End();
+}
+
+static std::string  documentName(FactoryEditor* document) {
+  return (document->name().empty() ? "Untitled" : document->name());
+}
+
+void  StatorGui::drawCompare() {
+  if (!m_showCompare)
+    return ;
+  if (ImGui::Begin("Compare", &m_showCompare)) {
+    FactoryEditor** sides[2] = {&m_compareBefore, &m_compareAfter};
+    const char*     labels[2] = {"Before", "After"};
+    for (int side = 0; side < 2; side++) {
+      FactoryEditor*& document = *sides[side];
+      bool            open = false;
+      for (auto& entry: m_documents)
+        open |= entry.get() == document;
+      if (!open)
+        document = nullptr;
+      if (ImGui::BeginCombo(labels[side], document != nullptr ? documentName(document).c_str() : "")) {
+        for (auto& entry: m_documents) {
+          ImGui::PushID(entry.get());
+          if (ImGui::Selectable(documentName(entry.get()).c_str(), entry.get() == document))
+            document = entry.get();
+          ImGui::PopID();
+        }
+        ImGui::EndCombo();
+      }
+    }
+    if (m_compareBefore != nullptr && m_compareAfter != nullptr && ImGui::Button("Compare")) {
+      FactorySnapshot before;
+      FactorySnapshot after;
+      m_diffError.clear();
+      try {
+        CatalogRef  catalog = m_catalog.load();
+        loadSnapshot(before, m_compareBefore->toJson(), *catalog);
+        loadSnapshot(after, m_compareAfter->toJson(), *catalog);
+        m_diff = diffFactories(before, after, *catalog);
+        m_hasDiff = true;
+      }
+      catch (const std::exception& e) {
+        m_diffError = e.what();
+        m_hasDiff = false;
+      }
+    }
+    if (!m_diffError.empty())
+      ImGui::TextColored(ImVec4(0.9, 0.2, 0.2, 1.0), "%s", m_diffError.c_str());
+    if (m_hasDiff) {
+      ImGui::Text("Matched: %d by id, %d by structure", m_diff.matchedById, m_diff.matchedByStructure);
+      ImGui::Text("Links: +%d -%d", m_diff.linksAdded, m_diff.linksRemoved);
+      ImGui::Text("Power: %.1f -> %.1f MW", m_diff.powerBefore, m_diff.powerAfter);
+      if (ImGui::BeginTable("##outputs", 4, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg)) {
+        ImGui::TableSetupColumn("Output");
+        ImGui::TableSetupColumn("Before");
+        ImGui::TableSetupColumn("After");
+        ImGui::TableSetupColumn("Delta");
+        ImGui::TableHeadersRow();
+        for (auto& output: m_diff.outputs) {
+          double  delta = output.rateAfter - output.rateBefore;
+          ImGui::TableNextRow();
+          ImGui::TableNextColumn();
+          ImGui::TextUnformatted(output.label.c_str());
+          ImGui::TableNextColumn();
+          ImGui::Text("%.3f", output.rateBefore);
+          ImGui::TableNextColumn();
+          ImGui::Text("%.3f", output.rateAfter);
+          ImGui::TableNextColumn();
+          ImVec4  color = delta < 0.0 ? ImVec4(0.9, 0.2, 0.2, 1.0) : delta > 0.0 ? ImVec4(0.2, 0.9, 0.2, 1.0) : ImVec4(0.7, 0.7, 0.7, 1.0);
+          ImGui::TextColored(color, "%+.3f", delta);
+        }
+        ImGui::EndTable();
+      }
+      if (ImGui::BeginChild("##nodes", ImVec2(0, 300))) {
+        ImGuiListClipper  clipper;
+        clipper.Begin(m_diff.nodes.size());
+        while (clipper.Step()) {
+          for (int row = clipper.DisplayStart; row < clipper.DisplayEnd; row++) {
+            auto&       node = m_diff.nodes[row];
+            std::string fields;
+            for (auto& field: node.fields)
+              fields += " " + field;
+            if (node.before < 0)
+              ImGui::TextColored(ImVec4(0.2, 0.9, 0.2, 1.0), "+ %s", node.label.c_str());
+            else if (node.after < 0)
+              ImGui::TextColored(ImVec4(0.9, 0.2, 0.2, 1.0), "- %s", node.label.c_str());
+            else
+              ImGui::Text("~ %s:%s", node.label.c_str(), fields.c_str());
+          }
+        }
+      }
+      ImGui::EndChild();
+    }
+  }
+  ImGui::End();
+}
+
+void  StatorGui::drawProfiler() {
+  if (!m_showProfiler)
+    return ;
+  if (ImGui::Begin("Profiler", &m_showProfiler))
+    Profiler::instance().draw();
+  ImGui::End();
+}
+
+void  StatorGui::drawMemory() {
+  if (!m_showMemory)
+    return ;
+  if (ImGui::Begin("Memory", &m_showMemory)) {
+    MemoryTracker::draw();
+    if (MemoryTracker::enabled()) {
+      ImGui::InputText("##json", m_memoryJson, sizeof(m_memoryJson));
+      ImGui::SameLine();
+      if (ImGui::Button("Dump JSON") && !MemoryTracker::writeJson(m_memoryJson))
+        std::cerr << "Can't write " << m_memoryJson << std::endl;
+    }
+  }
+  ImGui::End();
+}
+
+void  StatorGui::drawBlueprints() {
+  if (!m_showBlueprints)
+    return ;
+  if (ImGui::Begin("Blueprints", &m_showBlueprints)) {
+    for (auto& blueprint: m_factoryEditor->blueprints().entries()) {
+      ImGui::PushID(blueprint.get());
+      if (ImGui::Button("Place"))
+        m_factoryEditor->placeNode<BlueprintNode>(blueprint);
+      ImGui::SameLine();
+      ImGui::Text("%s (%s) x%d, %.1f MW", blueprint->name.c_str(), blueprint->hashString().c_str()
+          , blueprint->instances, blueprint->power);
+      for (int i = 0; i < blueprint->outputNames.size(); i++)
+        ImGui::BulletText("%s: %lf", blueprint->outputNames[i].c_str(), blueprint->outputRates[i]);
+      ImGui::PopID();
+    }
+  }
+  ImGui::End();
+}
+
+void  StatorGui::drawSimulation() {
+  if (!m_showSimulation)
+    return ;
+  ImGui::SetNextWindowSize(ImVec2(600, 500), ImGuiCond_FirstUseEver);
+  if (ImGui::Begin("Simulation", &m_showSimulation)) {
+    ImGui::InputDouble("Duration (h)", &m_simulationHours, 0.5, 1.0, "%.2f");
+    ImGui::InputDouble("Tick (s)", &m_simulationOptions.tick, 0.05, 0.5, "%.3f");
+    ImGui::InputDouble("Sample every (s)", &m_simulationOptions.sampleInterval, 10.0, 60.0, "%.0f");
+    ImGui::InputDouble("Link buffer", &m_simulationOptions.linkBuffer, 10.0, 100.0, "%.0f");
+    ImGui::InputDouble("Default cycle (s)", &m_simulationOptions.cycleTime, 0.5, 1.0, "%.2f");
+    ImGui::InputDouble("Tolerance", &m_simulationOptions.tolerance, 0.01, 0.05, "%.2f");
+    if (m_factoryEditor != nullptr && ImGui::Button("Run")) {
+      auto  start = std::chrono::steady_clock::now();
+      m_simulation.reset(m_factoryEditor->flow(), m_simulationOptions);
+      m_simulation.run(std::max(m_simulationHours, 0.0) * 3600.0);
+      m_simulationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+    if (m_simulationMs >= 0.0) {
+      double  settle = m_simulation.settleTime();
+      ImGui::SameLine();
+      ImGui::Text("%.0f s simulated in %.1f ms", m_simulation.time(), m_simulationMs);
+      if (settle < 0.0)
+        ImGui::TextColored(ImVec4(0.9, 0.2, 0.2, 1.0), "Steady state not reached");
+      else
+        ImGui::Text("Steady state after %.0f s", settle);
+      ImGui::InputText("##csv", m_simulationCsv, sizeof(m_simulationCsv));
+      ImGui::SameLine();
+      if (ImGui::Button("Export CSV")) {
+        std::ofstream file(m_simulationCsv);
+        if (file)
+          m_simulation.writeCsv(file);
+        else
+          std::cerr << "Can't write " << m_simulationCsv << std::endl;
+      }
+      ImGui::Separator();
+      if (ImGui::BeginChild("##nodes")) {
+        for (auto& stats: m_simulation.stats()) {
+          ImGui::PushID(&stats);
+          ImGui::TextUnformatted(stats.label.c_str());
+          ImGui::Text("steady %.3f, measured %.3f", stats.steadyRate, stats.rate);
+          if (stats.settledAt >= 0.0) {
+            ImGui::SameLine();
+            ImGui::Text(", settled at %.0f s", stats.settledAt);
+          }
+          if (stats.filledAt >= 0.0)
+            ImGui::TextColored(ImVec4(0.9, 0.6, 0.2, 1.0), "Full at %.0f s", stats.filledAt);
+          if (stats.emptiedAt >= 0.0)
+            ImGui::TextColored(ImVec4(0.9, 0.2, 0.2, 1.0), "Ran dry at %.0f s", stats.emptiedAt);
+          if (!stats.samples.empty())
+            ImGui::PlotLines("##samples", stats.samples.data(), stats.samples.size(), 0, nullptr, 0.0f, FLT_MAX, ImVec2(0, 40));
+          ImGui::PopID();
+        }
+      }
+      ImGui::EndChild();
+    }
+  }
+  ImGui::End();
+}
+
+void  StatorGui::drawSensitivity() {
+  if (!m_showSensitivity)
+    return ;
+  ImGui::SetNextWindowSize(ImVec2(700, 500), ImGuiCond_FirstUseEver);
+  if (ImGui::Begin("Sensitivity", &m_showSensitivity)) {
+    if (m_factoryEditor != nullptr && ImGui::Button("Compute")) {
+      auto                start = std::chrono::steady_clock::now();
+      std::ostringstream  branches;
+      m_sensitivity.compute(m_factoryEditor->flow());
+      m_sensitivityMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+      m_sensitivity.writeBranches(branches, m_factoryEditor->flow());
+      m_sensitivityBranches = branches.str();
+      m_sensitivityScale.assign(m_sensitivity.outputs().size(), 0.0);
+      for (int row = 0; row < m_sensitivityScale.size(); row++) {
+        for (auto entry = m_sensitivity.rowBegin(row); entry != m_sensitivity.rowEnd(row); entry++)
+          m_sensitivityScale[row] = std::max(m_sensitivityScale[row], std::fabs(entry->value));
+      }
+    }
+    if (m_sensitivityMs >= 0.0) {
+      int rows = m_sensitivity.outputs().size();
+      int columns = m_sensitivity.params().size();
+      ImGui::SameLine();
+      ImGui::Text("%d outputs x %d parameters in %.1f ms (%zu non zero)", rows, columns, m_sensitivityMs
+          , m_sensitivity.nonZeros());
+      ImGui::InputText("##csv", m_sensitivityCsv, sizeof(m_sensitivityCsv));
+      ImGui::SameLine();
+      if (ImGui::Button("Export CSV")) {
+        std::ofstream file(m_sensitivityCsv);
+        if (file)
+          m_sensitivity.writeCsv(file);
+        else
+          std::cerr << "Can't write " << m_sensitivityCsv << std::endl;
+      }
+      if (!m_sensitivityBranches.empty() && ImGui::CollapsingHeader("Active branches"))
+        ImGui::TextUnformatted(m_sensitivityBranches.c_str());
+      ImGui::TextUnformatted("Rows are outputs scaled to their largest entry, red raises the output, blue lowers it");
+
+      //Only the cells in view are drawn, the dummy gives the child its scroll range
+      const float cell = 12.0f;
+      if (ImGui::BeginChild("##heatmap", ImVec2(0, 0), true, ImGuiWindowFlags_HorizontalScrollbar)) {
+        ImDrawList* drawList = ImGui::GetWindowDrawList();
+        ImVec2      origin = ImGui::GetCursorScreenPos();
+        ImVec2      view = ImGui::GetWindowSize();
+        int         firstColumn = std::max(0, (int)(ImGui::GetScrollX() / cell));
+        int         firstRow = std::max(0, (int)(ImGui::GetScrollY() / cell));
+        int         lastColumn = std::min(columns, firstColumn + (int)(view.x / cell) + 2);
+        int         lastRow = std::min(rows, firstRow + (int)(view.y / cell) + 2);
+        ImGui::Dummy(ImVec2(columns * cell, rows * cell));
+        for (int row = firstRow; row < lastRow; row++) {
+          for (int column = firstColumn; column < lastColumn; column++) {
+            double  scale = m_sensitivityScale[row];
+            double  value = scale > 0.0 ? m_sensitivity.at(row, column) / scale : 0.0;
+            int     shade = 40 + (int)(215.0 * std::fabs(value));
+            ImU32   color = value > 0.0 ? IM_COL32(shade, 40, 40, 255) : value < 0.0 ? IM_COL32(40, 40, shade, 255) : IM_COL32(40, 40, 40, 255);
+            ImVec2  min(origin.x + column * cell, origin.y + row * cell);
+            drawList->AddRectFilled(min, ImVec2(min.x + cell - 1.0f, min.y + cell - 1.0f), color);
+          }
+        }
+        if (ImGui::IsItemHovered()) {
+          ImVec2  mouse = ImGui::GetMousePos();
+          int     column = (mouse.x - origin.x) / cell;
+          int     row = (mouse.y - origin.y) / cell;
+          if (row >= 0 && row < rows && column >= 0 && column < columns)
+            ImGui::SetTooltip("%s\nper unit of %s\n%g", m_sensitivity.outputLabels()[row].c_str()
+                , m_sensitivity.paramLabels()[column].c_str(), m_sensitivity.at(row, column));
+        }
+      }
+      ImGui::EndChild();
+    }
+  }
+  ImGui::End();
+}
@@ -9,6 +9,7 @@
 
 #include "ImNodeFlow.h"
 #include "guiInfo.hpp"
+#include "iconUploader.hpp"
 #include "imgui_impl_glfw.h"
 #include "imgui_impl_vulkan.h"
 #include <glm/glm.hpp>
@@ -18,6 +19,14 @@
 
 #include "stator/statorNode.hpp"
 #include "stator/factory.hpp"
+#include "stator/searchIndex.hpp"
+#include "stator/recipeGraph.hpp"
+#include "stator/catalogLoader.hpp"
+#include "stator/importJob.hpp"
+#include "stator/factoryDiff.hpp"
+#include "stator/simulation.hpp"
+#include "stator/sensitivity.hpp"
+#include "stator/memoryTracker.hpp"
 
 #define	FRAMERATE	(1.0 / 60.0)
 
@@ -63,6 +72,25 @@ class	  StatorGui {
 		
     void					drawTopBar();
     void          drawPartSelector();
+    void          drawSearchPalette();
+    void          placeSearchResult(const SearchResult& result);
+    void          drawReachability();
+    void          drawGenerator();
+    void          drawBlueprints();
+    void          drawProfiler();
+    void          drawMemory();
+    void          reloadCatalog();
+    void          mergeCatalog(std::vector<Part> parts, std::vector<Recipe> recipes);
+    void          updateImports();
+    void          applyImport(ImportResult& result);
+    void          drawImports();
+    void          openDocument(std::unique_ptr<FactoryEditor> document);
+    void          closeDocument(FactoryEditor* document);
+    void          drawDocuments();
+    void          drawCompare();
+    void          drawSimulation();
+    void          drawSensitivity();
+    void          updateReachable();
 
 		GLFWwindow*		m_mainWindow;
     int						m_width, m_height;
@@ -77,6 +105,40 @@ class	  StatorGui {
 		bool					m_showPartSelectorPanel = true;
 		GuiWindowInfo	m_windowInfoPartSelectorPanel;
 
+    bool                      m_showSearchPalette = false;
+    char                      m_searchBuffer[256] = "";
+    int                       m_searchSelected = 0;
+    SearchIndex               m_searchIndex;
+    std::vector<SearchResult> m_searchResults;
+
+    bool                      m_showReachability = false;
+    RecipeGraph               m_recipeGraph;
+    std::vector<char>         m_reachAvailable;
+    RecipeGraph::Reachability m_reachable;
+    int                       m_reachTarget = -1;
+
+    bool                      m_showGenerator = false;
+    int                       m_generatorTarget = -1;
+    double                    m_generatorRate = 60.0;
+    std::unordered_map<int, int>  m_generatorAlternates;
+
+    bool                      m_showBlueprints = false;
+    bool                      m_showProfiler = false;
+    bool                      m_showMemory = false;
+    char                      m_memoryJson[256] = "memory.json";
+    int                       m_duplicateCopies = 10;
+
+    std::string               m_partsJsonPath;
+    std::string               m_recipesJsonPath;
+    CatalogSlot               m_catalog;
+    CatalogWatcher            m_catalogWatcher;
+
+    std::vector<std::unique_ptr<ImportJob>> m_imports;
+    //Factory being built from an import, swapped in once complete
+    std::unique_ptr<FactoryEditor>          m_stagedEditor;
+    PlanInsertion                           m_stagedInsertion;
+    std::vector<ImportResult>               m_pendingImports;
+
     StatorGuiWindowLayout         m_winLayout;
 
     //Vulkan Stuff
@@ -90,8 +152,32 @@ class	  StatorGui {
     uint32_t                      m_imageCurrent = 0;
     std::vector<VkFence>          m_fences;
     std::vector<VkCommandBuffer>  m_commandBuffers;
+    IconUploader                  m_iconUploader;
 
     //GUI
     VkDescriptorPool      				m_imGuiDescPool = VK_NULL_HANDLE;
-    FactoryEditor                 m_factoryEditor;
+    //Open factories sharing the catalog, each with its own flow graph
+    std::vector<std::unique_ptr<FactoryEditor>> m_documents;
+    FactoryEditor*                              m_factoryEditor = nullptr;  //Focused document
+    FactoryEditor*                              m_selectDocument = nullptr; //Focused by the next tab bar
+
+    bool                      m_showCompare = false;
+    FactoryEditor*            m_compareBefore = nullptr;
+    FactoryEditor*            m_compareAfter = nullptr;
+    FactoryDiff               m_diff;
+    bool                      m_hasDiff = false;
+    std::string               m_diffError;
+
+    bool                      m_showSimulation = false;
+    Simulation                m_simulation;
+    SimulationOptions         m_simulationOptions;
+    double                    m_simulationHours = 1.0;
+    double                    m_simulationMs = -1.0;  //Wall time of the last run, -1 before the first
+    char                      m_simulationCsv[256] = "simulation.csv";
+    bool                      m_showSensitivity = false;
+    Sensitivity               m_sensitivity;
+    std::vector<double>       m_sensitivityScale;     //Largest magnitude of every output row
+    std::string               m_sensitivityBranches;
+    double                    m_sensitivityMs = -1.0;
+    char                      m_sensitivityCsv[256] = "sensitivity.csv";
 };
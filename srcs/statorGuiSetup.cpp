@@ -110,18 +110,22 @@ HephResult	StatorGui::setupImGui() {
 
   std::vector<VkDescriptorPoolSize> poolSizes =
   {
-    { VK_DESCRIPTOR_TYPE_SAMPLER, 1},
-    { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1},
+    { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1 + IconUploader::maxPages},
   };
   VkDescriptorPoolCreateInfo        poolInfo{
 		.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO,
 		.flags = VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT,
 	};
-  poolInfo.maxSets       = poolSizes.size();
+  //One set for the font and one per icon page
+  poolInfo.maxSets       = 1 + IconUploader::maxPages;
   poolInfo.poolSizeCount = poolSizes.size();
   poolInfo.pPoolSizes    = poolSizes.data();
   vkCreateDescriptorPool(m_device.device, &poolInfo, nullptr, &m_imGuiDescPool);
 
+#ifdef STATOR_MEMORY_TRACKING
+  ImGui::SetAllocatorFunctions([](size_t size, void*) {return (MemoryTracker::allocate(size, MS_UI));}
+      , [](void* block, void*) {MemoryTracker::release(block);});
+#endif
   ImGui::CreateContext();
   ImGui_ImplGlfw_InitForVulkan(m_mainWindow, true);
   ImGuiIO& io = ImGui::GetIO(); (void)io;
@@ -143,7 +147,6 @@ HephResult	StatorGui::setupImGui() {
   };
   ImGui_ImplVulkan_Init(&init_info);
   ImGui_ImplVulkan_CreateFontsTexture();
-  ImGui_ImplVulkan_DestroyFontsTexture();
   ImGui_ImplVulkan_SetMinImageCount(m_swapchain.getImageCount());
 	return (HephResult());
 }
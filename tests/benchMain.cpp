@@ -0,0 +1,19 @@
+#include "harness.hpp"
+#include "stator/memoryTracker.hpp"
+#include <cstdlib>
+#include <iostream>
+
+//statorBench [name...]
+//With STATOR_MEMORY_TRACKING, STATOR_MEMORY_REPORT=path writes the memory
+//counters there as JSON once the cases ran, with the heap peak of each case
+//among the watermarks
+int main(int ac, char** av) {
+  int         status = runCases(ac, av);
+  const char* path = getenv("STATOR_MEMORY_REPORT");
+
+  if (MemoryTracker::enabled() && path != nullptr && !MemoryTracker::writeJson(path)) {
+    std::cerr << "Can't write " << path << std::endl;
+    return (1);
+  }
+  return (status);
+}
@@ -0,0 +1,70 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include "stator/blueprint.hpp"
+
+//An InputNode, recipes in chain order, an OutputNode, linked one after the
+//other. slots gives each node's place in the fragment: ins first, the
+//recipes, then the out. Ids and positions come from firstId.
+static json::value  chainFragment(const std::vector<int>& recipes, const std::vector<int>& slots, uint64_t firstId) {
+  std::vector<json::object> chain;
+  chain.push_back({{"type", "SNT_IN_NODE"}, {"value", 60}});
+  for (int recipe: recipes)
+    chain.push_back({{"type", "SNT_RECIPE_NODE"}, {"recipeId", recipe}});
+  chain.push_back({{"type", "SNT_OUT_NODE"}});
+
+  json::array nodes;
+  json::array links;
+  nodes.resize(chain.size());
+  for (int i = 0; i < chain.size(); i++) {
+    chain[i]["id"] = firstId + i;
+    chain[i]["pos"] = {{"x", firstId * 10.0 + i * 200}, {"y", firstId * 5.0}};
+    nodes[slots[i]] = chain[i];
+    if (i > 0)
+      links.push_back({slots[i - 1], 0, slots[i], 0});
+  }
+  return (json::object{{"nodes", nodes}, {"links", links}});
+}
+
+//Fragments only differing by node order, ids and positions share one entry,
+//the same nodes linked in another order don't
+STATOR_CASE(blueprintDedupe) {
+  CatalogRef        catalog = cycleCatalog();
+  BlueprintLibrary  library;
+
+  auto  line = library.add(chainFragment({0, 1}, {0, 1, 2, 3}, 1), "line", *catalog);
+  auto  shuffled = library.add(chainFragment({0, 1}, {2, 0, 3, 1}, 40), "shuffled", *catalog);
+  auto  swapped = library.add(chainFragment({1, 0}, {0, 1, 2, 3}, 1), "swapped", *catalog);
+  CHECK(shuffled == line);
+  CHECK(swapped != line);
+  CHECK(library.entries().size() == 2);
+  CHECK(library.find(line->hashString()) == line);
+  CHECK(library.find(swapped->hashString()) == swapped);
+  CHECK(library.find("not a hash") == nullptr);
+}
+
+//Blueprint nodes resolve through the hash their save used, those naming no
+//known blueprint are dropped and reported
+STATOR_CASE(blueprintResolve) {
+  CatalogRef        catalog = cycleCatalog();
+  BlueprintLibrary  library;
+  json::object      save = {{"blueprints", {
+    {{"hash", "stale"}, {"name", "line"}, {"definition", chainFragment({0, 1}, {0, 1, 2, 3}, 1)}},
+  }}};
+  FactoryPlan       plan;
+  plan.nodes.resize(4);
+  plan.nodes[0].data = json::object{{"blueprint", "stale"}, {"scale", 2}};
+  plan.nodes[1].data = json::object{{"scale", 2}};
+  plan.nodes[2].data = json::object{{"blueprint", "0123456789abcdef"}, {"scale", 2}};
+  plan.nodes[3].data = json::object{{"blueprint", 7}, {"scale", 2}};
+  for (auto& node: plan.nodes)
+    node.type = SNT_BLUEPRINT_NODE;
+
+  LoadReport  report;
+  library.resolvePlan(save, plan, *catalog, &report);
+  CHECK(plan.nodes[0].type == SNT_BLUEPRINT_NODE);
+  CHECK(library.find(plan.nodes[0].data.as_object()["blueprint"].as_string().c_str()) == library.entries()[0]);
+  for (int i = 1; i < 4; i++)
+    CHECK(plan.nodes[i].type == SNT_NA);
+  CHECK(report.issues().size() == 3);
+  CHECK(report.issues()[0].path == "nodes[1].blueprint");
+}
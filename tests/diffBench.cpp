@@ -0,0 +1,30 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include "stator/factoryDiff.hpp"
+#include <iostream>
+
+//50k nodes on each side with no common id, so every node goes through the
+//structural matching, then the position pairing inside chains that all
+//look the same. The after side is moved and has other input values.
+STATOR_CASE(diff50k) {
+  CatalogRef      catalog = cycleCatalog();
+  FactorySnapshot before;
+  FactorySnapshot after;
+
+  Stopwatch loadWatch;
+  loadSnapshot(before, generateSave(*catalog, 166, 100), *catalog);
+  loadSnapshot(after, generateSave(*catalog, 166, 100, 1000000, 95, ImVec2(40, 25)), *catalog);
+  double    loadMs = loadWatch.ms();
+  Stopwatch diffWatch;
+  FactoryDiff diff = diffFactories(before, after, *catalog);
+  double    diffMs = diffWatch.ms();
+
+  std::cout << "  " << before.plan.nodes.size() << " nodes, generated and loaded both in " << loadMs
+    << " ms, diffed in " << diffMs << " ms, " << diff.matchedByStructure << " matched by structure, "
+    << diff.nodes.size() << " changed" << std::endl;
+  CHECK(diff.matchedByStructure == before.plan.nodes.size());
+  //Only the inputs changed, and each chain went to its own counterpart
+  CHECK(diff.nodes.size() == 166);
+  CHECK(diff.linksAdded == 0 && diff.linksRemoved == 0);
+  CHECK(diffMs < 1000);
+}
@@ -0,0 +1,46 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include <algorithm>
+#include <boost/json/parse.hpp>
+#include <iostream>
+
+//Evaluations pipelined over one connection, window requests in flight, each
+//overriding the input of one chain of a generated factory. Latency is from
+//sending a frame to reading its answer.
+STATOR_CASE(serverPipeline) {
+  CatalogRef            catalog = cycleCatalog();
+  LocalServer           server(*catalog);
+  json::value           save = generateSave(*catalog, 50, 20);
+  std::vector<uint64_t> inputs;
+  const int             total = 20000;
+  const int             window = 32;
+
+  for (auto& node: save.as_object()["nodes"].as_array()) {
+    if (node.as_object()["type"].as_string() == "SNT_IN_NODE")
+      inputs.push_back(node.as_object()["id"].to_number<uint64_t>());
+  }
+  CHECK(server.request(json::object{{"op", "load"}, {"factory", "bench"}, {"save", save}})["ok"].as_bool());
+
+  std::vector<Stopwatch>  sentAt(total);
+  std::vector<double>     latencies;
+  int                     sent = 0;
+  latencies.reserve(total);
+  Stopwatch               watch;
+  while (latencies.size() < total) {
+    for (; sent < total && sent - (int)latencies.size() < window; sent++) {
+      json::object  values;
+      values[std::to_string(inputs[sent % inputs.size()])] = 60 + sent % 50;
+      sentAt[sent] = Stopwatch();
+      server.sendFrame(json::serialize(json::object{{"id", sent}, {"op", "evaluate"}, {"factory", "bench"}, {"values", values}}));
+    }
+    json::object  response = json::parse(server.receiveFrame()).as_object();
+    CHECK(response["ok"].as_bool());
+    latencies.push_back(sentAt[response["id"].to_number<int>()].ms());
+  }
+  double  totalMs = watch.ms();
+
+  std::sort(latencies.begin(), latencies.end());
+  std::cout << "  " << total << " evaluations of " << save.as_object()["nodes"].as_array().size() << " nodes, "
+    << window << " in flight: p50 " << latencies[total / 2] << " ms, p99 " << latencies[total * 99 / 100]
+    << " ms, " << (int)(total / totalMs * 1000.0) << " requests/s" << std::endl;
+}
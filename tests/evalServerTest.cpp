@@ -0,0 +1,112 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include <algorithm>
+
+static json::object   solveRequest(int recipe) {
+  return (json::object{{"op", "solve"}, {"part", "C"}, {"rate", 30}, {"alternates", {{"B", recipe}}}});
+}
+
+//An alternate has to be a recipe making the part it is chosen for
+STATOR_CASE(serverAlternates) {
+  CatalogRef  catalog = cycleCatalog();
+  LocalServer server(*catalog);
+
+  json::object  solved = server.request(solveRequest(0));
+  CHECK(solved["ok"].as_bool());
+  json::object  rejected = server.request(solveRequest(1));
+  CHECK(!rejected["ok"].as_bool());
+  CHECK(std::string(rejected["error"].as_string().c_str()) == "recipe 1 does not produce B");
+  CHECK(!server.request(solveRequest(7))["ok"].as_bool());
+}
+
+//Evaluations follow the factory loaded under a name, not the copy a worker
+//made of a previous one
+STATOR_CASE(serverReload) {
+  CatalogRef  catalog = cycleCatalog();
+  LocalServer server(*catalog, 1);
+  auto        evaluate = [&]() {
+    return (server.request(json::object{{"op", "evaluate"}, {"factory", "line"}}));
+  };
+
+  CHECK(server.request(json::object{{"op", "load"}, {"factory", "line"}, {"save", generateSave(*catalog, 1, 3, 1, 90)}})["ok"].as_bool());
+  json::object  first = evaluate();
+  CHECK(first["ok"].as_bool());
+  CHECK(server.request(json::object{{"op", "unload"}, {"factory", "line"}})["unloaded"].as_bool());
+  CHECK(!evaluate()["ok"].as_bool());
+  CHECK(server.request(json::object{{"op", "load"}, {"factory", "line"}, {"save", generateSave(*catalog, 1, 3, 1, 45)}})["ok"].as_bool());
+  json::object  second = evaluate();
+  CHECK(second["ok"].as_bool());
+  double  before = jsonNumber(first["outputs"].as_array()[0].as_object()["rate"]);
+  double  after = jsonNumber(second["outputs"].as_array()[0].as_object()["rate"]);
+  CHECK_NEAR(after, before / 2, 1e-9);
+}
+
+//reach and rawCost answer what a RecipeGraph of the served catalog does
+STATOR_CASE(serverRecipeGraph) {
+  CatalogRef  catalog = moddedCatalog(60);
+  LocalServer server(*catalog, 1);
+  RecipeGraph graph;
+  graph.build(*catalog);
+  int         part = 59;
+  const Part& target = catalog->parts()[part];
+
+  json::object  cost = server.request(json::object{{"op", "rawCost"}, {"part", target.name.view()}});
+  CHECK(cost["ok"].as_bool());
+  CHECK(cost["depth"].to_number<int>() == graph.depth(part));
+  CHECK(cost["recipe"].to_number<int>() == catalog->recipes()[graph.defaultRecipe(part)].id);
+  CHECK(cost["raw"].as_object().size() == graph.rawCost(part).size());
+  for (auto& [raw, quantity]: graph.rawCost(part))
+    CHECK_NEAR(jsonNumber(cost["raw"].as_object()[catalog->parts()[raw].name.view()]), quantity, 1e-9 * quantity);
+
+  json::object  required = server.request(json::object{{"op", "reach"}, {"for", target.name.view()}});
+  RecipeGraph::Reachability expected = graph.requiredFor(part);
+  CHECK(required["ok"].as_bool());
+  CHECK(required["recipes"].as_array().size() == std::count(expected.recipes.begin(), expected.recipes.end(), 1));
+  CHECK(required["parts"].as_array().size() == std::count(expected.parts.begin(), expected.parts.end(), 1));
+
+  json::object  buildable = server.request(json::object{{"op", "reach"}, {"from", {"Iron Ore", "Iron Ingot"}}});
+  expected = graph.reachableFrom({0, 1});
+  CHECK(buildable["ok"].as_bool());
+  CHECK(buildable["parts"].as_array().size() == std::count(expected.parts.begin(), expected.parts.end(), 1));
+  CHECK(!server.request(json::object{{"op", "reach"}, {"from", {"Unobtainium"}}})["ok"].as_bool());
+}
+
+//layout places a loaded factory left to right along its links, every node
+//under its saved id
+STATOR_CASE(serverLayout) {
+  CatalogRef  catalog = cycleCatalog();
+  LocalServer server(*catalog, 1);
+  int         blocks = 3;
+
+  CHECK(server.request(json::object{{"op", "load"}, {"factory", "line"}, {"save", generateSave(*catalog, 2, blocks)}})["ok"].as_bool());
+  json::object  laidOut = server.request(json::object{{"op", "layout"}, {"factory", "line"}, {"layerSpacing", 100}});
+  CHECK(laidOut["ok"].as_bool());
+  json::object& positions = laidOut["positions"].as_object();
+  CHECK(positions.size() == 2 * (blocks * 3 + 2));
+  for (uint64_t id = 1; id < positions.size(); id++) {
+    if (id == blocks * 3 + 2)
+      continue ;
+    CHECK(jsonNumber(positions[std::to_string(id)].as_array()[0]) < jsonNumber(positions[std::to_string(id + 1)].as_array()[0]));
+  }
+  CHECK(!server.request(json::object{{"op", "layout"}, {"factory", "none"}})["ok"].as_bool());
+}
+
+//An override is undone exactly: the power totals after it are the ones the
+//factory had before, bit for bit
+STATOR_CASE(serverPowerRestore) {
+  CatalogRef  catalog = cycleCatalog();
+  LocalServer server(*catalog, 1);
+  auto        power = [&](json::object values) {
+    json::object  response = server.request(json::object{{"op", "evaluate"}, {"factory", "line"}, {"values", values}});
+    CHECK(response["ok"].as_bool());
+    return (response["power"].as_object());
+  };
+
+  CHECK(server.request(json::object{{"op", "load"}, {"factory", "line"}, {"save", generateSave(*catalog, 3, 6)}})["ok"].as_bool());
+  json::object  before = power({});
+  for (double value: {1234567.891, 0.1, 7e9 / 3})
+    CHECK(jsonNumber(power({{"1", value}, {"21", value / 7}})["consumption"]) != jsonNumber(before["consumption"]));
+  json::object  after = power({});
+  CHECK(jsonNumber(after["consumption"]) == jsonNumber(before["consumption"]));
+  CHECK(jsonNumber(after["generation"]) == jsonNumber(before["generation"]));
+}
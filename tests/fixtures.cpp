@@ -0,0 +1,248 @@
+#include "fixtures.hpp"
+#include <boost/json/parse.hpp>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+CatalogRef  cycleCatalog() {
+  std::vector<Part>   parts(3);
+  std::vector<Recipe> recipes(3);
+  parts[0].name = "A";
+  parts[1].name = "B";
+  parts[2].name = "C";
+  recipes[0].inputs = {{"A", 45}};
+  recipes[0].outputs = {{"B", 30}};
+  recipes[1].inputs = {{"B", 7}};
+  recipes[1].outputs = {{"C", 11}};
+  recipes[2].inputs = {{"C", 22}};
+  recipes[2].outputs = {{"A", 21}};
+  for (int i = 0; i < recipes.size(); i++) {
+    recipes[i].id = i;
+    recipes[i].power = 4;
+  }
+  return (Catalog::build(std::move(parts), std::move(recipes)));
+}
+
+CatalogRef  moddedCatalog(int partCount) {
+  static const char*  grades[] = {"", "Reinforced", "Heavy", "Modular", "Compact", "Fused", "Adaptive", "Encased"
+    , "Smart", "Turbo", "Cooling", "Pressure"};
+  static const char*  materials[] = {"Iron", "Copper", "Steel", "Aluminum", "Caterium", "Quartz", "Uranium"
+    , "Plastic", "Rubber", "Concrete", "Silica", "Sulfur"};
+  static const char*  forms[] = {"Ore", "Ingot", "Plate", "Rod", "Wire", "Sheet", "Beam", "Pipe", "Frame"
+    , "Rotor", "Stator", "Cable", "Casing", "Module"};
+  std::vector<Part>   parts(partCount);
+  std::vector<Recipe> recipes;
+  std::mt19937        random(7);
+  int                 raw = partCount / 10;
+
+  for (int i = 0; i < partCount; i++) {
+    int         combination = i % (12 * 12 * 14);
+    std::string grade = grades[combination / (12 * 14)];
+    std::string name = (grade.empty() ? "" : grade + " ") + materials[combination / 14 % 12] + " " + forms[combination % 14];
+    parts[i].name = i < 12 * 12 * 14 ? name : name + " Mk" + std::to_string(i / (12 * 12 * 14) + 1);
+  }
+  for (int i = raw; i < partCount; i++) {
+    for (int alternate = 0; alternate < 1 + (i % 3 == 0); alternate++) {
+      Recipe  recipe;
+      recipe.id = recipes.size();
+      recipe.power = 4 + random() % 30;
+      for (int input = random() % 3; input >= 0; input--)
+        recipe.inputs.push_back({parts[random() % i].name, (double)(1 + random() % 60)});
+      recipe.outputs.push_back({parts[i].name, (double)(1 + random() % 30)});
+      recipes.push_back(std::move(recipe));
+    }
+  }
+  return (Catalog::build(std::move(parts), std::move(recipes)));
+}
+
+int   addSplitChain(FlowGraph& flow, const Catalog& catalog, int blocks, double input) {
+  FlowNode  in;
+  in.type = SNT_IN_NODE;
+  in.value = input;
+  FlowPinRef  last = {flow.addNode(in), 0};
+  for (int block = 0; block < blocks; block++) {
+    FlowNode  recipe;
+    recipe.type = SNT_RECIPE_NODE;
+    recipe.recipe = &catalog.recipes()[block % catalog.recipes().size()];
+    int       recipeIndex = flow.addNode(recipe);
+    flow.addLink(last, {recipeIndex, 0});
+
+    FlowNode  split;
+    split.type = SNT_PART_NODE;
+    split.part = &catalog.parts()[recipe.recipe->outputs[0].part];
+    split.ins.resize(1);
+    split.ratios = {1.0 / 3, 1.0 / 3, 1.0 / 3};
+    int       splitIndex = flow.addNode(split);
+    flow.addLink({recipeIndex, 0}, {splitIndex, 0});
+
+    FlowNode  merge;
+    merge.type = SNT_PART_NODE;
+    merge.part = split.part;
+    merge.ins.resize(3);
+    merge.ratios = {1.0};
+    int       mergeIndex = flow.addNode(merge);
+    for (int pin = 0; pin < 3; pin++)
+      flow.addLink({splitIndex, pin}, {mergeIndex, pin});
+    last = {mergeIndex, 0};
+  }
+  FlowNode  out;
+  out.type = SNT_OUT_NODE;
+  int       outIndex = flow.addNode(out);
+  flow.addLink(last, {outIndex, 0});
+  return (outIndex);
+}
+
+json::value generateSave(const Catalog& catalog, int chains, int blocks, uint64_t firstId
+    , double input, ImVec2 offset) {
+  json::array nodes;
+  json::array links;
+  uint64_t    id = firstId;
+  auto        addNode = [&](json::object node, float x, float y) {
+    node["id"] = id;
+    node["pos"] = {{"x", offset.x + x}, {"y", offset.y + y}};
+    nodes.push_back(std::move(node));
+    return (id++);
+  };
+  auto        link = [&](uint64_t from, int fromPin, uint64_t to, int toPin) {
+    links.push_back({pinId(from, true, fromPin), pinId(to, false, toPin)});
+  };
+
+  nodes.reserve(chains * (blocks * 3 + 2));
+  for (int chain = 0; chain < chains; chain++) {
+    float     y = chain * 300.f;
+    uint64_t  last = addNode({{"type", "SNT_IN_NODE"}, {"value", input + chain}}, 0, y);
+    for (int block = 0; block < blocks; block++) {
+      const Recipe& recipe = catalog.recipes()[block % catalog.recipes().size()];
+      float         x = 200.f + block * 700.f;
+      uint64_t      recipeId = addNode({{"type", "SNT_RECIPE_NODE"}, {"recipeId", recipe.id}}, x, y);
+      uint64_t      split = addNode({
+        {"type", "SNT_PART_NODE"},
+        {"name", recipe.outputs[0].name.view()},
+        {"inCount", 1},
+        {"outs", {1.0 / 3, 1.0 / 3, 1.0 / 3}},
+      }, x + 250, y);
+      uint64_t      merge = addNode({
+        {"type", "SNT_PART_NODE"},
+        {"name", recipe.outputs[0].name.view()},
+        {"inCount", 3},
+        {"outs", {1.0}},
+      }, x + 450, y);
+      link(last, 0, recipeId, 0);
+      link(recipeId, 0, split, 0);
+      for (int pin = 0; pin < 3; pin++)
+        link(split, pin, merge, pin);
+      last = merge;
+    }
+    link(last, 0, addNode({{"type", "SNT_OUT_NODE"}}, 200.f + blocks * 700.f, y), 0);
+  }
+  json::object  save = {
+    {"type", "SNT_FACTORY_NODE"},
+    {"name", "generated"},
+    {"filepath", ""},
+    {"blueprints", json::array()},
+    {"nodes", nodes},
+    {"links", links},
+  };
+  return (save);
+}
+
+static json::array  quantitiesJson(const std::vector<PartWithQuantity>& quantities) {
+  json::array list;
+  for (auto& quantity: quantities)
+    list.push_back({{"Part", quantity.name.view()}, {"Quantity", quantity.quantity}});
+  return (list);
+}
+
+LocalServer::LocalServer(const Catalog& catalog, int workers)
+  : m_directory(std::filesystem::temp_directory_path() / ("statorServer" + std::to_string(getpid()))) {
+  json::array parts;
+  json::array recipes;
+  for (auto& part: catalog.parts())
+    parts.push_back({{"name", part.name.view()}, {"energy", part.energy}});
+  for (auto& recipe: catalog.recipes()) {
+    recipes.push_back({
+      {"RecipeId", recipe.id},
+      {"Power", recipe.power},
+      {"Input", quantitiesJson(recipe.inputs)},
+      {"Output", quantitiesJson(recipe.outputs)},
+    });
+  }
+  std::filesystem::remove_all(m_directory);
+  std::filesystem::create_directories(m_directory);
+  std::ofstream(m_directory / "parts.json") << json::serialize(json::object{{"parts", parts}});
+  std::ofstream(m_directory / "recipes.json") << json::serialize(json::object{{"recipes", recipes}});
+
+  std::string socketPath = (m_directory / "socket").string();
+  m_server.reset(new EvalServer((m_directory / "parts.json").string(), (m_directory / "recipes.json").string()));
+  m_thread = std::thread([this, socketPath, workers]() {m_server->run(socketPath, workers);});
+
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, socketPath.c_str(), sizeof(address.sun_path) - 1);
+  //The server listens once it read the catalog
+  for (int attempt = 0; attempt < 500 && m_fd < 0; attempt++) {
+    m_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (connect(m_fd, (sockaddr*)&address, sizeof(address)) == 0)
+      break ;
+    close(m_fd);
+    m_fd = -1;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  if (m_fd < 0) {
+    m_server->stop();
+    m_thread.join();
+    throw std::runtime_error("can't connect to " + socketPath);
+  }
+}
+
+LocalServer::~LocalServer() {
+  try {
+    sendFrame(json::serialize(json::object{{"op", "shutdown"}}));
+    receiveFrame();
+  }
+  catch (const std::exception&) {
+    m_server->stop();
+  }
+  close(m_fd);
+  m_thread.join();
+  std::error_code error;
+  std::filesystem::remove_all(m_directory, error);
+}
+
+void  LocalServer::sendFrame(const std::string& payload) {
+  uint32_t    length = payload.size();
+  std::string frame = {(char)length, (char)(length >> 8), (char)(length >> 16), (char)(length >> 24)};
+  frame += payload;
+  for (size_t sent = 0; sent < frame.size();) {
+    ssize_t size = ::send(m_fd, frame.data() + sent, frame.size() - sent, MSG_NOSIGNAL);
+    if (size <= 0)
+      throw std::runtime_error("server connection lost");
+    sent += size;
+  }
+}
+
+std::string   LocalServer::receiveFrame() {
+  auto  read = [this](char* buffer, size_t size) {
+    for (size_t got = 0; got < size;) {
+      ssize_t received = recv(m_fd, buffer + got, size - got, 0);
+      if (received <= 0)
+        throw std::runtime_error("server connection lost");
+      got += received;
+    }
+  };
+  unsigned char header[4];
+  read((char*)header, 4);
+  std::string   payload(header[0] | header[1] << 8 | header[2] << 16 | (uint32_t)header[3] << 24, 0);
+  read(payload.data(), payload.size());
+  return (payload);
+}
+
+json::object  LocalServer::request(const json::value& request) {
+  sendFrame(json::serialize(request));
+  return (json::parse(receiveFrame()).as_object());
+}
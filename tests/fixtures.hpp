@@ -0,0 +1,54 @@
+#pragma once
+
+#include "stator/catalog.hpp"
+#include "stator/evalServer.hpp"
+#include "stator/flowGraph.hpp"
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <thread>
+
+//Parts A, B and C, recipes A -> B, B -> C and C -> A (ids 0 to 2) with
+//awkward quantities whose ratios multiply back to 1, so a chain of any
+//length keeps its scale
+CatalogRef  cycleCatalog();
+
+//Modded sized catalog: parts named "<grade> <material> <form>", the first
+//tenth raw, every other part made by one or two recipes of one to three
+//earlier parts. The same for a given partCount.
+CatalogRef  moddedCatalog(int partCount = 2000);
+
+//An InputNode, then per block a recipe of the cycle, a three way split of
+//its output at 1/3 each and a PartNode merging the three back, ending on an
+//OutputNode. Returns the OutputNode index, the graph is left unbuilt.
+int         addSplitChain(FlowGraph& flow, const Catalog& catalog, int blocks, double input);
+
+//Factory save of chains split chains one under the other, each laid out as
+//addSplitChain but with pin id links as FactoryNode::toJson writes them.
+//Node ids count up from firstId, the InputNode of chain i is set to input + i.
+json::value generateSave(const Catalog& catalog, int chains, int blocks, uint64_t firstId = 1
+    , double input = 90, ImVec2 offset = ImVec2());
+
+//EvalServer run on its own thread over a socket in a fresh temporary
+//directory, serving catalog written out as the two catalog files, with one
+//client connected. Shut down and cleaned up on destruction.
+class LocalServer {
+  public:
+    LocalServer(const Catalog& catalog, int workers = 4);
+    ~LocalServer();
+
+    LocalServer(const LocalServer&) = delete;
+    LocalServer&  operator=(const LocalServer&) = delete;
+
+    //One frame each way, the payload without its length
+    void          sendFrame(const std::string& payload);
+    std::string   receiveFrame();
+    //Send then wait for the answer, nothing else may be in flight
+    json::object  request(const json::value& request);
+
+  private:
+    std::filesystem::path       m_directory;
+    std::unique_ptr<EvalServer> m_server;
+    std::thread                 m_thread;
+    int                         m_fd = -1;
+};
@@ -0,0 +1,35 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include "stator/flowGraph.hpp"
+
+//A reload moves the flow graph to the next catalog in place: once the old
+//catalog is gone, marking the node of the changed recipe dirty is enough to
+//get what a graph built on the next catalog evaluates
+STATOR_CASE(flowRebind) {
+  CatalogRef  catalog = cycleCatalog();
+  FlowGraph   flow;
+  int         out = addSplitChain(flow, *catalog, 3, 90);
+  flow.build();
+  double      before = flow.nodes()[out].rate;
+
+  std::vector<Part>   parts = catalog->parts();
+  std::vector<Recipe> recipes = catalog->recipes();
+  for (auto& part: parts)
+    part.recipes.clear();
+  recipes[1].outputs[0].quantity *= 2;
+  CatalogRef  next = Catalog::build(std::move(parts), std::move(recipes));
+  flow.rebind(*catalog, *next);
+  catalog = nullptr;
+  CHECK(flow.nodes()[1].recipe == &next->recipes()[0]);
+  CHECK(flow.nodes()[2].part == &next->parts()[1]);
+
+  int         changed = 4;
+  CHECK(flow.nodes()[changed].recipe == &next->recipes()[1]);
+  flow.markDirty(changed);
+  flow.update();
+  FlowGraph   fresh;
+  addSplitChain(fresh, *next, 3, 90);
+  fresh.build();
+  CHECK_NEAR(flow.nodes()[out].rate, fresh.nodes()[out].rate, 1e-9);
+  CHECK_NEAR(flow.nodes()[out].rate, 2 * before, 1e-9);
+}
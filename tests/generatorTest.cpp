@@ -0,0 +1,45 @@
+#include "harness.hpp"
+#include "stator/blueprint.hpp"
+#include "stator/catalog.hpp"
+#include "stator/factoryGenerator.hpp"
+
+//Recipe 0 makes B and a byproduct C out of A, recipe 1 makes D out of B.
+//The generated factory for D feeds A from an InputNode and lets C out
+//through its own OutputNode at the rate the recipe makes it: 40 D take 10
+//buildings of recipe 1, 80 B then take 4 of recipe 0 making 20 C.
+STATOR_CASE(generatorByproducts) {
+  std::vector<Part>   parts(4);
+  std::vector<Recipe> recipes(2);
+  parts[0].name = "A";
+  parts[1].name = "B";
+  parts[2].name = "C";
+  parts[3].name = "D";
+  recipes[0].inputs = {{"A", 10}};
+  recipes[0].outputs = {{"C", 5}, {"B", 20}};
+  recipes[1].inputs = {{"B", 8}};
+  recipes[1].outputs = {{"D", 4}};
+  recipes[1].id = 1;
+  CatalogRef  catalog = Catalog::build(std::move(parts), std::move(recipes));
+  RecipeGraph graph;
+  graph.build(*catalog);
+
+  FactoryPlan plan = generateFactory(graph, 3, 40);
+  FlowGraph   flow;
+  buildFlow(flow, plan, *catalog);
+  flow.evaluate();
+
+  std::vector<double> outputs;
+  int                 inputs = 0;
+  for (int i = 0; i < plan.nodes.size(); i++) {
+    if (plan.nodes[i].type == SNT_OUT_NODE)
+      outputs.push_back(flow.nodes()[i].rate);
+    if (plan.nodes[i].type == SNT_IN_NODE) {
+      CHECK(plan.nodes[i].value == 40);
+      inputs++;
+    }
+  }
+  CHECK(inputs == 1);
+  CHECK(outputs.size() == 2);
+  CHECK_NEAR(outputs[0], 40, 1e-9);
+  CHECK_NEAR(outputs[1], 20, 1e-9);
+}
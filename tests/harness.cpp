@@ -0,0 +1,44 @@
+#include "harness.hpp"
+#include "stator/memoryTracker.hpp"
+#include <cstring>
+#include <iostream>
+
+std::vector<HarnessCase>&   harnessCases() {
+  static std::vector<HarnessCase> cases;
+  return (cases);
+}
+
+int   runCases(int ac, char** av) {
+  std::vector<const HarnessCase*> selected;
+  for (int i = 1; i < ac; i++) {
+    size_t  count = selected.size();
+    for (auto& entry: harnessCases()) {
+      if (!strcmp(entry.name, av[i]))
+        selected.push_back(&entry);
+    }
+    if (selected.size() == count) {
+      std::cerr << "unknown case " << av[i] << std::endl;
+      return (1);
+    }
+  }
+  if (ac < 2) {
+    for (auto& entry: harnessCases())
+      selected.push_back(&entry);
+  }
+  int failed = 0;
+  for (auto entry: selected) {
+    Stopwatch watch;
+    try {
+      MemoryWatermark memory(entry->name);
+      entry->run();
+      std::cout << "ok    " << entry->name << " (" << (int)watch.ms() << " ms)" << std::endl;
+    }
+    catch (const std::exception& e) {
+      std::cout << "FAIL  " << entry->name << ": " << e.what() << std::endl;
+      failed++;
+    }
+  }
+  if (failed > 0)
+    std::cout << failed << " of " << selected.size() << " failed" << std::endl;
+  return (failed > 0);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+//Cases register under a name, a driver runs the ones named on its command
+//line or all of them. A failed CHECK throws, the driver reports it and goes
+//on with the next case.
+struct  HarnessCase {
+  const char* name;
+  void        (*run)();
+};
+
+std::vector<HarnessCase>&   harnessCases();
+//Exit status 0 when every case ran through, 1 otherwise. Each case runs
+//under a MemoryWatermark of its name.
+int                         runCases(int ac, char** av);
+
+struct  HarnessRegistrar {
+  HarnessRegistrar(const char* name, void (*run)()) {harnessCases().push_back({name, run});}
+};
+
+#define STATOR_CASE(name) \
+  static void name(); \
+  static HarnessRegistrar name##Registrar(#name, name); \
+  static void name()
+
+class CheckFailure: public std::runtime_error {
+  public:
+    CheckFailure(const char* file, int line, const std::string& condition)
+      : std::runtime_error(std::string(file) + ":" + std::to_string(line) + ": " + condition) {}
+};
+
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) \
+      throw CheckFailure(__FILE__, __LINE__, #condition); \
+  } while (0)
+
+#define CHECK_NEAR(value, expected, tolerance) \
+  do { \
+    double  checkValue = (value); \
+    double  checkExpected = (expected); \
+    if (!(std::abs(checkValue - checkExpected) <= (tolerance))) \
+      throw CheckFailure(__FILE__, __LINE__, std::string(#value " == " #expected ", got ") \
+        + std::to_string(checkValue) + " instead of " + std::to_string(checkExpected)); \
+  } while (0)
+
+class Stopwatch {
+  public:
+    Stopwatch(): m_start(std::chrono::steady_clock::now()) {}
+
+    double  ms() const {
+      return (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - m_start).count());
+    }
+
+  private:
+    std::chrono::steady_clock::time_point m_start;
+};
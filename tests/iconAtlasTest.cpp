@@ -0,0 +1,130 @@
+#include "harness.hpp"
+#include "stator/iconAtlas.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+namespace fs = std::filesystem;
+
+//Fresh directory under the system temporary one, removed when it goes out of scope
+class IconDirectory {
+  public:
+    IconDirectory(const char* name): m_path(fs::temp_directory_path() / name) {
+      fs::remove_all(m_path);
+      fs::create_directories(m_path);
+    }
+    ~IconDirectory() {
+      std::error_code error;
+      fs::remove_all(m_path, error);
+    }
+
+    const fs::path& path() const {return (m_path);}
+
+  private:
+    fs::path  m_path;
+};
+
+static void   iconColor(int index, uint8_t color[4]) {
+  color[0] = index;
+  color[1] = index >> 8;
+  color[2] = 255 - index;
+  color[3] = 255;
+}
+
+//width x height PNG filled with the colour of index, returns its file name
+static std::string  writeIcon(const fs::path& directory, int index, int width, int height) {
+  std::vector<uint8_t>  pixels(width * height * 4);
+  std::string           name = "icon" + std::to_string(index) + ".png";
+  uint8_t               color[4];
+  iconColor(index, color);
+  for (size_t i = 0; i < pixels.size(); i += 4)
+    std::memcpy(&pixels[i], color, 4);
+  CHECK(stbi_write_png((directory / name).string().c_str(), width, height, 4, pixels.data(), width * 4));
+  return (name);
+}
+
+//Pixel x, y of the cell of icon id
+static const uint8_t*   cellPixel(IconAtlas& atlas, int id, int x, int y) {
+  int   cell = id % IconAtlas::pageCells;
+  auto& page = *atlas.pages()[id / IconAtlas::pageCells];
+  int   top = (cell / IconAtlas::pageColumns) * IconAtlas::cellSize + y;
+  int   left = (cell % IconAtlas::pageColumns) * IconAtlas::cellSize + x;
+  return (page.pixels.data() + (top * IconAtlas::pageSize + left) * 4);
+}
+
+static bool   hasColor(const uint8_t* pixel, int index) {
+  uint8_t color[4];
+  iconColor(index, color);
+  return (!std::memcmp(pixel, color, 4));
+}
+
+//Icons land in cell id of the pages in request order, scaled with their
+//aspect kept, and files that don't decode end up failed
+STATOR_CASE(iconAtlasPlacement) {
+  IconDirectory     directory("statorIconAtlasPlacement");
+  IconAtlas         atlas(4);
+  int               count = IconAtlas::pageCells + 20;
+  std::vector<int>  ids;
+
+  atlas.setDirectory(directory.path().string());
+  for (int i = 0; i < count; i++)
+    ids.push_back(atlas.request(writeIcon(directory.path(), i, 64, 64)));
+  int wide = atlas.request(writeIcon(directory.path(), count, 128, 32));
+  std::ofstream(directory.path() / "broken.png") << "not a png";
+  int broken = atlas.request("broken.png");
+  int missing = atlas.request("missing.png");
+  CHECK(atlas.request("") == -1);
+  CHECK(atlas.request("icon0.png") == ids[0]);
+  atlas.wait();
+
+  CHECK(atlas.pages().size() == 2);
+  CHECK(atlas.pages()[0]->pending.size() == IconAtlas::pageCells);
+  for (int i = 0; i < count; i++) {
+    CHECK(ids[i] == i);
+    CHECK(atlas.state(i) == IconAtlas::IS_DECODED);
+    CHECK(hasColor(cellPixel(atlas, i, 0, 0), i));
+    CHECK(hasColor(cellPixel(atlas, i, 32, 32), i));
+    CHECK(hasColor(cellPixel(atlas, i, 63, 63), i));
+  }
+  //128 x 32 scales to 64 x 16, centred with transparent rows around
+  CHECK(atlas.state(wide) == IconAtlas::IS_DECODED);
+  CHECK(cellPixel(atlas, wide, 10, 23)[3] == 0);
+  CHECK(hasColor(cellPixel(atlas, wide, 10, 24), count));
+  CHECK(hasColor(cellPixel(atlas, wide, 10, 39), count));
+  CHECK(cellPixel(atlas, wide, 10, 40)[3] == 0);
+  CHECK(atlas.state(broken) == IconAtlas::IS_FAILED);
+  CHECK(atlas.state(missing) == IconAtlas::IS_FAILED);
+  auto& pending = atlas.pages()[1]->pending;
+  CHECK(std::find(pending.begin(), pending.end(), broken % IconAtlas::pageCells) == pending.end());
+
+  atlas.uploaded(1, ids.back() % IconAtlas::pageCells);
+  CHECK(atlas.state(ids.back()) == IconAtlas::IS_READY);
+}
+
+//2,000 icons of 256 x 256 requested then waited for, timings printed
+STATOR_CASE(iconAtlas2000) {
+  IconDirectory             directory("statorIconAtlas2000");
+  IconAtlas                 atlas;
+  std::vector<std::string>  names;
+  for (int i = 0; i < 2000; i++)
+    names.push_back(writeIcon(directory.path(), i, 256, 256));
+  atlas.setDirectory(directory.path().string());
+
+  Stopwatch watch;
+  for (auto& name: names)
+    atlas.request(name);
+  double    requestMs = watch.ms();
+  atlas.wait();
+  double    totalMs = watch.ms();
+  for (int i = 0; i < names.size(); i++) {
+    CHECK(atlas.state(i) == IconAtlas::IS_DECODED);
+    CHECK(hasColor(cellPixel(atlas, i, 32, 32), i));
+  }
+  std::cout << "  " << names.size() << " icons on " << atlas.pages().size() << " pages: requested in " << requestMs
+    << " ms, decoded in " << totalMs << " ms, " << (int)(names.size() / totalMs * 1000.0) << " icons/s" << std::endl;
+}
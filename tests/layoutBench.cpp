@@ -0,0 +1,46 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include "stator/layout.hpp"
+#include <iostream>
+#include <random>
+
+//nodes nodes in layers of about 50, each with one or two edges to nodes up
+//to three layers further on, and one edge in 50 going back to make cycles
+static LayoutGraph  randomFactory(int nodes) {
+  LayoutGraph   graph;
+  std::mt19937  random(3);
+
+  graph.sizes.assign(nodes, ImVec2(200, 100));
+  for (int from = 0; from < nodes; from++) {
+    for (int edge = random() % 2; edge >= 0; edge--) {
+      int to = from + 50 + random() % 150;
+      if (random() % 50 == 0)
+        to = from - 50 - random() % 100;
+      if (to >= 0 && to < nodes)
+        graph.edges.push_back({from, to});
+    }
+  }
+  return (graph);
+}
+
+static double   layoutMs(const LayoutGraph& graph) {
+  Stopwatch           watch;
+  std::vector<ImVec2> positions = computeLayout(graph);
+  double              ms = watch.ms();
+  CHECK(positions.size() == graph.sizes.size());
+  return (ms);
+}
+
+//Layout of a 10k node factory stays interactive, the 2,500 node run shows
+//how it scales
+STATOR_CASE(layout10k) {
+  LayoutGraph small = randomFactory(2500);
+  LayoutGraph large = randomFactory(10000);
+  double      smallMs = layoutMs(small);
+  double      largeMs = layoutMs(large);
+
+  std::cout << "  " << small.sizes.size() << " nodes, " << small.edges.size() << " edges in " << smallMs << " ms, "
+    << large.sizes.size() << " nodes, " << large.edges.size() << " edges in " << largeMs << " ms, x"
+    << largeMs / smallMs << std::endl;
+  CHECK(largeMs < 1000);
+}
@@ -0,0 +1,85 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include "stator/catalogLoader.hpp"
+#include "stator/factoryGenerator.hpp"
+#include <boost/json/parse.hpp>
+
+static bool   reported(const LoadReport& report, const std::string& path) {
+  for (auto& issue: report.issues())
+    if (issue.path == path)
+      return (true);
+  return (false);
+}
+
+//Recipe ids are ints in the catalog, wider ones are errors and not truncated
+STATOR_CASE(recipeIdRange) {
+  json::value document = json::parse(R"({"recipes": [
+    {"RecipeId": 4294967297, "Output": [{"Part": "A", "Quantity": 1}], "Input": []},
+    {"RecipeId": -2147483649, "Output": [{"Part": "A", "Quantity": 1}], "Input": []},
+    {"RecipeId": 1, "Output": [{"Part": "A", "Quantity": 1}], "Input": []}
+  ]})");
+  LoadReport  report;
+  auto        recipes = readRecipes(document, report);
+  CHECK(recipes.size() == 1);
+  CHECK(recipes[0].id == 1);
+  CHECK(report.issues().size() == 2);
+  CHECK(reported(report, "recipes[0].RecipeId"));
+  CHECK(reported(report, "recipes[1].RecipeId"));
+}
+
+//Node errors keep their full path, valid neighbours are still planned
+STATOR_CASE(fragmentErrorPaths) {
+  CatalogRef  catalog = cycleCatalog();
+  json::value save = generateSave(*catalog, 1, 1);
+  auto&       nodes = save.as_object()["nodes"].as_array();
+  nodes[1].as_object()["recipeId"] = 99;
+  nodes[2].as_object()["pos"] = 3;
+  nodes[3].as_object()["id"] = nodes[0].as_object()["id"];
+  nodes.push_back("nothing");
+
+  json::array   nestedNodes;
+  nestedNodes.push_back(json::object{{"type", "SNT_NOTHING"}});
+  nodes.push_back(json::object{{"type", "SNT_FACTORY_NODE"}, {"nodes", nestedNodes}});
+
+  FactoryPlan plan;
+  LoadReport  report;
+  planFromFragment(save, *catalog, plan, &report, "factory");
+  CHECK(plan.nodes.size() == nodes.size());
+  CHECK(plan.nodes[1].type == SNT_NA);
+  CHECK(plan.nodes[0].type == SNT_IN_NODE);
+  CHECK(plan.nodes[3].id == 0);
+  CHECK(reported(report, "factory.nodes[1].recipeId"));
+  CHECK(reported(report, "factory.nodes[2].pos"));
+  CHECK(reported(report, "factory.nodes[3].id"));
+  CHECK(reported(report, "factory.nodes[" + std::to_string(nodes.size() - 2) + "]"));
+  CHECK(reported(report, "factory.nodes[" + std::to_string(nodes.size() - 1) + "].nodes[0].type"));
+}
+
+//Names read from the files are pooled, a quantity shares the text of its part
+STATOR_CASE(pooledNames) {
+  json::value parts = json::parse(R"({"parts": [
+    {"name": "Reinforced Iron Plate", "img": "icons/reinforced_iron_plate.png"},
+    {"name": "Iron Plate", "img": "icons/iron_plate.png"}
+  ]})");
+  json::value recipes = json::parse(R"({"recipes": [
+    {"RecipeId": 1, "Input": [{"Part": "Iron Plate", "Quantity": 6}], "Output": [{"Part": "Reinforced Iron Plate", "Quantity": 1}]},
+    {"RecipeId": 2, "Input": [{"Part": "Iron Plate", "Quantity": 1}], "Output": [{"Part": "Iron Plate", "Quantity": 2}]}
+  ]})");
+  LoadReport  report;
+  CatalogRef  catalog = Catalog::build(readParts(parts, report), readRecipes(recipes, report));
+  CHECK(report.empty());
+
+  const Part& plate = catalog->parts()[catalog->findPart("Iron Plate")];
+  CHECK(plate.name == "Iron Plate");
+  CHECK(plate.imgPath == std::string("icons/iron_plate.png"));
+  for (auto& recipe: catalog->recipes()) {
+    CHECK(recipe.inputs[0].name.c_str() == plate.name.c_str());
+    CHECK(recipe.outputs[0].name == catalog->parts()[recipe.outputs[0].part].name);
+  }
+  size_t      count = PooledString::poolCount();
+  CatalogRef  reloaded;
+  applyCatalog(*catalog, readParts(parts, report), readRecipes(recipes, report), reloaded);
+  CHECK(PooledString::poolCount() == count);
+  CHECK(PooledString("Iron Plate").c_str() == plate.name.c_str());
+  CHECK(PooledString().c_str() == PooledString("").c_str());
+}
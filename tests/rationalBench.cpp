@@ -0,0 +1,31 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include <iostream>
+
+//The exact mode pays for evaluate() then evaluateExact(), it has to stay
+//within a small constant factor of evaluate() alone on chains of 1/3 splits
+STATOR_CASE(rationalVsDouble) {
+  CatalogRef  catalog = cycleCatalog();
+  FlowGraph   flow;
+  int         out = addSplitChain(flow, *catalog, 2000, 90);
+  const int   runs = 50;
+
+  flow.build();
+  flow.evaluateExact();
+  Stopwatch doubleWatch;
+  for (int run = 0; run < runs; run++)
+    flow.evaluate();
+  double    doubleMs = doubleWatch.ms() / runs;
+  Stopwatch exactWatch;
+  for (int run = 0; run < runs; run++) {
+    flow.evaluate();
+    flow.evaluateExact();
+  }
+  double    exactMs = exactWatch.ms() / runs;
+
+  std::cout << "  " << flow.nodes().size() << " nodes, double " << doubleMs << " ms, exact "
+    << exactMs << " ms, x" << exactMs / doubleMs << ", output " << flow.exactRate(out).toString()
+    << " (" << flow.nodes()[out].rate << ")" << std::endl;
+  CHECK(!flow.exactRate(out).isBig());
+  CHECK(exactMs < 15 * doubleMs);
+}
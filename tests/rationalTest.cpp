@@ -0,0 +1,54 @@
+#include "harness.hpp"
+#include "stator/catalog.hpp"
+#include "stator/flowGraph.hpp"
+
+//Input -> four recipes of prime quantities in a row -> OutputNode behind a
+//capped link. The limits the cap sends back have a denominator the exact
+//tolerance can't recover from a double, so they have to be exact themselves.
+STATOR_CASE(exactCaps) {
+  std::vector<Part>   parts(5);
+  std::vector<Recipe> recipes(4);
+  int                 quantities[4][2] = {{7, 11}, {13, 17}, {19, 23}, {29, 31}};
+  for (int i = 0; i < parts.size(); i++)
+    parts[i].name = std::string(1, 'A' + i);
+  for (int i = 0; i < recipes.size(); i++) {
+    recipes[i].id = i;
+    recipes[i].inputs = {{parts[i].name, (double)quantities[i][0]}};
+    recipes[i].outputs = {{parts[i + 1].name, (double)quantities[i][1]}};
+  }
+  CatalogRef  catalog = Catalog::build(std::move(parts), std::move(recipes));
+  FlowGraph   flow;
+  FlowNode    in;
+  in.type = SNT_IN_NODE;
+  in.value = 100;
+  int         previous = flow.addNode(in);
+  for (int i = 0; i < 4; i++) {
+    FlowNode  recipe;
+    recipe.type = SNT_RECIPE_NODE;
+    recipe.recipe = &catalog->recipes()[i];
+    int       index = flow.addNode(recipe);
+    flow.addLink({previous, 0}, {index, 0});
+    previous = index;
+  }
+  FlowNode    out;
+  out.type = SNT_OUT_NODE;
+  int         output = flow.addNode(out);
+  flow.addLink({previous, 0}, {output, 0}, 37);
+  flow.build();
+  flow.evaluate();
+  flow.evaluateExact();
+
+  Rational  first(37 * 29 * 19 * 13, 31 * 23 * 17 * 11);
+  CHECK(Rational::fromDouble(first.toDouble(), 5e-7) != first);
+  CHECK(flow.exactRate(1) == first);
+  CHECK(flow.exactRate(4) == Rational(37, 31));
+  CHECK(flow.exactRate(output) == Rational(37));
+  CHECK(flow.exactOuts(0)[0] == first * Rational(7));
+
+  //Without caps only the last sweep is exact, and still agrees
+  flow.setCap(output, 0, linkTierCapacity(0));
+  flow.evaluate();
+  flow.evaluateExact();
+  CHECK(flow.exactRate(1) == Rational(100, 7));
+  CHECK_NEAR(flow.exactRate(output).toDouble(), flow.nodes()[output].rate, 1e-9);
+}
@@ -0,0 +1,61 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include "stator/recipeGraph.hpp"
+
+//Catalog of base with recipe change() applied to the recipes at the given
+//indices, as a reload would build it
+template<typename Change>
+static CatalogRef   reloaded(const Catalog& base, const std::vector<int>& changed, Change change) {
+  std::vector<Part>   parts = base.parts();
+  std::vector<Recipe> recipes = base.recipes();
+  for (auto& part: parts)
+    part.recipes.clear();
+  for (int recipe: changed)
+    change(recipes[recipe]);
+  return (Catalog::build(std::move(parts), std::move(recipes)));
+}
+
+static void   checkMatches(RecipeGraph& updated, RecipeGraph& fresh) {
+  for (int part = 0; part < fresh.partCount(); part++) {
+    CHECK(updated.depth(part) == fresh.depth(part));
+    CHECK(updated.defaultRecipe(part) == fresh.defaultRecipe(part));
+    auto& expected = fresh.rawCost(part);
+    auto& cost = updated.rawCost(part);
+    CHECK(cost.size() == expected.size());
+    for (auto& [raw, quantity]: expected) {
+      CHECK(cost.count(raw));
+      CHECK_NEAR(cost.at(raw), quantity, 1e-9 * quantity);
+    }
+  }
+}
+
+//A reload only recomputes the depths and costs downstream of the recipes it
+//changed, and ends where a fresh build of the new catalog does
+STATOR_CASE(recipeGraphReload) {
+  CatalogRef  catalog = moddedCatalog();
+  RecipeGraph graph;
+  graph.build(*catalog);
+  for (int part = 0; part < graph.partCount(); part++)
+    graph.rawCost(part);
+
+  //Late recipes made of raw parts alone, so their outputs get shallower
+  std::vector<int>  changed = {2000, 2100, 2399};
+  CatalogRef        next = reloaded(*catalog, changed, [](Recipe& recipe) {
+    recipe.inputs = {{"Iron Ore", 3}, {"Copper Ingot", 2}};
+  });
+  graph.updateRecipes(*next, changed);
+  int         cached = 0;
+  for (int part = 0; part < graph.partCount(); part++)
+    cached += graph.costCached(part);
+  CHECK(cached > 0 && cached < graph.partCount());
+  RecipeGraph fresh;
+  fresh.build(*next);
+  checkMatches(graph, fresh);
+
+  //Then removed, the parts they made fall back to their other recipe or get deeper
+  changed = {2000, 2100, 2399, 1500};
+  CatalogRef        removed = reloaded(*next, changed, [](Recipe& recipe) {recipe.removed = true;});
+  graph.updateRecipes(*removed, changed);
+  fresh.build(*removed);
+  checkMatches(graph, fresh);
+}
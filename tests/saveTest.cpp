@@ -0,0 +1,110 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include "stator/factory.hpp"
+#include <algorithm>
+#include <iostream>
+#include <map>
+#include <set>
+#include <tuple>
+
+using SavedLink = std::tuple<uint64_t, uint64_t, int>;
+
+//Nodes by id without their position, and links as (out pin id, in pin id, tier)
+static void   readSave(const json::value& save, std::map<uint64_t, json::value>& nodes, std::set<SavedLink>& links) {
+  for (auto& node: save.as_object().at("nodes").as_array()) {
+    json::value content = node;
+    content.as_object().erase("pos");
+    nodes[node.as_object().at("id").to_number<uint64_t>()] = content;
+  }
+  for (auto& link: save.as_object().at("links").as_array()) {
+    auto& ends = link.as_array();
+    links.insert({ends[0].to_number<uint64_t>(), ends[1].to_number<uint64_t>(), ends.size() > 2 ? ends[2].to_number<int>() : 0});
+  }
+}
+
+static json::value  loadAndSave(const json::value& save, const CatalogRef& catalog) {
+  FactoryPlan plan;
+  CHECK(planFromFragment(save, *catalog, plan));
+  FactoryNode factory(catalog);
+  factory.insertPlan(plan, true);
+  return (factory.toJson());
+}
+
+//save -> load -> save -> load -> save keeps every id, link and tier
+STATOR_CASE(saveRoundTrip) {
+  CatalogRef  catalog = cycleCatalog();
+  json::value save = generateSave(*catalog, 3, 4, 100);
+  auto&       links = save.as_object()["links"].as_array();
+  for (int i = 0; i < links.size(); i += 3)
+    links[i].as_array().push_back(1 + i % (linkTierCount - 1));
+
+  json::value first = loadAndSave(save, catalog);
+  json::value second = loadAndSave(first, catalog);
+  std::map<uint64_t, json::value> nodes[3];
+  std::set<SavedLink>             linkSets[3];
+  readSave(save, nodes[0], linkSets[0]);
+  readSave(first, nodes[1], linkSets[1]);
+  readSave(second, nodes[2], linkSets[2]);
+  for (int i = 1; i < 3; i++) {
+    CHECK(nodes[i].size() == nodes[0].size());
+    for (auto& node: nodes[0]) {
+      auto it = nodes[i].find(node.first);
+      CHECK(it != nodes[i].end());
+      CHECK(it->second == node.second);
+    }
+    CHECK(linkSets[i] == linkSets[0]);
+  }
+}
+
+//A copied fragment pasted back gets new ids but the same links and tiers
+STATOR_CASE(fragmentRoundTrip) {
+  CatalogRef  catalog = cycleCatalog();
+  FactoryPlan plan;
+  FactoryNode factory(catalog);
+  CHECK(planFromFragment(generateSave(*catalog, 2, 3), *catalog, plan));
+  plan.links[1].tier = 2;
+  for (auto& node: factory.insertPlan(plan, true))
+    node->selected(true);
+
+  json::value fragment = factory.copySelection();
+  FactoryPlan copied;
+  CHECK(planFromFragment(fragment, *catalog, copied));
+  CHECK(copied.nodes.size() == plan.nodes.size());
+  CHECK(copied.links.size() == plan.links.size());
+  FactoryNode pasted(catalog);
+  auto        nodes = pasted.insertPlan(copied);
+  std::set<std::tuple<int, int, int, int, int>> before;
+  std::set<std::tuple<int, int, int, int, int>> after;
+  for (auto& link: copied.links) {
+    before.insert({link.from, link.fromPin, link.to, link.toPin, link.tier});
+    after.insert({link.from, link.fromPin, link.to, link.toPin, pasted.linkTier(nodes[link.to].get(), link.toPin)});
+    CHECK(nodes[link.to]->getIns()[link.toPin]->isConnected());
+  }
+  CHECK(before == after);
+  CHECK(std::count_if(copied.links.begin(), copied.links.end(), [](auto& link) {return (link.tier == 2);}) == 1);
+}
+
+//Generated 50k node save parsed, resolved and instantiated, timings printed
+STATOR_CASE(largeSaveLoad) {
+  CatalogRef  catalog = cycleCatalog();
+  std::string text = json::serialize(generateSave(*catalog, 166, 100));
+
+  Stopwatch   parseWatch;
+  json::value save = json::parse(text);
+  double      parseMs = parseWatch.ms();
+  Stopwatch   planWatch;
+  FactoryPlan plan;
+  CHECK(planFromFragment(save, *catalog, plan));
+  double      planMs = planWatch.ms();
+  Stopwatch   insertWatch;
+  FactoryNode factory(catalog);
+  factory.insertPlan(plan, true);
+  double      insertMs = insertWatch.ms();
+
+  std::cout << "  " << plan.nodes.size() << " nodes, " << plan.links.size() << " links, "
+    << text.size() / 1024 << " KiB: parse " << parseMs << " ms, plan " << planMs << " ms, insert "
+    << insertMs << " ms" << std::endl;
+  CHECK(plan.nodes.size() == 166 * 302);
+  CHECK(plan.links.size() == 166 * 501);
+  CHECK(factory.nodeById(plan.nodes.back().id) != nullptr);
+}
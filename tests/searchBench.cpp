@@ -0,0 +1,41 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include "stator/searchIndex.hpp"
+#include <algorithm>
+#include <iostream>
+
+//Palette queries over a 2,000 part catalog as they come while typing, from
+//one character to typos and produces/consumes lists. Each has to answer in
+//well under a millisecond, the slowest average is printed.
+STATOR_CASE(searchQueries) {
+  CatalogRef  catalog = moddedCatalog();
+  SearchIndex index;
+  const char* queries[] = {"i", "ir", "iro", "iron", "iron pl", "reinforced iron plate", "rienforced irno plate"
+    , "s", "st", "stator", "produces steel beam", "consumes copper wire", "produces c", "mk", "xyzzy"};
+  const int   runs = 200;
+
+  Stopwatch   buildWatch;
+  index.build(*catalog);
+  double      buildMs = buildWatch.ms();
+  CHECK(index.query("ir").size() == 200);
+  CHECK(index.label(index.query("heavy iron plate")[0]) == "Heavy Iron Plate");
+  auto        typo = index.query("haevy iron plate", 10);
+  CHECK(std::any_of(typo.begin(), typo.end(), [&](auto& result) {return (result.part == index.query("heavy iron plate")[0].part);}));
+  CHECK(index.query("xyzzy").empty());
+
+  double      slowestUs = 0.0;
+  const char* slowest = "";
+  for (const char* query: queries) {
+    Stopwatch watch;
+    for (int run = 0; run < runs; run++)
+      index.query(query);
+    double    us = watch.ms() * 1000.0 / runs;
+    if (us > slowestUs) {
+      slowestUs = us;
+      slowest = query;
+    }
+  }
+  std::cout << "  " << catalog->parts().size() << " parts, " << catalog->recipes().size() << " recipes, built in "
+    << buildMs << " ms, slowest query \"" << slowest << "\" " << slowestUs << " us" << std::endl;
+  CHECK(slowestUs < 500);
+}
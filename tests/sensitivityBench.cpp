@@ -0,0 +1,92 @@
+#include "harness.hpp"
+#include "stator/catalog.hpp"
+#include "stator/sensitivity.hpp"
+#include <iostream>
+#include <random>
+
+//About 5,000 nodes wired at random from 200 inputs: two input recipes (one
+//link in five capped) and two way PartNodes, every pin left open ending on an
+//OutputNode. The whole matrix has to come out well ahead of finite
+//differences, nudging each parameter in turn and re-solving what it reaches.
+STATOR_CASE(sensitivity5k) {
+  std::vector<Part>   parts(1);
+  std::vector<Recipe> recipes(1);
+  parts[0].name = "A";
+  recipes[0].inputs = {{"A", 30}, {"A", 20}};
+  recipes[0].outputs = {{"A", 30}, {"A", 10}};
+  CatalogRef              catalog = Catalog::build(std::move(parts), std::move(recipes));
+  FlowGraph               flow;
+  std::mt19937            random(1);
+  std::vector<FlowPinRef> open;
+  auto                    take = [&]() {
+    int         index = random() % open.size();
+    FlowPinRef  pin = open[index];
+    open[index] = open.back();
+    open.pop_back();
+    return (pin);
+  };
+
+  for (int i = 0; i < 200; i++) {
+    FlowNode  in;
+    in.type = SNT_IN_NODE;
+    in.value = 50 + i % 7;
+    open.push_back({flow.addNode(in), 0});
+  }
+  for (int i = 0; i < 4800 && open.size() > 2; i++) {
+    FlowNode  node;
+    if (i % 2) {
+      node.type = SNT_RECIPE_NODE;
+      node.recipe = &catalog->recipes()[0];
+    }
+    else {
+      node.type = SNT_PART_NODE;
+      node.ins.resize(1);
+      node.ratios = {0.4, 0.6};
+    }
+    int index = flow.addNode(node);
+    flow.addLink(take(), {index, 0});
+    if (i % 2)
+      flow.addLink(take(), {index, 1}, i % 5 == 0 ? 20 : linkTierCapacity(0));
+    open.push_back({index, 0});
+    open.push_back({index, 1});
+  }
+  for (auto pin: open) {
+    FlowNode  out;
+    out.type = SNT_OUT_NODE;
+    flow.addLink(pin, {flow.addNode(out), 0});
+  }
+  flow.build();
+  flow.evaluate();
+
+  Sensitivity sensitivity;
+  Stopwatch   computeWatch;
+  sensitivity.compute(flow);
+  double      computeMs = computeWatch.ms();
+
+  const double        step = 1e-6;
+  std::vector<double> column(sensitivity.outputs().size());
+  Stopwatch           differenceWatch;
+  for (auto& param: sensitivity.params()) {
+    FlowNode& node = flow.nodes()[param.node];
+    double&   value = param.pin < 0 ? node.value : node.ratios[param.pin];
+    double    saved = value;
+    value += step;
+    flow.markDirty(param.node);
+    flow.update();
+    for (int i = 0; i < column.size(); i++)
+      column[i] = flow.nodes()[sensitivity.outputs()[i]].rate;
+    value = saved;
+    flow.markDirty(param.node);
+    flow.update();
+    for (int i = 0; i < column.size(); i++)
+      column[i] = (column[i] - flow.nodes()[sensitivity.outputs()[i]].rate) / step;
+  }
+  double      differenceMs = differenceWatch.ms();
+
+  std::cout << "  " << flow.nodes().size() << " nodes, " << sensitivity.outputs().size() << " outputs x "
+    << sensitivity.params().size() << " params, " << sensitivity.nonZeros() << " non zero, tape of "
+    << sensitivity.tapeSize() << " terms: " << computeMs << " ms, finite differences "
+    << differenceMs << " ms, x" << differenceMs / computeMs << std::endl;
+  CHECK(!sensitivity.outputs().empty() && !sensitivity.params().empty());
+  CHECK(computeMs * 5 < differenceMs);
+}
@@ -0,0 +1,154 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include "stator/sensitivity.hpp"
+#include <algorithm>
+#include <cmath>
+
+static std::vector<double>  outputRates(FlowGraph& flow) {
+  std::vector<double> rates;
+  flow.evaluate();
+  for (auto& node: flow.nodes()) {
+    if (node.type == SNT_OUT_NODE)
+      rates.push_back(node.rate);
+  }
+  return (rates);
+}
+
+//Every column of the matrix matches a central difference on the parameter,
+//with a step small enough not to cross a branch. Rates are not linear in
+//the ratios once a limit binds, hence central rather than forward.
+static void   checkDerivatives(FlowGraph& flow, const Sensitivity& sensitivity) {
+  CHECK(sensitivity.outputs().size() == outputRates(flow).size());
+  for (int column = 0; column < sensitivity.params().size(); column++) {
+    auto      param = sensitivity.params()[column];
+    FlowNode& node = flow.nodes()[param.node];
+    double&   value = param.pin < 0 ? node.value : node.ratios[param.pin];
+    double    step = 1e-6 * std::max(1.0, std::fabs(value));
+    value += step;
+    std::vector<double> up = outputRates(flow);
+    value -= 2 * step;
+    std::vector<double> down = outputRates(flow);
+    value += step;
+    for (int row = 0; row < up.size(); row++)
+      CHECK_NEAR(sensitivity.at(row, column), (up[row] - down[row]) / (2 * step), 1e-6 * std::max(1.0, std::fabs(sensitivity.at(row, column))));
+  }
+  outputRates(flow);
+}
+
+//Inputs A and B -> recipe A + B to C -> PartNode splitting 0.3 and 0.7 ->
+//two OutputNodes
+static FlowGraph  mergeSplit(const Catalog& catalog) {
+  FlowGraph flow;
+  FlowNode  in;
+  in.type = SNT_IN_NODE;
+  in.value = 100;
+  flow.addNode(in);
+  in.value = 60;
+  flow.addNode(in);
+  FlowNode  recipe;
+  recipe.type = SNT_RECIPE_NODE;
+  recipe.recipe = &catalog.recipes()[0];
+  flow.addNode(recipe);
+  FlowNode  split;
+  split.type = SNT_PART_NODE;
+  split.ins.resize(1);
+  split.ratios = {0.3, 0.7};
+  flow.addNode(split);
+  FlowNode  out;
+  out.type = SNT_OUT_NODE;
+  flow.addNode(out);
+  flow.addNode(out);
+
+  flow.addLink({0, 0}, {2, 0});
+  flow.addLink({1, 0}, {2, 1});
+  flow.addLink({2, 0}, {3, 0});
+  flow.addLink({3, 0}, {4, 0});
+  flow.addLink({3, 1}, {5, 0});
+  flow.build();
+  return (flow);
+}
+
+//Fewer outputs than parameters. The derivatives follow the recipe input and
+//the cap that bind.
+STATOR_CASE(sensitivityReverse) {
+  std::vector<Part>   parts(3);
+  std::vector<Recipe> recipes(1);
+  parts[0].name = "A";
+  parts[1].name = "B";
+  parts[2].name = "C";
+  recipes[0].inputs = {{"A", 30}, {"B", 30}};
+  recipes[0].outputs = {{"C", 30}};
+  CatalogRef  catalog = Catalog::build(std::move(parts), std::move(recipes));
+  FlowGraph   flow = mergeSplit(*catalog);
+  Sensitivity sensitivity;
+
+  flow.evaluate();
+  sensitivity.compute(flow);
+  CHECK(sensitivity.params().size() == 4);
+  CHECK(sensitivity.branch(2).branch == Sensitivity::SB_INPUT && sensitivity.branch(2).pin == 1);
+  CHECK_NEAR(sensitivity.at(0, 0), 0, 1e-12);
+  CHECK_NEAR(sensitivity.at(0, 1), 0.3, 1e-12);
+  checkDerivatives(flow, sensitivity);
+
+  flow.setCap(4, 0, 10);
+  flow.evaluate();
+  sensitivity.compute(flow);
+  CHECK(sensitivity.capped(4, 0));
+  CHECK_NEAR(sensitivity.at(0, 1), 0, 1e-12);
+  checkDerivatives(flow, sensitivity);
+
+  flow.setCap(4, 0, linkTierCapacity(0));
+  flow.nodes()[1].value = 200;
+  flow.evaluate();
+  sensitivity.compute(flow);
+  CHECK(sensitivity.branch(2).pin == 0);
+  CHECK_NEAR(sensitivity.at(1, 0), 0.7, 1e-12);
+  checkDerivatives(flow, sensitivity);
+}
+
+//More outputs than parameters, two outputs left unlinked depend on nothing
+STATOR_CASE(sensitivityForward) {
+  FlowGraph flow;
+  FlowNode  in;
+  in.type = SNT_IN_NODE;
+  in.value = 90;
+  flow.addNode(in);
+  FlowNode  split;
+  split.type = SNT_PART_NODE;
+  split.ins.resize(1);
+  split.ratios = {0.2, 0.3, 0.5};
+  flow.addNode(split);
+  flow.addLink({0, 0}, {1, 0});
+  FlowNode  out;
+  out.type = SNT_OUT_NODE;
+  for (int i = 0; i < 3; i++)
+    flow.addLink({1, i}, {flow.addNode(out), 0});
+  flow.addNode(out);
+  flow.addNode(out);
+  flow.build();
+  flow.evaluate();
+
+  Sensitivity sensitivity;
+  sensitivity.compute(flow);
+  CHECK(sensitivity.outputs().size() == 5);
+  CHECK(sensitivity.nonZeros() == 6);
+  CHECK(sensitivity.rowBegin(3) == sensitivity.rowEnd(3) && sensitivity.rowBegin(4) == sensitivity.rowEnd(4));
+  CHECK_NEAR(sensitivity.at(2, 0), 0.5, 1e-12);
+  CHECK_NEAR(sensitivity.at(2, 3), 90, 1e-12);
+  checkDerivatives(flow, sensitivity);
+}
+
+//Long chains of the cycle recipes, split and merged back by PartNodes
+STATOR_CASE(sensitivityChains) {
+  CatalogRef  catalog = cycleCatalog();
+  FlowGraph   flow;
+  for (int i = 0; i < 4; i++)
+    addSplitChain(flow, *catalog, 12, 90 + i);
+  flow.build();
+  flow.evaluate();
+
+  Sensitivity sensitivity;
+  sensitivity.compute(flow);
+  CHECK(sensitivity.outputs().size() == 4);
+  checkDerivatives(flow, sensitivity);
+}
@@ -0,0 +1,83 @@
+#include "harness.hpp"
+#include "fixtures.hpp"
+#include "stator/simulation.hpp"
+
+//Input -> recipe A to B -> PartNode keeping 3/4 of it (0.5 and 0.25) -> an
+//OutputNode and recipe B to C -> PartNode making 1.5 of what it gets ->
+//OutputNode. overflowCap is the cap of the link leaving the last PartNode.
+static FlowGraph  ratioChain(const Catalog& catalog, double overflowCap, int outputs[2]) {
+  FlowGraph flow;
+  FlowNode  in;
+  in.type = SNT_IN_NODE;
+  in.value = 90;
+  int       input = flow.addNode(in);
+
+  FlowNode  recipe;
+  recipe.type = SNT_RECIPE_NODE;
+  recipe.recipe = &catalog.recipes()[0];
+  int       toB = flow.addNode(recipe);
+  recipe.recipe = &catalog.recipes()[1];
+  int       toC = flow.addNode(recipe);
+
+  FlowNode  deficit;
+  deficit.type = SNT_PART_NODE;
+  deficit.part = &catalog.parts()[1];
+  deficit.ins.resize(1);
+  deficit.ratios = {0.5, 0.25};
+  int       split = flow.addNode(deficit);
+  FlowNode  overflow;
+  overflow.type = SNT_PART_NODE;
+  overflow.part = &catalog.parts()[2];
+  overflow.ins.resize(1);
+  overflow.ratios = {1.5};
+  int       grow = flow.addNode(overflow);
+
+  FlowNode  out;
+  out.type = SNT_OUT_NODE;
+  outputs[0] = flow.addNode(out);
+  outputs[1] = flow.addNode(out);
+
+  flow.addLink({input, 0}, {toB, 0});
+  flow.addLink({toB, 0}, {split, 0});
+  flow.addLink({split, 0}, {outputs[0], 0});
+  flow.addLink({split, 1}, {toC, 0});
+  flow.addLink({toC, 0}, {grow, 0});
+  flow.addLink({grow, 0}, {outputs[1], 0}, overflowCap);
+  flow.build();
+  flow.evaluate();
+  return (flow);
+}
+
+//Simulated rates settle on what the evaluator computed, for every node
+//exposing one
+static void   checkConverges(const FlowGraph& flow) {
+  Simulation  simulation;
+  simulation.reset(flow);
+  simulation.run(3600);
+  CHECK(simulation.settleTime() >= 0.0);
+  for (int i = 0; i < flow.nodes().size(); i++) {
+    const FlowNode& node = flow.nodes()[i];
+    if (node.type == SNT_IN_NODE || node.type == SNT_PART_NODE)
+      continue ;
+    CHECK_NEAR(simulation.stats()[i].rate, node.rate, 0.02 * node.rate + 1e-6);
+  }
+}
+
+//PartNode ratios not summing to 1 lose or make items as in the evaluator
+STATOR_CASE(simulationRatios) {
+  CatalogRef  catalog = cycleCatalog();
+  int         outputs[2];
+  FlowGraph   flow = ratioChain(*catalog, linkTierCapacity(0), outputs);
+  CHECK_NEAR(flow.nodes()[outputs[0]].rate, 30, 1e-9);
+  CHECK_NEAR(flow.nodes()[outputs[1]].rate, 15.0 / 7 * 11 * 1.5, 1e-9);
+  checkConverges(flow);
+}
+
+//A capped link after the overflowing PartNode holds back the line before it
+STATOR_CASE(simulationBackPressure) {
+  CatalogRef  catalog = cycleCatalog();
+  int         outputs[2];
+  FlowGraph   flow = ratioChain(*catalog, 20, outputs);
+  CHECK_NEAR(flow.nodes()[outputs[1]].rate, 20, 1e-9);
+  checkConverges(flow);
+}
@@ -0,0 +1,6 @@
+#include "harness.hpp"
+
+//statorTests [name...]
+int main(int ac, char** av) {
+  return (runCases(ac, av));
+}